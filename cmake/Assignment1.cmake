@@ -18,3 +18,37 @@ add_post_build_commands(${PROJECT_NAME}
         $<TARGET_FILE_DIR:${PROJECT_NAME}>/assets
         "${Auto_Vk_Toolkit_SOURCE_DIR}/assets"
         ${autoVkToolkitStarter_CreateDependencySymlinks})
+
+# Benchmark executables: the same application, built with different numbers of extra point lights (see shaders/lightsource_limits.h).
+# They are not built by default; the target RunAssignment1Benchmarks builds all of them and runs them in benchmark mode, where every one
+# plays back the same camera preset in every render mode and writes benchmark_lights<N>.csv and .json next to the executables.
+set(Assignment1_BenchmarkExtraPointlights "0;200;1000;4000" CACHE STRING
+        "Numbers of EXTRA_POINTLIGHTS to build benchmark executables for")
+set(Assignment1_BenchmarkArguments "" CACHE STRING
+        "Additional arguments for the benchmark runs, e.g., --benchmark-preset=<name>;--benchmark-frames=<frames>")
+
+set(benchmarkCommands "")
+foreach(numExtraPointlights ${Assignment1_BenchmarkExtraPointlights})
+    set(benchmarkTarget ${PROJECT_NAME}Benchmark${numExtraPointlights})
+    add_executable(${benchmarkTarget} EXCLUDE_FROM_ALL
+            host_code/assignment1.cpp
+            host_code/utils/simple_geometry.cpp)
+    target_compile_definitions(${benchmarkTarget} PRIVATE EXTRA_POINTLIGHTS=${numExtraPointlights})
+    target_include_directories(${benchmarkTarget} PUBLIC
+            shaders/)
+    target_include_directories(${benchmarkTarget} PUBLIC Auto_Vk_Toolkit)
+    target_link_libraries(${benchmarkTarget} PUBLIC Auto_Vk_Toolkit)
+    # The shaders and assets are copied next to the executables by the post build commands of ${PROJECT_NAME}:
+    add_dependencies(${benchmarkTarget} ${PROJECT_NAME})
+    list(APPEND benchmarkCommands
+            COMMAND $<TARGET_FILE:${benchmarkTarget}> --benchmark --benchmark-report=benchmark_lights${numExtraPointlights} ${Assignment1_BenchmarkArguments})
+endforeach()
+
+add_custom_target(Run${PROJECT_NAME}Benchmarks
+        ${benchmarkCommands}
+        WORKING_DIRECTORY $<TARGET_FILE_DIR:${PROJECT_NAME}>
+        COMMENT "Running the ${PROJECT_NAME} benchmarks"
+        VERBATIM)
+foreach(numExtraPointlights ${Assignment1_BenchmarkExtraPointlights})
+    add_dependencies(Run${PROJECT_NAME}Benchmarks ${PROJECT_NAME}Benchmark${numExtraPointlights})
+endforeach()
@@ -6,11 +6,21 @@
 #include <imgui_manager.hpp>
 #include <sequential_invoker.hpp>
 #include <configure_and_compose.hpp>
+#include <chrono>
+#include <numeric>
 
 #include "lightsource_limits.h"
 #include "utils/helper_functions.hpp"
 #include "utils/simple_geometry.hpp"
 #include "utils/camera_presets.hpp"
+#include "utils/frustum_culling.hpp"
+#include "utils/gpu_profiler.hpp"
+#include "utils/cpu_profiler.hpp"
+#include "utils/frame_recorder.hpp"
+#include "utils/draw_sorting.hpp"
+#include "utils/benchmark.hpp"
+#include "utils/dynamic_resolution.hpp"
+#include "utils/async_compute.hpp"
 
 /**	Main class for the host code part of ARTR 2024 Assignment 1.
  *
@@ -24,13 +34,22 @@ class assignment1 : public avk::invokee
 {
 	// ------------------ Structs for transfering data from HOST -> DEVICE ------------------
 
-	/** Struct definition for push constants used for the draw calls of the scene */
-	struct push_constants
+	/**	Struct definition for the per-draw data of all draw calls, stored in one storage buffer. All draws are instanced, and
+	 *	the vertex shaders find the per-draw data of an instance through its entry in the instance draw indices (gl_InstanceIndex).
+	 */
+	struct draw_data
 	{
-        explicit push_constants(const glm::mat4 &mModelMatrix, const int mMaterialIndex) : mModelMatrix(mModelMatrix), mMaterialIndex(mMaterialIndex) {}
-
-        glm::mat4 mModelMatrix;
+		glm::mat4 mModelMatrix;
 		int mMaterialIndex;
+		// Index of the instance group, i.e., of the instanced draw which this draw call is one instance of
+		uint32_t mInstanceGroup;
+		// Number of levels of detail of the draw call's geometry
+		uint32_t mLodCount;
+		uint32_t mUnused0;
+		// Parameters for reconstructing positions and texture coordinates of compact vertices:
+		glm::vec4 mPositionOffset;
+		glm::vec4 mPositionScale;
+		glm::vec4 mTexCoordsOffsetScale;
 	};
 	
 	/** Struct definition for data used as UBO across different pipelines, containing matrices and user input */
@@ -44,6 +63,10 @@ class assignment1 : public avk::invokee
 		glm::mat4 mCamPos;
 		// x = normal mapping strength, y, z, and w unused for now
 		glm::vec4 mUserInput;
+		// x = near plane distance, y = far plane distance, z = clustered light culling enabled (1.0) or not (0.0), w unused
+		glm::vec4 mClusteringParams;
+		// xy = size of a light cluster's screen tile in pixels, zw unused
+		glm::vec4 mClusterTileSize;
 	};
 
 	/** Struct definition for data used as UBO across different pipelines, containing lightsource data */
@@ -57,18 +80,128 @@ class assignment1 : public avk::invokee
 		std::array<avk::lightsource_gpu_data, MAX_NUMBER_OF_LIGHTSOURCES> mLightData;
 	};
 
+	/** Struct definition for the world-space bounding box of a draw call, stored in one storage buffer (used for GPU culling) */
+	struct draw_bounds
+	{
+		glm::vec4 mCenter;
+		glm::vec4 mHalfExtent;
+	};
+
+	/** Struct definition for push constants used for the GPU culling pass */
+	struct culling_push_constants
+	{
+		frustum_culling::planes_t mFrustumPlanes;
+		// Parameters for selecting the levels of detail, see mesh_lod::select_level
+		glm::vec4 mLodParams;
+		uint32_t mDrawCount;
+		// One of culling_phase
+		uint32_t mPhase;
+	};
+
+	/** Phases of the GPU culling pass: Frustum culling only, or the two phases of occlusion culling (see record_gpu_culling) */
+	enum struct culling_phase : uint32_t
+	{
+		frustum_only    = 0,
+		occlusion_early = 1, // Tests against the previous frame's depth pyramid, before the early shading pass
+		occlusion_late  = 2  // Tests the draw calls which have failed the early test against the current frame's, before the late shading pass
+	};
+
+	/** Struct definition for the UBO of the occlusion culling phases, containing what the depth pyramids have been built with */
+	struct occlusion_culling_data
+	{
+		glm::mat4 mViewProjMatrix;
+		glm::mat4 mPrevViewProjMatrix;
+		// xy = rendered extent of the current frame, zw = of the previous frame
+		glm::uvec4 mRenderExtents;
+		// x = number of levels of the depth pyramid, y = previous frame's pyramid valid (1) or not (0), z and w unused
+		glm::uvec4 mHiZParams;
+	};
+
+	/** Struct definition for the counters which the GPU culling pass writes, read back by the host for the GUI */
+	struct culling_stats
+	{
+		uint32_t mDrawnInstances;
+		uint32_t mDrawnTriangles;
+		uint32_t mDrawnCommands;
+		uint32_t mLateDrawnInstances;
+		uint32_t mFrustumCulledInstances;
+		uint32_t mOccludedInstances;
+		uint32_t mCulledTriangles;
+		uint32_t mUnused;
+	};
+
+	/** Struct definition for push constants used for building a level of the depth pyramid */
+	struct hiz_build_push_constants
+	{
+		// xy = size of the source level, zw = size of the destination level
+		glm::ivec4 mSrcAndDstSize;
+		int32_t mSrcLevel;
+	};
+
+	/** Struct definition for push constants used for the light clustering pass */
+	struct light_clustering_push_constants
+	{
+		glm::mat4 mInverseProjMatrix;
+		// xy = size of a cluster's screen tile in pixels, zw = resolution in pixels
+		glm::vec4 mTileSizeAndResolution;
+		// x = near plane distance, y = far plane distance, z and w unused
+		glm::vec4 mDepthRange;
+	};
+
+	/** Struct definition for push constants used for the upscale pass */
+	struct upscale_push_constants
+	{
+		// xy = extent of the rendered part in pixels, zw = size of a pixel in texture coordinates of the scene images
+		glm::vec4 mRenderExtentAndTexelSize;
+		// x = sharpness, y, z, and w unused
+		glm::vec4 mSharpness;
+	};
+
+	/** Ways of culling the scene's draw calls against the camera's view frustum */
+	enum struct culling_mode
+	{
+		none,
+		cpu, // Test on the CPU (with SSE, if available) before recording
+		gpu  // Test and compact in a compute shader, draw indirectly with the resulting count
+	};
+
+	/** A range of consecutive draw calls which use the same vertex and index buffers, i.e., they can be issued with one indirect draw call */
+	struct indirect_batch
+	{
+		uint32_t mFirstDraw;
+		uint32_t mDrawCount;
+	};
+
+	/**	One instanced draw of the current frame: Consecutive visible draw calls of the same instance group. Its firstInstance is
+	 *	the position of its first instance in the instance draw indices, mFirstDraw the first draw call (for binding its buffers).
+	 */
+	struct instanced_draw
+	{
+		vk::DrawIndexedIndirectCommand mCommand;
+		uint32_t mFirstDraw;
+	};
+
 	// ----------------------------------------------------
 
 public:
 	/** Constructor
-	 *	@param	aQueue	Stores an avk::queue* internally for future use, which has been created previously.
+	 *	@param	aQueue			Stores an avk::queue* internally for future use, which has been created previously.
+	 *	@param	aTransferQueue	Queue for the geometry uploads
+	 *	@param	aComputeQueue	Queue for the per-frame compute passes; if it is aQueue, they are recorded into the frame's command buffer
 	 */
-	assignment1(avk::queue& aQueue)
+	assignment1(avk::queue& aQueue, avk::queue& aTransferQueue, avk::queue& aComputeQueue)
 		: mQueue{ &aQueue }
-		, mSkyboxSphere{ &aQueue }
+		, mTransferQueue{ &aTransferQueue }
+		, mComputeQueue{ &aComputeQueue }
 	{		
 	}
 
+	/** Run the benchmark with the given settings instead of rendering interactively, must be invoked before initialize() */
+	void enable_benchmark(benchmark::settings aSettings)
+	{
+		mBenchmarkSettings = std::move(aSettings);
+	}
+
 	// ----------------------- vvv   INITIALIZATION   vvv -----------------------
 
 	/**	Initialize callback is invoked by the framework at initialization time.
@@ -85,6 +218,75 @@ public:
 		// Create a command pool for allocating single-use (hence, transient) command buffers:
 		mCommandPool = context().create_command_pool(mQueue->family_index(), vk::CommandPoolCreateFlagBits::eTransient);
 
+		// Geometry is uploaded through the transfer queue, without waiting for it (the draw calls become ready as their uploads complete):
+		mAsyncUploader.init(*mTransferQueue, *mQueue);
+
+		// Create the timestamp query pools of the GPU profiler, one per frame in flight:
+		mGpuProfiler.init(*mQueue, static_cast<uint32_t>(context().main_window()->number_of_frames_in_flight()));
+
+		// The culling and light clustering passes are submitted to the compute queue, where they overlap with the previous frame's graphics work:
+		mAsyncCompute.init(*mComputeQueue, *mQueue, static_cast<uint32_t>(context().main_window()->number_of_frames_in_flight()));
+		mUseAsyncCompute = mAsyncCompute.is_available();
+		if (mAsyncCompute.is_available()) {
+			mComputeGpuProfiler.init(mAsyncCompute.compute_queue(), static_cast<uint32_t>(context().main_window()->number_of_frames_in_flight()));
+		}
+
+		// Create GPU buffers which will be populated with frame-specific user data (matrices, settings), and lightsource data.
+		// The host writes the data of the current frame while the GPU may still be reading the previous frames' data.
+		// Therefore, the host-visible buffers exist once per frame in flight, and the current frame only writes into its own one:
+		for (window::frame_id_t fif = 0; fif < context().main_window()->number_of_frames_in_flight(); ++fif) {
+			mUniformsBuffers.push_back(context().create_buffer(
+				memory_usage::host_visible, {}, // Create its backing memory in a host visible memory region (writable from the host-side)
+				uniform_buffer_meta::create_from_size(sizeof(matrices_and_user_input)) // Meta data tells the type of this buffer => A uniform buffer
+			));
+			// The light data is written here, and copied into mLightsBuffer at the beginning of the frame's command buffer:
+			mLightsStagingBuffers.push_back(context().create_buffer(
+				memory_usage::host_visible, vk::BufferUsageFlagBits::eTransferSrc,
+				generic_buffer_meta::create_from_size(sizeof(lightsource_data))
+			));
+			// One light list per light cluster, written by the light clustering pass every frame. The compute pass of the next frame
+			// might run while this frame's fragment shaders still read them, hence, once per frame in flight:
+			mClusterLightListsBuffers.push_back(context().create_buffer(
+				memory_usage::device, {},
+				storage_buffer_meta::create_from_size(sizeof(uint32_t) * NUMBER_OF_LIGHT_CLUSTERS * LIGHT_CLUSTER_LIST_SIZE)
+			));
+		}
+		mLightsBuffer = context().create_buffer(
+			memory_usage::device, {}, // Create its backing memory in a device-only memory region (takes an additional intermediate step
+			                          // to be filled (internally handled) through a host visible buffer, but faster access during rendering.)
+			storage_buffer_meta::create_from_size(sizeof(lightsource_data)) // Meta data tells the type of this buffer => A storage buffer (not limited in size like uniform buffers)
+		);
+		// The light clustering pass on the compute queue reads its own copy of the light data, which the compute queue updates while the graphics
+		// queue still reads mLightsBuffer. The host-visible inputs are only duplicated if the compute queue belongs to another queue family:
+		if (mAsyncCompute.is_available()) {
+			mComputeLightsBuffer = context().create_buffer(
+				memory_usage::device, {},
+				storage_buffer_meta::create_from_size(sizeof(lightsource_data))
+			);
+			for (window::frame_id_t fif = 0; fif < context().main_window()->number_of_frames_in_flight(); ++fif) {
+				if (!mAsyncCompute.needs_ownership_transfer()) {
+					mComputeUniformsBuffers.push_back(mUniformsBuffers[fif]);
+					mComputeLightsStagingBuffers.push_back(mLightsStagingBuffers[fif]);
+					continue;
+				}
+				mComputeUniformsBuffers.push_back(context().create_buffer(
+					memory_usage::host_visible, {},
+					uniform_buffer_meta::create_from_size(sizeof(matrices_and_user_input))
+				));
+				mComputeLightsStagingBuffers.push_back(context().create_buffer(
+					memory_usage::host_visible, vk::BufferUsageFlagBits::eTransferSrc,
+					generic_buffer_meta::create_from_size(sizeof(lightsource_data))
+				));
+			}
+		}
+
+		// The pipelines which don't depend on the scene are created on a worker thread while the scene is being loaded (they only need
+		// the renderpasses, the scene framebuffer, and the buffers above), the others after it has been loaded. One single worker, because
+		// the pipelines must be created one after the other (see create_scene_independent_pipelines):
+		init_renderpasses();
+		thread_pool pipelineWorker(1u);
+		auto sceneIndependentPipelines = create_scene_independent_pipelines(pipelineWorker);
+
 		// Load 3D scenes/models from files:
 		std::tie(mMaterials, mImageSamplers, mDrawCalls) = helpers::load_models_and_scenes_from_file({
 			// Load a scene from file (path according to the Visual Studio filters!), and apply a transformation matrix (identity, here):
@@ -94,20 +296,10 @@ public:
 			//                    show the differences of orthogonal vs. non-orthogonal tangent space!
 			//
 			//, {"assets/3rd_party/models/parallelepiped_textured.obj", glm::rotate(1.57f, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::scale(glm::vec3(0.7f))}
-		}, mQueue);
-		// Create sphere geometry for the skybox (only relevant for Bonus Task 2):
-		mSkyboxSphere.create_sphere();
-
-		// Create GPU buffers which will be populated with frame-specific user data (matrices, settings), and lightsource data:
-		mUniformsBuffer = context().create_buffer(
-			memory_usage::host_visible, {}, // Create its backing memory in a host visible memory region (writable from the host-side)
-			uniform_buffer_meta::create_from_size(sizeof(matrices_and_user_input)) // Meta data tells the type of this buffer => A uniform buffer
-		);
-		mLightsBuffer = context().create_buffer(
-			memory_usage::device, {}, // Create its backing memory in a device-only memory region (takes an additional intermediate step
-			                          // to be filled (internally handled) through a host visible buffer, but faster access during rendering.)
-			uniform_buffer_meta::create_from_size(sizeof(lightsource_data)) // Meta data tells the type of this buffer => A uniform buffer
-		);
+		}, mQueue, mGeometryLayout, mVertexFormat, &mAsyncUploader);
+
+		// Create the buffers required for drawing the scene with indirect draw calls:
+		init_indirect_drawing();
 
 		// Initialize the quake_camera, and then add it to our composition (it is a avk::invokee, too):
 		mOrbitCam.set_translation({ -6.81f, 1.71f, -0.72f });
@@ -120,19 +312,259 @@ public:
 		current_composition()->add_element(mQuakeCam);
 		mQuakeCam.disable();
 
-		// Create the graphics pipelines for drawing the scene:
-		init_pipelines();
+		// Wait for the pipelines which have been created while the scene was being loaded, then create the ones for drawing the scene:
+		for (auto& creation : sceneIndependentPipelines) {
+			creation.wait();
+		}
+		for (auto& creation : sceneIndependentPipelines) {
+			creation.get(); // Rethrows the first exception, if any
+		}
+		create_scene_pipelines();
 		// Initialize the GUI, which is drawn through ImGui:
 		init_gui();
 		// Enable swapchain recreation and shader hot reloading:
 		enable_the_updater();
+		// Set up the benchmark runs, if the benchmark mode has been enabled:
+		init_benchmark();
 	}
 
-	/**	Helper function, which creates the graphics pipelines at initialization time:
-	 *	 - mPipeline is relevant for all tasks, renders the whole scene
-	 *	 - mSkyboxPipeline is relevant for Bonus Task 2, renders the skybox
+	/**	Helper function, which sets up the benchmark runs if enable_benchmark() has been invoked: One run with the render settings
+	 *	at startup, and one for each of the alternative settings, which differ from them in one setting each.
+	 */
+	void init_benchmark()
+	{
+		if (!mBenchmarkSettings.has_value()) {
+			return;
+		}
+
+		// Every run begins from the render settings at startup:
+		const auto resetSettings = [this, indirect = mUseIndirectDrawing, prebaked = mUsePrebakedDescriptorSets, reuse = mReuseSceneCommandBuffers, culling = mCullingMode, order = mDrawOrder,
+		                            clustered = mUseClusteredShading, depthPrePass = mUseDepthPrePass, lods = mUseMeshLods, lodRadius = mLodReferenceRadius, asyncCompute = mUseAsyncCompute,
+		                            occlusion = mUseOcclusionCulling] {
+			mUseIndirectDrawing = indirect;
+			mUsePrebakedDescriptorSets = prebaked;
+			mReuseSceneCommandBuffers = reuse;
+			mCullingMode = culling;
+			mDrawOrder = order;
+			mUseClusteredShading = clustered;
+			mUseDepthPrePass = depthPrePass;
+			mUseMeshLods = lods;
+			mLodReferenceRadius = lodRadius;
+			mUseAsyncCompute = asyncCompute;
+			mUseOcclusionCulling = occlusion;
+			// Every run renders at the full resolution, unless its mode enables the dynamic resolution:
+			mDynamicResolution.get_settings() = dynamic_resolution::settings{};
+			mDynamicResolution.get_settings().mEnabled = false;
+			mDynamicResolution.reset();
+		};
+		const auto variant = [&resetSettings](std::string aName, std::function<void()> aChange) {
+			return benchmark::mode{ std::move(aName), [resetSettings, aChange] { resetSettings(); aChange(); } };
+		};
+		std::vector<benchmark::mode> modes{
+			variant("default",                    [] {}),
+			variant("no_culling",                 [this] { mCullingMode = culling_mode::none; }),
+			variant("gpu_culling",                [this] { mCullingMode = culling_mode::gpu; mUseOcclusionCulling = false; }),
+			variant("gpu_occlusion_culling",      [this] { mCullingMode = culling_mode::gpu; mUseOcclusionCulling = true; }),
+			variant("indirect_drawing",           [this] { mUseIndirectDrawing = true; }),
+			variant("scene_order",                [this] { mDrawOrder = draw_sorting::order::scene; }),
+			variant("depth_then_material_order",  [this] { mDrawOrder = draw_sorting::order::depth_then_material; }),
+			variant("no_clustered_shading",       [this] { mUseClusteredShading = false; }),
+			variant("depth_prepass",              [this] { mUseDepthPrePass = true; }),
+			variant("no_mesh_lods",               [this] { mUseMeshLods = false; }),
+			variant("descriptor_cache_lookups",   [this] { mUsePrebakedDescriptorSets = false; }),
+			variant("no_command_buffer_reuse",    [this] { mReuseSceneCommandBuffers = false; }),
+			variant("dynamic_resolution",         [this] { mDynamicResolution.get_settings().mEnabled = true; })
+		};
+		if (mAsyncCompute.is_available()) {
+			modes.push_back(variant("no_async_compute", [this] { mUseAsyncCompute = false; }));
+		}
+		const auto resolution = avk::context().main_window()->resolution();
+		mBenchmark.emplace(*mBenchmarkSettings, std::move(modes), std::vector<std::pair<std::string, std::string>>{
+			{ "extraPointlights", std::to_string(EXTRA_POINTLIGHTS) },
+			{ "resolution", std::format("{}x{}", resolution.x, resolution.y) },
+			{ "drawCalls", std::to_string(mDrawCalls.size()) }
+		});
+
+		// The camera preset moves the cameras, user input must not interfere with it. Light gizmos are not part of the measured frames:
+		mOrbitCam.disable();
+		mQuakeCam.disable();
+		helpers::set_lightsource_gizmos_enabled(false);
+	}
+
+	/**	Helper function, which gathers the per-draw data of all the draw calls in mDrawCalls into one storage buffer (mDrawDataBuffer).
+	 *	Consecutive draw calls which share the same buffers are combined into one indirect_batch, and consecutive draw calls which only
+	 *	differ in their model matrices (i.e., the instances of one ORCA model's material group) into one instance group, which is drawn
+	 *	with one instanced draw. Also creates the buffers for the per-frame instanced draws and the GPU culling pass.
+	 *	The draw calls with default texture tiling are moved behind all the others first, s.t. each shading pipeline variant draws one
+	 *	contiguous range of instance groups (see record_scene_draw_calls).
+	 */
+	void init_indirect_drawing()
+	{
+		using namespace avk;
+
+		// Stable, i.e., the instances of a material group (which all have the same material) still follow each other:
+		std::stable_partition(std::begin(mDrawCalls), std::end(mDrawCalls), [](const helpers::data_for_draw_call& aDrawCall) { return !aDrawCall.mDefaultTextureTiling; });
+
+		std::vector<draw_data> drawData;
+		std::vector<draw_bounds> drawBounds;
+		std::vector<vk::DrawIndexedIndirectCommand> instanceGroupCommands;
+		drawData.reserve(mDrawCalls.size());
+		drawBounds.reserve(mDrawCalls.size());
+		mIndirectBatches.clear();
+		mInstanceGroupOfDraw.clear();
+		mFrustumCulling.clear();
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(mDrawCalls.size()); ++i) {
+			const auto& drawCall = mDrawCalls[i];
+			// Instances of the same material group follow each other, and share everything except for their model matrices:
+			const bool sameGroupAsPrevious = i > 0
+				&& mDrawCalls[i - 1].mIndexBuffer->handle() == drawCall.mIndexBuffer->handle()
+				&& mDrawCalls[i - 1].mFirstIndex == drawCall.mFirstIndex && mDrawCalls[i - 1].mIndexCount == drawCall.mIndexCount
+				&& mDrawCalls[i - 1].mVertexOffset == drawCall.mVertexOffset && mDrawCalls[i - 1].mMaterialIndex == drawCall.mMaterialIndex;
+			if (sameGroupAsPrevious) {
+				++instanceGroupCommands.back().instanceCount;
+			}
+			else {
+				if (drawCall.mDefaultTextureTiling && (i == 0 || !mDrawCalls[i - 1].mDefaultTextureTiling)) {
+					mFirstDefaultTilingInstanceGroup = static_cast<uint32_t>(instanceGroupCommands.size());
+				}
+				// The group's instances are found at the positions of its draw calls in the culled instance draw indices:
+				instanceGroupCommands.emplace_back(drawCall.mIndexCount, 1u, drawCall.mFirstIndex, drawCall.mVertexOffset, i);
+			}
+			mInstanceGroupOfDraw.push_back(static_cast<uint32_t>(instanceGroupCommands.size() - 1));
+
+			drawData.push_back(draw_data{
+				drawCall.mModelMatrix, drawCall.mMaterialIndex, mInstanceGroupOfDraw.back(), drawCall.mLodCount, 0u,
+				drawCall.mDequantization.mPositionOffset, drawCall.mDequantization.mPositionScale, drawCall.mDequantization.mTexCoordsOffsetScale
+			});
+			drawBounds.push_back(draw_bounds{
+				glm::vec4{ (drawCall.mBoundsMin + drawCall.mBoundsMax) * 0.5f, 0.0f },
+				glm::vec4{ (drawCall.mBoundsMax - drawCall.mBoundsMin) * 0.5f, 0.0f }
+			});
+			mFrustumCulling.add_bounding_box(drawCall.mBoundsMin, drawCall.mBoundsMax);
+
+			if (mIndirectBatches.empty() || mDrawCalls[mIndirectBatches.back().mFirstDraw].mIndexBuffer->handle() != drawCall.mIndexBuffer->handle()) {
+				mIndirectBatches.push_back(indirect_batch{ i, 1u });
+			}
+			else {
+				++mIndirectBatches.back().mDrawCount;
+			}
+		}
+
+		mDrawDataBuffer = context().create_buffer(
+			memory_usage::device, {},
+			storage_buffer_meta::create_from_data(drawData)
+		);
+		mDrawBoundsBuffer = context().create_buffer(
+			memory_usage::device, {},
+			storage_buffer_meta::create_from_data(drawBounds)
+		);
+		// The commands of every level of detail of every instance group, without instances; copied into mCulledCommandsBuffers before every culling pass.
+		// Every level has its own range of instance draw indices, i.e., the instances of level l of a group start at l * mDrawCalls.size() + its first draw:
+		std::vector<vk::DrawIndexedIndirectCommand> culledCommands;
+		culledCommands.reserve(instanceGroupCommands.size() * geometry_cache::sMaxLodLevels);
+		for (const auto& groupCommand : instanceGroupCommands) {
+			const auto& firstDrawCall = mDrawCalls[groupCommand.firstInstance];
+			for (uint32_t l = 0; l < geometry_cache::sMaxLodLevels; ++l) {
+				const auto& lod = firstDrawCall.mLods[std::min(l, firstDrawCall.mLodCount - 1)]; // Levels beyond mLodCount are never selected
+				culledCommands.emplace_back(lod.mIndexCount, 0u, lod.mFirstIndex, groupCommand.vertexOffset, l * static_cast<uint32_t>(mDrawCalls.size()) + groupCommand.firstInstance);
+			}
+		}
+		mInstanceGroupCommandsBuffer = context().create_buffer(
+			memory_usage::device, vk::BufferUsageFlagBits::eTransferSrc,
+			storage_buffer_meta::create_from_data(culledCommands)
+		);
+		// The late occlusion culling phase draws its instances with separate commands, whose instances follow all of the early phase's:
+		auto lateCommands = culledCommands;
+		for (auto& command : lateCommands) {
+			command.firstInstance += static_cast<uint32_t>(mDrawCalls.size()) * geometry_cache::sMaxLodLevels;
+		}
+		mLateInstanceGroupCommandsBuffer = context().create_buffer(
+			memory_usage::device, vk::BufferUsageFlagBits::eTransferSrc,
+			storage_buffer_meta::create_from_data(lateCommands)
+		);
+		// Whether the early occlusion culling phase has found a draw call occluded, i.e., whether the late phase tests it again:
+		mOcclusionCandidatesBuffer = context().create_buffer(
+			memory_usage::device, {},
+			storage_buffer_meta::create_from_element_size(sizeof(uint32_t), std::max<size_t>(mDrawCalls.size(), 1))
+		);
+		// The instanced draws of the CPU-recorded paths and their instance draw indices are written by the host every frame:
+		for (window::frame_id_t fif = 0; fif < context().main_window()->number_of_frames_in_flight(); ++fif) {
+			// Written by the GPU culling pass every frame (once per frame in flight, like the light lists). The storage buffer meta comes
+			// first, s.t. descriptor_binding uses it as storage buffer; the indirect meta enables indirect usage:
+			mCulledCommandsBuffers.push_back(context().create_buffer(
+				memory_usage::device, vk::BufferUsageFlagBits::eTransferDst,
+				storage_buffer_meta::create_from_data(culledCommands),
+				indirect_buffer_meta::create_from_data(culledCommands)
+			));
+			mLateCulledCommandsBuffers.push_back(context().create_buffer(
+				memory_usage::device, vk::BufferUsageFlagBits::eTransferDst,
+				storage_buffer_meta::create_from_data(lateCommands),
+				indirect_buffer_meta::create_from_data(lateCommands)
+			));
+			// Room for the instances of both occlusion culling phases:
+			mCulledInstanceDrawIndicesBuffers.push_back(context().create_buffer(
+				memory_usage::device, {},
+				storage_buffer_meta::create_from_element_size(sizeof(uint32_t), std::max<size_t>(mDrawCalls.size() * geometry_cache::sMaxLodLevels * 2, 1))
+			));
+			// The occlusion culling phases' parameters, and the counters of the GPU culling pass, which the host reads back:
+			mOcclusionCullingBuffers.push_back(context().create_buffer(
+				memory_usage::host_visible, {},
+				uniform_buffer_meta::create_from_size(sizeof(occlusion_culling_data))
+			));
+			mCullingStatsBuffers.push_back(context().create_buffer(
+				memory_usage::host_visible, vk::BufferUsageFlagBits::eTransferDst,
+				storage_buffer_meta::create_from_size(sizeof(culling_stats))
+			));
+			mInstanceDrawIndicesBuffers.push_back(context().create_buffer(
+				memory_usage::host_visible, {},
+				storage_buffer_meta::create_from_element_size(sizeof(uint32_t), std::max<size_t>(mDrawCalls.size(), 1))
+			));
+			mInstancedDrawCommandsBuffers.push_back(context().create_buffer(
+				memory_usage::host_visible, {},
+				indirect_buffer_meta::create_from_element_size(sizeof(vk::DrawIndexedIndirectCommand), std::max<size_t>(mDrawCalls.size(), 1))
+			));
+		}
+		auto fen = context().record_and_submit_with_fence({
+			mDrawDataBuffer->fill(drawData.data(), 0),
+			mDrawBoundsBuffer->fill(drawBounds.data(), 0),
+			mInstanceGroupCommandsBuffer->fill(culledCommands.data(), 0),
+			mLateInstanceGroupCommandsBuffer->fill(lateCommands.data(), 0)
+		}, *mQueue);
+		fen->wait_until_signalled();
+		mCullingStatsWritten.assign(context().main_window()->number_of_frames_in_flight(), false);
+
+		// The culling pass on the compute queue reads copies of the constant inputs, which are owned by the compute queue's family.
+		// (Within the same family, both queues read the same buffers.)
+		if (mAsyncCompute.needs_ownership_transfer()) {
+			mComputeDrawDataBuffer = context().create_buffer(memory_usage::device, {}, storage_buffer_meta::create_from_data(drawData));
+			mComputeDrawBoundsBuffer = context().create_buffer(memory_usage::device, {}, storage_buffer_meta::create_from_data(drawBounds));
+			mComputeInstanceGroupCommandsBuffer = context().create_buffer(memory_usage::device, vk::BufferUsageFlagBits::eTransferSrc, storage_buffer_meta::create_from_data(culledCommands));
+			auto computeFen = context().record_and_submit_with_fence({
+				mComputeDrawDataBuffer->fill(drawData.data(), 0),
+				mComputeDrawBoundsBuffer->fill(drawBounds.data(), 0),
+				mComputeInstanceGroupCommandsBuffer->fill(culledCommands.data(), 0)
+			}, mAsyncCompute.compute_queue());
+			computeFen->wait_until_signalled();
+		}
+		else if (mAsyncCompute.is_available()) {
+			mComputeDrawDataBuffer = mDrawDataBuffer;
+			mComputeDrawBoundsBuffer = mDrawBoundsBuffer;
+			mComputeInstanceGroupCommandsBuffer = mInstanceGroupCommandsBuffer;
+		}
+
+		mInstanceGroupCount = static_cast<uint32_t>(instanceGroupCommands.size());
+		if (mDrawCalls.empty() || !mDrawCalls.back().mDefaultTextureTiling) {
+			mFirstDefaultTilingInstanceGroup = mInstanceGroupCount; // None of them has default texture tiling
+		}
+		LOG_INFO(std::format("Indirect drawing: {} draw calls combined into {} indirect batches and {} instance groups", mDrawCalls.size(), mIndirectBatches.size(), mInstanceGroupCount));
+		LOG_INFO(std::format("Shading variants: {} of {} instance groups have default texture tiling", mInstanceGroupCount - mFirstDefaultTilingInstanceGroup, mInstanceGroupCount));
+	}
+
+	/**	Helper function, which creates the renderpasses of all the scene's pipelines and of the upscale pipeline at initialization time,
+	 *	and the scene framebuffer which they render into.
 	 */
-	void init_pipelines()
+	void init_renderpasses()
 	{
 		using namespace avk;
 
@@ -150,53 +582,198 @@ public:
 		//  2) It describes the synchronization for accessing the attachments
 		//        (I.e., which stages must wait on previous external commands on the same queue before they can
 		//         be executed, and which stages of subsequent commands must wait on what within the renderpass.)
-		auto renderpass = context().create_renderpass(
+		// All the scene's renderpasses have the same attachments and only differ in their load and store operations,
+		// i.e., they are all compatible with the window's backbuffers, and with mSceneFramebuffer which they render into:
+		auto createRenderpass = [](auto aColorLoad, auto aColorStore, auto aDepthLoad, auto aDepthStore) {
+			return context().create_renderpass(
 			{ // ad 1) Describe the attachments: One color attachment, and one depth attachment:
-				//                    vvv Copy the format from the window                       vvv clear it    vvv used as       vvv after renderpass finished, store 
-				attachment::declare(format_from_window_color_buffer(context().main_window()),   on_load::clear.from_previous_layout(layout::undefined),  usage::color(0),        on_store::store),
-				attachment::declare(format_from_window_depth_buffer(context().main_window()),   on_load::clear.from_previous_layout(layout::undefined),  usage::depth_stencil,   on_store::store),
+				//                    vvv Copy the format from the window                       vvv load op     vvv used as       vvv after renderpass finished, store 
+				attachment::declare(format_from_window_color_buffer(context().main_window()),   aColorLoad,  usage::color(0),        aColorStore),
+				attachment::declare(format_from_window_depth_buffer(context().main_window()),   aDepthLoad,  usage::depth_stencil,   aDepthStore),
 			}, 
 			{ // ad 2) Describe the dependency between previous external commands and the first (and only) subpass:
                 subpass_dependency( subpass::external   >>  subpass::index(0),
-				//                  vvv   No previous stages to be waited on before   vvv   depth reads/writes or color writes
-					    			stage::none                                   >>  stage::early_fragment_tests | stage::late_fragment_tests | stage::color_attachment_output,
-									access::none                                  >>  access::depth_stencil_attachment_read | access::depth_stencil_attachment_write | access::color_attachment_write
+				//                  vvv   Depth writes of a previous pass, and reads of the previous frame's upscale pass and depth pyramid, must be finished before   vvv   depth reads/writes or color writes
+					    			stage::late_fragment_tests | stage::fragment_shader | stage::compute_shader                                                    >>  stage::early_fragment_tests | stage::late_fragment_tests | stage::color_attachment_output,
+									access::depth_stencil_attachment_write                                                                                         >>  access::depth_stencil_attachment_read | access::depth_stencil_attachment_write | access::color_attachment_write
 								  ),
 				// ad 2) Describe the dependency between (and only) subpass and external subsequent commands:
 				subpass_dependency( subpass::index(0)  >>  subpass::external,
-				//                  vvv   Color and depth writes must be finished before                                           vvv   subsequent depth tests, depth writes, or color writes can continue
-									stage::early_fragment_tests | stage::late_fragment_tests | stage::color_attachment_output  >>  stage::early_fragment_tests | stage::late_fragment_tests | stage::color_attachment_output,
-									access::depth_stencil_attachment_write | access::color_attachment_write                    >>  access::depth_stencil_attachment_read | access::color_attachment_read
+				//                  vvv   Color and depth writes must be finished before                                           vvv   subsequent depth tests, depth writes, color writes, or reads in the upscale pass can continue
+									stage::early_fragment_tests | stage::late_fragment_tests | stage::color_attachment_output  >>  stage::early_fragment_tests | stage::late_fragment_tests | stage::color_attachment_output | stage::fragment_shader,
+									access::depth_stencil_attachment_write | access::color_attachment_write                    >>  access::depth_stencil_attachment_read | access::color_attachment_read | access::color_attachment_write | access::shader_read
 				                  )
 			}
-		);
+			);
+		};
+		// The shading pass leaves color and depth in the layout which the upscale pass samples them in:
+		const auto storeForUpscaling = on_store::store.in_layout(layout::shader_read_only_optimal);
+		mSceneRenderpass = createRenderpass(on_load::clear.from_previous_layout(layout::undefined), storeForUpscaling, on_load::clear.from_previous_layout(layout::undefined), storeForUpscaling);
+		// The depth pre-pass only writes depth. The shading pass after it loads that depth and clears color instead:
+		mDepthPrePassRenderpass = createRenderpass(on_load::dont_care.from_previous_layout(layout::undefined), on_store::dont_care, on_load::clear.from_previous_layout(layout::undefined), on_store::store);
+		mAfterDepthPrePassRenderpass = createRenderpass(on_load::clear.from_previous_layout(layout::undefined), storeForUpscaling, on_load::load.from_previous_layout(layout::depth_stencil_attachment_optimal), storeForUpscaling);
+		// The late shading pass of occlusion culling continues where the early one has left color and depth:
+		mOcclusionLateRenderpass = createRenderpass(on_load::load.from_previous_layout(layout::shader_read_only_optimal), storeForUpscaling, on_load::load.from_previous_layout(layout::shader_read_only_optimal), storeForUpscaling);
+		// The upscale pass writes every pixel of the backbuffer's color and depth:
+		mUpscaleRenderpass = createRenderpass(on_load::dont_care.from_previous_layout(layout::undefined), on_store::store, on_load::dont_care.from_previous_layout(layout::undefined), on_store::store);
+
+		// The scene is rendered into mSceneFramebuffer at the current render scale, and its depth reduced into the depth pyramid (mHiZImage):
+		create_scene_framebuffer();
+	}
+
+	/**	Helper function, which creates the pipelines for drawing the scene at initialization time, once it has been loaded:
+	 *	 - mPipeline is relevant for all tasks, renders the whole scene
+	 *	 - mDepthPrePassPipeline and mPipelineAfterDepthPrePass render the whole scene in two passes, if the depth pre-pass is enabled
+	 *	 - mPipelineDefaultTiling and mPipelineAfterDepthPrePassDefaultTiling are their variants for materials with default texture tiling
+	 *	 - mCullingPipeline culls the scene's draw calls on the GPU
+	 *	Every render mode's pipelines are created here, i.e., they exist before the first frame, and switching modes never has to wait
+	 *	for a pipeline to be compiled. Must not be invoked before the scene-independent pipelines have been created (see initialize).
+	 */
+	void create_scene_pipelines()
+	{
+		using namespace avk;
 
-		// Create a graphics pipeline consisting of a vertex shader and a fragment shader, plus additional config:
-		mPipeline = context().create_graphics_pipeline_for(
-			vertex_shader("shaders/transform_and_pass_on.vert"),
-			fragment_shader("shaders/blinnphong_and_normal_mapping.frag"),
+		// Create graphics pipelines consisting of a vertex shader and (except for the depth pre-pass) a fragment shader, plus additional config.
+		// The config which is specific to a pipeline is passed to this helper, the rest is shared by all the scene's pipelines, s.t. they
+		// all have the same layout and can use the same descriptor sets:
+		auto createScenePipeline = [&](auto... aPipelineSpecificConfig) {
+			return context().create_graphics_pipeline_for(
+				aPipelineSpecificConfig...,
+
+				// Configuration parameters for all of the scene's graphics pipelines:
+				cfg::front_face::define_front_faces_to_be_counter_clockwise(),
+				// The viewport is set by record_scene_draw_calls, according to the current render scale:
+				cfg::viewport_depth_scissors_config::from_framebuffer(
+					context().main_window()->backbuffer_reference_at_index(0) // Just use any compatible framebuffer here
+				).enable_dynamic_viewport().enable_dynamic_scissor(),
+
+				// Define resource descriptors which are to be used with this draw call:
+				descriptor_binding(0, 0, mMaterials),
+				descriptor_binding(0, 1, as_combined_image_samplers(mImageSamplers, layout::shader_read_only_optimal)),
+				descriptor_binding(1, 0, mUniformsBuffers.front()), // Doesn't have to be the exact buffer, but one that describes the correct layout for the pipeline.
+				descriptor_binding(1, 1, mLightsBuffer),            // Doesn't have to be the exact buffer, but one that describes the correct layout for the pipeline.
+				descriptor_binding(1, 2, mClusterLightListsBuffers.front()),
+				descriptor_binding(2, 0, mDrawDataBuffer), // Per-draw data (and dequantization parameters of compact vertices)
+				descriptor_binding(2, 1, mInstanceDrawIndicesBuffers.front()) // Per-instance indices into the per-draw data
+			);
+		};
+		// The shading pass after a depth pre-pass only shades the fragments whose depth equals the pre-pass's depth. This requires
+		// bit-identical depth values, which is why all of the scene's vertex shaders declare gl_Position as invariant:
+		const auto depthTestAfterDepthPrePass = cfg::depth_test::enabled().set_compare_operation(cfg::compare_operation::less_or_equal);
+		// The depth pre-pass has no fragment shader, and does not write color at all:
+		const auto noColorWrites = cfg::color_blending_config::disable_blending_for_all_attachments(cfg::color_channel::none);
+		// The shading pipelines exist in two variants: A generic one, and one which is specialized for the materials with default texture
+		// tiling, and does not have to read the textures' offsets and tilings (see DEFAULT_TEXTURE_TILING in blinnphong_and_normal_mapping.frag).
+		// Every draw call uses the cheapest variant which matches its material (see helpers::data_for_draw_call::mDefaultTextureTiling):
+		const auto shadingFragmentShader = [](bool aDefaultTextureTiling) {
+			return fragment_shader("shaders/blinnphong_and_normal_mapping.frag").set_specialization_constant(0u, aDefaultTextureTiling ? uint32_t{ VK_TRUE } : uint32_t{ VK_FALSE });
+		};
 
-			from_buffer_binding(0)->stream_per_vertex<glm::vec3>()->to_location(0), // Stream positions from the vertex buffer bound at index #0
-			from_buffer_binding(1)->stream_per_vertex<glm::vec2>()->to_location(1), // Stream texture coordinates from the vertex buffer bound at index #1
-			from_buffer_binding(2)->stream_per_vertex<glm::vec3>()->to_location(2), // Stream normals from the vertex buffer bound at index #2
+		// The vertex shaders and the vertex input configuration depend on the vertex format the scene has been loaded with:
+		if (mVertexFormat == helpers::vertex_format::compact) {
+			// All attributes are interleaved in ONE vertex buffer, and converted to floats by the vertex input stage:
+			constexpr auto stride = sizeof(helpers::compact_vertex);
+			const auto positions = from_buffer_binding(0)->stream_per_vertex(offsetof(helpers::compact_vertex, mPosition),  vk::Format::eR16G16B16A16Snorm, stride)->to_location(0); // Position + bitangent sign
+			const auto texCoords = from_buffer_binding(0)->stream_per_vertex(offsetof(helpers::compact_vertex, mTexCoords), vk::Format::eR16G16Unorm,       stride)->to_location(1); // Texture coordinates
+			const auto normals   = from_buffer_binding(0)->stream_per_vertex(offsetof(helpers::compact_vertex, mNormal),    vk::Format::eR16G16Snorm,       stride)->to_location(2); // Octahedral normal
+			const auto tangents  = from_buffer_binding(0)->stream_per_vertex(offsetof(helpers::compact_vertex, mTangent),   vk::Format::eR16G16Snorm,       stride)->to_location(3); // Octahedral tangent
+
+			for (const bool defaultTextureTiling : { false, true }) {
+				auto& pipeline = defaultTextureTiling ? mPipelineDefaultTiling : mPipeline;
+				auto& pipelineAfterDepthPrePass = defaultTextureTiling ? mPipelineAfterDepthPrePassDefaultTiling : mPipelineAfterDepthPrePass;
+				pipeline = createScenePipeline(
+					vertex_shader("shaders/transform_and_pass_on_compact.vert"), shadingFragmentShader(defaultTextureTiling),
+					positions, texCoords, normals, tangents,
+					mSceneRenderpass
+				);
+				pipelineAfterDepthPrePass = createScenePipeline(
+					vertex_shader("shaders/transform_and_pass_on_compact.vert"), shadingFragmentShader(defaultTextureTiling),
+					positions, texCoords, normals, tangents,
+					mAfterDepthPrePassRenderpass, depthTestAfterDepthPrePass, cfg::depth_write::disabled()
+				);
+			}
+			mDepthPrePassPipeline = createScenePipeline(
+				vertex_shader("shaders/depth_prepass_compact.vert"),
+				positions, // Streams the bitangent sign, too, but that is ignored
+				mDepthPrePassRenderpass, noColorWrites
+			);
+		}
+		else {
+			const auto positions = from_buffer_binding(0)->stream_per_vertex<glm::vec3>()->to_location(0); // Stream positions from the vertex buffer bound at index #0
+			const auto texCoords = from_buffer_binding(1)->stream_per_vertex<glm::vec2>()->to_location(1); // Stream texture coordinates from the vertex buffer bound at index #1
+			const auto normals   = from_buffer_binding(2)->stream_per_vertex<glm::vec3>()->to_location(2); // Stream normals from the vertex buffer bound at index #2
 			// TODO Task 1: Declare from which buffer bindings to stream tangent and bitangent data!
 
-			// Use the renderpass created above:
-			renderpass,
-
-			// Configuration parameters for this graphics pipeline:
-			cfg::front_face::define_front_faces_to_be_counter_clockwise(),
-			cfg::viewport_depth_scissors_config::from_framebuffer(
-				context().main_window()->backbuffer_reference_at_index(0) // Just use any compatible framebuffer here
-			),
+			for (const bool defaultTextureTiling : { false, true }) {
+				auto& pipeline = defaultTextureTiling ? mPipelineDefaultTiling : mPipeline;
+				auto& pipelineAfterDepthPrePass = defaultTextureTiling ? mPipelineAfterDepthPrePassDefaultTiling : mPipelineAfterDepthPrePass;
+				pipeline = createScenePipeline(
+					vertex_shader("shaders/transform_and_pass_on.vert"), shadingFragmentShader(defaultTextureTiling),
+					positions, texCoords, normals,
+					mSceneRenderpass
+				);
+				pipelineAfterDepthPrePass = createScenePipeline(
+					vertex_shader("shaders/transform_and_pass_on.vert"), shadingFragmentShader(defaultTextureTiling),
+					positions, texCoords, normals,
+					mAfterDepthPrePassRenderpass, depthTestAfterDepthPrePass, cfg::depth_write::disabled()
+				);
+			}
+			// Only positions are streamed, the other vertex buffers remain bound (see bind_geometry_buffers), but unused:
+			mDepthPrePassPipeline = createScenePipeline(
+				vertex_shader("shaders/depth_prepass.vert"),
+				positions,
+				mDepthPrePassRenderpass, noColorWrites
+			);
+		}
 
-			// Define push constants and resource descriptors which are to be used with this draw call:
-			push_constant_binding_data{ shader_type::vertex | shader_type::fragment, 0, sizeof(push_constants) },
-			descriptor_binding(0, 0, mMaterials),
-			descriptor_binding(0, 1, as_combined_image_samplers(mImageSamplers, layout::shader_read_only_optimal)),
-			descriptor_binding(1, 0, mUniformsBuffer), // Doesn't have to be the exact buffer, but one that describes the correct layout for the pipeline.
-			descriptor_binding(1, 1, mLightsBuffer)    // Doesn't have to be the exact buffer, but one that describes the correct layout for the pipeline.
+		// Create the compute pipeline which culls the scene's draw calls and compacts the visible ones:
+		mCullingPipeline = context().create_compute_pipeline_for(
+			compute_shader("shaders/frustum_cull.comp"),
+			push_constant_binding_data{ shader_type::compute, 0, sizeof(culling_push_constants) },
+			descriptor_binding(0, 0, mDrawDataBuffer),
+			descriptor_binding(0, 1, mDrawBoundsBuffer),
+			descriptor_binding(0, 2, mInstanceGroupCommandsBuffer),
+			descriptor_binding(0, 3, mCulledCommandsBuffers.front()),
+			descriptor_binding(0, 4, mCulledInstanceDrawIndicesBuffers.front()),
+			descriptor_binding(0, 5, mOcclusionCullingBuffers.front()),
+			descriptor_binding(0, 6, mHiZSampler->as_combined_image_sampler(layout::general)),
+			descriptor_binding(0, 7, mOcclusionCandidatesBuffer),
+			descriptor_binding(0, 8, mCullingStatsBuffers.front())
 		);
+	}
+
+	/**	Helper function, which starts the creation of the pipelines which don't depend on the scene on aWorker, at initialization time:
+	 *	 - mSkyboxPipeline is relevant for Bonus Task 2, renders the sky with one fullscreen triangle after the opaque geometry
+	 *	 - mUpscalePipeline upscales the scene into the backbuffer
+	 *	 - mHiZBuildPipeline and mLightClusteringPipeline are the per-frame compute passes
+	 *	They only use the renderpasses, mSceneFramebuffer's image samplers, and the uniform and light buffers, i.e., they can be created
+	 *	while the scene is being loaded. aWorker must have one single thread: avk's pipeline creation (shader modules, descriptor set
+	 *	layouts, pipeline layouts) is not known to be thread-safe, so the pipelines are created one after the other, and no other thread
+	 *	must create pipelines until all of them have completed. The scene load only creates buffers, images, and samplers through avk,
+	 *	and records and submits their uploads, i.e., it does not touch that state. Every task assigns one pipeline member only.
+	 *	@return	The futures of the creations, get() rethrows their exceptions
+	 */
+	std::vector<std::future<void>> create_scene_independent_pipelines(thread_pool& aWorker)
+	{
+		using namespace avk;
+		std::vector<std::future<void>> creations;
+
+		// Create the compute pipeline which builds the depth pyramid, one level per dispatch:
+		creations.push_back(aWorker.submit([this] { mHiZBuildPipeline = context().create_compute_pipeline_for(
+			compute_shader("shaders/hiz_build.comp"),
+			push_constant_binding_data{ shader_type::compute, 0, sizeof(hiz_build_push_constants) },
+			descriptor_binding(0, 0, mSceneDepthSampler->as_combined_image_sampler(layout::shader_read_only_optimal)),
+			descriptor_binding(0, 1, mHiZLevelViews.front()->as_storage_image(layout::general))
+		); }));
+
+		// Create the compute pipeline which assigns the point and spot lights to light clusters:
+		creations.push_back(aWorker.submit([this] { mLightClusteringPipeline = context().create_compute_pipeline_for(
+			compute_shader("shaders/light_clustering.comp"),
+			push_constant_binding_data{ shader_type::compute, 0, sizeof(light_clustering_push_constants) },
+			descriptor_binding(0, 0, mLightsBuffer),
+			descriptor_binding(0, 1, mClusterLightListsBuffers.front()),
+			descriptor_binding(0, 2, mUniformsBuffers.front()) // View matrix, to transform the world-space lights into view space
+		); }));
 
 		// Create the graphics pipeline to be used for drawing the skybox:
 		//
@@ -206,28 +783,160 @@ public:
 		//
 		//					  Hint: See comments of create_graphics_pipeline_for for possible configuration parameters!
 		//
-		mSkyboxPipeline = context().create_graphics_pipeline_for(
+		// The sky is one fullscreen triangle at the far plane (its vertices are generated in the vertex shader, without any vertex buffer).
+		// It is drawn after the opaque geometry, and the depth test lets only those pixels pass that have not been covered by geometry:
+		creations.push_back(aWorker.submit([this] { mSkyboxPipeline = context().create_graphics_pipeline_for(
 			// Shaders to be used with this pipeline:
 			vertex_shader("shaders/sky_gradient.vert"),
 			fragment_shader("shaders/sky_gradient.frag"),
-			from_buffer_binding(0)->stream_per_vertex<glm::vec3>()->to_location(0), // Stream positions from the vertex buffer bound at index #0
 
-			// Use the renderpass created above:
-			// 
-			// TODO Bonus Task 2: Can this renderpass be the right choice here? 
-			// 
-			renderpass,
+			// The shading pass's renderpasses (with or without depth pre-pass) are compatible with this one:
+			mSceneRenderpass,
 
 			// Configuration parameters for this graphics pipeline:
 			cfg::culling_mode::disabled,	// No backface culling required
-			cfg::depth_test::disabled(),	// No depth test required
+			cfg::depth_test::enabled().set_compare_operation(cfg::compare_operation::less_or_equal), // Passes where the depth is still the cleared far plane
 			cfg::depth_write::disabled(),	// Don't write depth values
+			cfg::viewport_depth_scissors_config::from_framebuffer(
+				context().main_window()->backbuffer_reference_at_index(0) // Just use any compatible framebuffer here
+			).enable_dynamic_viewport().enable_dynamic_scissor(), // Set per render scale, see record_skybox_command_buffers
+
+			descriptor_binding(0, 0, mUniformsBuffers.front()) // Doesn't have to be the exact buffer, but one that describes the correct layout for the pipeline.
+		); }));
+
+		// The scene is upscaled from mSceneFramebuffer into the backbuffer with one fullscreen triangle:
+		creations.push_back(aWorker.submit([this] { mUpscalePipeline = context().create_graphics_pipeline_for(
+			vertex_shader("shaders/upscale.vert"),
+			fragment_shader("shaders/upscale.frag"),
+			mUpscaleRenderpass,
+			cfg::culling_mode::disabled,
+			cfg::depth_test::enabled().set_compare_operation(cfg::compare_operation::always), // Write the scene's depth, for the passes after it
+			cfg::depth_write::enabled(),
 			cfg::viewport_depth_scissors_config::from_framebuffer(
 				context().main_window()->backbuffer_reference_at_index(0) // Just use any compatible framebuffer here
 			),
+			push_constant_binding_data{ shader_type::fragment, 0, sizeof(upscale_push_constants) },
+			descriptor_binding(0, 0, mSceneColorSampler->as_combined_image_sampler(layout::shader_read_only_optimal)),
+			descriptor_binding(0, 1, mSceneDepthSampler->as_combined_image_sampler(layout::shader_read_only_optimal))
+		); }));
 
-			descriptor_binding(0, 0, mUniformsBuffer) // Doesn't have to be the exact buffer, but one that describes the correct layout for the pipeline.
-		);
+		return creations;
+	}
+
+	/**	Creates mSceneFramebuffer with the size of the backbuffer, and the image samplers which the upscale pass reads its color and depth with.
+	 *	Its attachments have the backbuffer's formats, s.t. the scene's renderpasses are compatible with it. The previous ones (after a
+	 *	swapchain change) are kept alive until the frames which might still use them have completed.
+	 *	Also creates the depth pyramid for occlusion culling, whose level 0 has half of the backbuffer's size (rounded up).
+	 */
+	void create_scene_framebuffer()
+	{
+		using namespace avk;
+		auto* mainWnd = context().main_window();
+		if (mSceneFramebuffer.has_value()) {
+			mainWnd->handle_lifetime(std::move(mSceneFramebuffer));
+			mainWnd->handle_lifetime(std::move(mSceneColorSampler));
+			mainWnd->handle_lifetime(std::move(mSceneDepthSampler));
+			mainWnd->handle_lifetime(std::move(mHiZSampler));
+			for (auto& levelView : mHiZLevelViews) {
+				mainWnd->handle_lifetime(std::move(levelView));
+			}
+			mainWnd->handle_lifetime(std::move(mHiZImage));
+		}
+
+		const auto resolution = mainWnd->resolution();
+		const auto backbuffer = mainWnd->backbuffer_reference_at_index(0);
+		auto colorView = context().create_image_view(context().create_image(resolution.x, resolution.y, backbuffer->image_view_at(0)->get_image().format(), 1,
+			memory_usage::device, image_usage::general_color_attachment | image_usage::sampled));
+		auto depthView = context().create_depth_image_view(context().create_image(resolution.x, resolution.y, backbuffer->image_view_at(1)->get_image().format(), 1,
+			memory_usage::device, image_usage::general_depth_stencil_attachment | image_usage::sampled));
+		mSceneColorSampler = context().create_image_sampler(colorView, context().create_sampler(filter_mode::bilinear, border_handling_mode::clamp_to_edge));
+		mSceneDepthSampler = context().create_image_sampler(depthView, context().create_sampler(filter_mode::nearest_neighbor, border_handling_mode::clamp_to_edge));
+		mSceneFramebuffer = context().create_framebuffer(mSceneRenderpass, { std::move(colorView), std::move(depthView) }, resolution.x, resolution.y);
+		mSceneExtent = vk::Extent2D{ resolution.x, resolution.y };
+		mSceneFramebufferOutdated = false;
+
+		// Every level halves the previous one's size (rounded up), down to 1x1. The storage image views write one level each:
+		const auto hizWidth = (resolution.x + 1u) / 2u;
+		const auto hizHeight = (resolution.y + 1u) / 2u;
+		mHiZLevelCount = 1u + static_cast<uint32_t>(std::floor(std::log2(static_cast<float>(std::max(hizWidth, hizHeight)))));
+		mHiZImage = context().create_image(hizWidth, hizHeight, vk::Format::eR32Sfloat, 1, memory_usage::device, image_usage::general_storage_image | image_usage::sampled,
+			[levels = mHiZLevelCount](image_t& aImage) { aImage.create_info().setMipLevels(levels); });
+		mHiZLevelViews.clear();
+		for (uint32_t level = 0; level < mHiZLevelCount; ++level) {
+			mHiZLevelViews.push_back(context().create_image_view(mHiZImage, {}, {}, [level](image_view_t& aImageView) {
+				aImageView.create_info().subresourceRange.setBaseMipLevel(level).setLevelCount(1u);
+			}));
+		}
+		mHiZSampler = context().create_image_sampler(context().create_image_view(mHiZImage), context().create_sampler(filter_mode::nearest_neighbor, border_handling_mode::clamp_to_edge));
+		mHiZLayoutUndefined = true; // Transitioned into the general layout before it is built for the first time
+		mHiZValid = false;
+		mDescriptorSetsBaked = false; // The culling pass's descriptor sets refer to the depth pyramid
+	}
+
+	/**	Draws the CPU profiler's frame-time history as one bar per frame, stacked by the main thread's top-level scopes (in their colors,
+	 *	see the legend below it), and what is left of the frame outside of them in gray. The GPU times of the frames are drawn as a line.
+	 */
+	static void draw_frame_time_graph(const cpu_profiler& aProfiler, float aHeight)
+	{
+		const auto& names = aProfiler.stacked_scope_names();
+		const auto color = [&names](size_t aScope) { return static_cast<ImU32>(ImColor::HSV(static_cast<float>(aScope) / static_cast<float>(std::max<size_t>(names.size(), 1)), 0.6f, 0.9f)); };
+		const auto numFrames = aProfiler.history_size();
+		// Scaled to the slowest frame, in steps of 4 ms:
+		float maxMs = 4.0f;
+		for (size_t i = 0; i < numFrames; ++i) {
+			maxMs = std::max({ maxMs, aProfiler.history(i).mFrameMs, aProfiler.history(i).mGpuMs });
+		}
+		maxMs = std::ceil(maxMs / 4.0f) * 4.0f;
+
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		const ImVec2 size{ std::max(ImGui::GetContentRegionAvail().x, 1.0f), aHeight };
+		ImGui::Dummy(size);
+		const bool hovered = ImGui::IsItemHovered();
+		auto* drawList = ImGui::GetWindowDrawList();
+		drawList->AddRectFilled(origin, ImVec2{ origin.x + size.x, origin.y + size.y }, IM_COL32(30, 30, 30, 255));
+		const float barWidth = size.x / static_cast<float>(cpu_profiler::sHistoryLength);
+		const float pixelsPerMs = size.y / maxMs;
+		const float left = origin.x + size.x - barWidth * static_cast<float>(numFrames); // The newest frame is on the right
+		for (size_t i = 0; i < numFrames; ++i) {
+			const auto& frame = aProfiler.history(i);
+			const float x0 = left + barWidth * static_cast<float>(i);
+			float y = origin.y + size.y;
+			for (size_t s = 0; s < names.size(); ++s) {
+				const float h = frame.mStackedMs[s] * pixelsPerMs;
+				drawList->AddRectFilled(ImVec2{ x0, y - h }, ImVec2{ x0 + barWidth, y }, color(s));
+				y -= h;
+			}
+			drawList->AddRectFilled(ImVec2{ x0, std::max(origin.y, origin.y + size.y - frame.mFrameMs * pixelsPerMs) }, ImVec2{ x0 + barWidth, y }, IM_COL32(90, 90, 90, 255));
+			if (i > 0) {
+				drawList->AddLine(
+					ImVec2{ x0 - 0.5f * barWidth, origin.y + size.y - aProfiler.history(i - 1).mGpuMs * pixelsPerMs },
+					ImVec2{ x0 + 0.5f * barWidth, origin.y + size.y - frame.mGpuMs * pixelsPerMs }, IM_COL32(255, 255, 255, 255)
+				);
+			}
+		}
+		drawList->AddText(ImVec2{ origin.x + 2.0f, origin.y }, IM_COL32(255, 255, 255, 160), std::format("{:.0f} ms", maxMs).c_str());
+
+		// The hovered frame's times:
+		const auto hoveredFrame = static_cast<int64_t>(std::floor((ImGui::GetIO().MousePos.x - left) / barWidth));
+		if (hovered && hoveredFrame >= 0 && hoveredFrame < static_cast<int64_t>(numFrames)) {
+			const auto& frame = aProfiler.history(static_cast<size_t>(hoveredFrame));
+			ImGui::BeginTooltip();
+			ImGui::Text("Frame %llu: %.3f ms, %s (%.3f ms GPU)", static_cast<unsigned long long>(frame.mFrameNumber), frame.mFrameMs, frame.is_gpu_bound() ? "GPU-bound" : "CPU-bound", frame.mGpuMs);
+			float tracked = 0.0f;
+			for (size_t s = 0; s < names.size(); ++s) {
+				ImGui::TextColored(ImColor{ color(s) }, "%s: %.3f ms", names[s], frame.mStackedMs[s]);
+				tracked += frame.mStackedMs[s];
+			}
+			ImGui::TextColored(ImColor{ IM_COL32(150, 150, 150, 255) }, "Outside (submit, present): %.3f ms", std::max(frame.mFrameMs - tracked, 0.0f));
+			ImGui::EndTooltip();
+		}
+		// The legend:
+		for (size_t s = 0; s < names.size(); ++s) {
+			if (s > 0) {
+				ImGui::SameLine();
+			}
+			ImGui::TextColored(ImColor{ color(s) }, "%s", names[s]);
+		}
 	}
 
 	/**	Helper function, which sets up drawing of the GUI at initialization time.
@@ -244,21 +953,27 @@ public:
 
 		// Install a callback which will be invoked each time imguiManager's render() is invoked by the framework:
 		imguiManager->add_callback([this, imguiManager] {
+			// While benchmarking, only the progress is shown, s.t. the GUI costs the same in every run:
+			if (mBenchmark.has_value()) {
+				ImGui::Begin("Benchmark");
+				ImGui::SetWindowPos(ImVec2(1.0f, 1.0f), ImGuiCond_FirstUseEver);
+				ImGui::Text("%s", mBenchmark->progress().c_str());
+				ImGui::End();
+				return;
+			}
+
+			const cpu_profiler::scope profileGui{ "GUI" };
 			ImGui::Begin("Settings");
 			ImGui::SetWindowPos(ImVec2(1.0f, 1.0f), ImGuiCond_FirstUseEver);
 			ImGui::Text("%.3f ms (%.1f fps)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
-			static std::vector<float> accum; // accumulate (then average) 10 frames
-			accum.push_back(ImGui::GetIO().Framerate);
-			static std::vector<float> values;
-			if (accum.size() == 10) {
-				values.push_back(std::accumulate(std::begin(accum), std::end(accum), 0.0f) / 10.0f);
-				accum.clear();
-			}
-			if (values.size() > 90) { // Display up to 90(*10) history frames
-				values.erase(values.begin());
+			// The CPU times of the last frames, stacked by the main thread's top-level scopes, with the GPU times on top:
+			const auto& cpuProfiler = cpu_profiler::get();
+			draw_frame_time_graph(cpuProfiler, 60.0f);
+			if (cpuProfiler.history_size() > 0) {
+				const auto& lastFrame = cpuProfiler.last_frame();
+				ImGui::Text("%s: %.3f ms CPU work, %.3f ms GPU", lastFrame.is_gpu_bound() ? "GPU-bound" : "CPU-bound", lastFrame.busy_ms(), lastFrame.mGpuMs);
 			}
-			ImGui::PlotLines("FPS", values.data(), static_cast<int>(values.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 50.0f));
 
 			ImGui::Separator();
 			bool quakeCamEnabled = mQuakeCam.is_enabled();
@@ -292,6 +1007,126 @@ public:
 
 			// TODO Bonus Task 1: Add a control to toggle non-orthogonal tangent space calculations
 
+			ImGui::Separator();
+			// GUI elements for A/B-comparing different ways of recording the scene's draw calls:
+			ImGui::Text("Scene Rendering Settings:");
+			ImGui::Checkbox("Indirect drawing", &mUseIndirectDrawing);
+			ImGui::Checkbox("Pre-baked descriptor sets", &mUsePrebakedDescriptorSets);
+			ImGui::Checkbox("Reuse scene command buffers", &mReuseSceneCommandBuffers);
+			if (mReuseSceneCommandBuffers) {
+				ImGui::SameLine();
+				ImGui::TextUnformatted(mReusedSceneRecordings > 0 ? "(reused)" : "(recorded)");
+			}
+			if (auto* recorder = avk::current_composition()->element_by_type<frame_recorder>()) {
+				ImGui::Text("%.3f ms CPU recording (%zu draws, %zu threads)", recorder->recording_time_ms(), mDrawCalls.size(), recorder->number_of_worker_threads());
+			}
+			ImGui::Text("Vertex format: %s", mVertexFormat == helpers::vertex_format::compact ? "compact (20 B/vertex)" : "full precision (56 B/vertex)");
+			ImGui::Text("Default tiling variant: %u of %u instance groups", mInstanceGroupCount - mFirstDefaultTilingInstanceGroup, mInstanceGroupCount);
+			const char* cullingModes[] = { "Off", "CPU (SIMD)", "GPU (compute)" };
+			int cullingMode = static_cast<int>(mCullingMode);
+			if (ImGui::Combo("Frustum culling", &cullingMode, cullingModes, IM_ARRAYSIZE(cullingModes))) {
+				mCullingMode = static_cast<culling_mode>(cullingMode);
+			}
+			if (mCullingMode == culling_mode::cpu) {
+				ImGui::Text("%.3f ms CPU culling, %zu of %zu draws visible", mCullingTimeMs, mVisibleDrawIndices.size(), mDrawCalls.size());
+			}
+			else if (mCullingMode == culling_mode::gpu) {
+				ImGui::TextWrapped(is_gpu_culling_supported()
+					? "Always draws indirectly, the visible instance counts stay on the GPU (in loading order)"
+					: "Requires geometry_layout::merged_buffers, not culling");
+				ImGui::Checkbox("HiZ occlusion culling", &mUseOcclusionCulling);
+				// Read back from the culling pass of the frame which has used the current frame's frame-in-flight index before:
+				ImGui::Text("%u of %zu draws drawn (%u in the late pass)", mCullingStats.mDrawnInstances, mDrawCalls.size(), mCullingStats.mLateDrawnInstances);
+				ImGui::Text("Culled: %u by frustum, %u occluded", mCullingStats.mFrustumCulledInstances, mCullingStats.mOccludedInstances);
+				ImGui::Text("%u non-empty instanced draws, %.2fM of %.2fM triangles",
+					mCullingStats.mDrawnCommands, static_cast<float>(mCullingStats.mDrawnTriangles) * 1e-6f,
+					static_cast<float>(mCullingStats.mDrawnTriangles + mCullingStats.mCulledTriangles) * 1e-6f);
+			}
+			if (mCullingMode != culling_mode::gpu || !is_gpu_culling_supported()) {
+				const char* drawOrders[] = { "Scene", "Material, front to back", "Front to back, material" };
+				int drawOrder = static_cast<int>(mDrawOrder);
+				if (ImGui::Combo("Draw order", &drawOrder, drawOrders, IM_ARRAYSIZE(drawOrders))) {
+					mDrawOrder = static_cast<draw_sorting::order>(drawOrder);
+				}
+				ImGui::Text("%.3f ms sorting, %zu instanced draws (%u instance groups)", mSortTimeMs, mInstancedDraws.size(), mInstanceGroupCount);
+			}
+			ImGui::Checkbox("Clustered light culling", &mUseClusteredShading);
+			ImGui::Checkbox("Depth pre-pass", &mUseDepthPrePass);
+			if (mUseDepthPrePass && mUseOcclusionCulling && mCullingMode == culling_mode::gpu && is_gpu_culling_supported()) {
+				ImGui::SameLine();
+				ImGui::TextUnformatted("(off with occlusion culling)");
+			}
+			if (mAsyncCompute.is_available()) {
+				ImGui::Checkbox("Async compute (culling, clustering)", &mUseAsyncCompute);
+			}
+			else {
+				ImGui::TextUnformatted("Async compute: no separate compute queue");
+			}
+			ImGui::Checkbox("Mesh LODs", &mUseMeshLods);
+			if (mUseMeshLods) {
+				ImGui::SliderFloat("LOD 0 radius (px)", &mLodReferenceRadius, 16.0f, 2048.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+				if (mCullingMode != culling_mode::gpu || !is_gpu_culling_supported()) {
+					ImGui::Text("Draws per LOD: %zu / %zu / %zu / %zu", mLodDrawCounts[0], mLodDrawCounts[1], mLodDrawCounts[2], mLodDrawCounts[3]);
+				}
+			}
+
+			ImGui::Separator();
+			// GUI elements for the render scale, which the scene is rendered at before it is upscaled into the backbuffer:
+			ImGui::Text("Dynamic Resolution:");
+			auto& dynRes = mDynamicResolution.get_settings();
+			ImGui::Checkbox("Dynamic resolution", &dynRes.mEnabled);
+			if (dynRes.mEnabled) {
+				ImGui::SliderFloat("Target GPU time (ms)", &dynRes.mTargetFrameTimeMs, 2.0f, 50.0f, "%.1f");
+				ImGui::SliderFloat("Min. scale", &dynRes.mMinScale, dynamic_resolution::sLowestScale, 1.0f, "%.2f");
+			}
+			ImGui::SliderFloat(dynRes.mEnabled ? "Max. scale" : "Scale", &dynRes.mMaxScale, dynamic_resolution::sLowestScale, 1.0f, "%.2f");
+			ImGui::SliderFloat("Sharpness", &mSharpness, 0.0f, 1.0f, "%.2f");
+			ImGui::Text("Render scale %.3f (%ux%u), %.3f ms GPU", mDynamicResolution.scale(), mRenderExtent.width, mRenderExtent.height, mDynamicResolution.smoothed_frame_time_ms());
+
+			ImGui::Separator();
+			// GPU times of the profiler's scopes, resolved some frames later (min/avg/p99 over the last frames they have been recorded in):
+			if (ImGui::CollapsingHeader("GPU profiler")) {
+				const auto showScopes = [](const gpu_profiler& aProfiler) {
+					for (const auto& path : aProfiler.scope_paths()) {
+						const auto s = aProfiler.summary(path);
+						ImGui::Indent(static_cast<float>(aProfiler.scope_depth(path)) * 8.0f + 1.0f);
+						ImGui::Text("%s: %.3f ms (min %.3f, avg %.3f, p99 %.3f)", path.substr(path.find_last_of('/') + 1).c_str(), s.mLastMs, s.mMinMs, s.mAvgMs, s.mP99Ms);
+						ImGui::Unindent(static_cast<float>(aProfiler.scope_depth(path)) * 8.0f + 1.0f);
+					}
+				};
+				showScopes(mGpuProfiler);
+				// The compute passes on the compute queue overlap with the graphics work, i.e., they are not part of its "Frame" scope:
+				if (mAsyncCompute.is_available() && !mComputeGpuProfiler.scope_paths().empty()) {
+					ImGui::TextUnformatted("Compute queue:");
+					showScopes(mComputeGpuProfiler);
+				}
+				if (ImGui::Button("Export Chrome trace")) {
+					mGpuProfiler.export_chrome_trace("gpu_trace.json");
+				}
+			}
+			// CPU times of all scopes (on all threads), summed up per frame (avg/max over the frame-time history):
+			if (ImGui::CollapsingHeader("CPU profiler")) {
+				auto& profiler = cpu_profiler::get();
+				for (const auto* name : profiler.scope_names()) {
+					const auto s = profiler.summary(name);
+					ImGui::Indent(static_cast<float>(profiler.scope_depth(name)) * 8.0f + 1.0f);
+					ImGui::Text("%s: %.3f ms in %u (avg %.3f, max %.3f)", name, s.mLastMs, s.mLastCalls, s.mAvgMs, s.mMaxMs);
+					ImGui::Unindent(static_cast<float>(profiler.scope_depth(name)) * 8.0f + 1.0f);
+				}
+				if (profiler.lost_events() > 0) {
+					ImGui::Text("%llu events lost", static_cast<unsigned long long>(profiler.lost_events()));
+				}
+				bool streaming = profiler.is_streaming();
+				if (ImGui::Checkbox("Stream Chrome trace (cpu_trace.json)", &streaming)) {
+					if (streaming) {
+						profiler.start_trace_stream("cpu_trace.json");
+					}
+					else {
+						profiler.stop_trace_stream();
+					}
+				}
+			}
+
 			ImGui::Separator();
 			// GUI elements for the light sources, enables showing/hiding light gizmos, and the light source editor:
 			bool enableGizmos = helpers::are_lightsource_gizmos_enabled();
@@ -348,15 +1183,48 @@ public:
 			.invoke([this]{ // Fix camera aspect ratios:
 				mOrbitCam.set_aspect_ratio(context().main_window()->aspect_ratio());
 				mQuakeCam.set_aspect_ratio(context().main_window()->aspect_ratio());
+				mDescriptorSetsBaked = false; // Bake the descriptor sets again before they are used next
+				mSkyboxCommandBuffersOutdated = true; // The skybox pipeline's viewport has changed
+				++mSceneRecordingGeneration; // and so have the scene pipelines'
+				mSceneFramebufferOutdated = true; // The scene is rendered at the new backbuffer size
 			}) 
 			.update(mPipeline) // Update the pipeline after the swap chain has changed
-			.update(mSkyboxPipeline); // and the pipeline for drawing the skybox as well
+			.update(mDepthPrePassPipeline) // and the pipelines of the depth pre-pass mode
+			.update(mPipelineAfterDepthPrePass)
+			.update(mPipelineDefaultTiling) // and their variants for default texture tiling
+			.update(mPipelineAfterDepthPrePassDefaultTiling)
+			.update(mSkyboxPipeline) // and the pipeline for drawing the skybox as well
+			.update(mUpscalePipeline); // and the one which upscales the scene into the backbuffer
 
 		// Also enable shader hot reloading via the updater:
 		mUpdater->on(shader_files_changed_event(mPipeline.as_reference()))
+			.invoke([this]{ mDescriptorSetsBaked = false; ++mSceneRecordingGeneration; }) // The descriptor set layouts might have changed
 			.update(mPipeline);
+		mUpdater->on(shader_files_changed_event(mDepthPrePassPipeline.as_reference()))
+			.invoke([this]{ mDescriptorSetsBaked = false; ++mSceneRecordingGeneration; }) // The descriptor set layouts might have changed
+			.update(mDepthPrePassPipeline);
+		mUpdater->on(shader_files_changed_event(mPipelineAfterDepthPrePass.as_reference()))
+			.invoke([this]{ mDescriptorSetsBaked = false; ++mSceneRecordingGeneration; }) // The descriptor set layouts might have changed
+			.update(mPipelineAfterDepthPrePass);
+		mUpdater->on(shader_files_changed_event(mPipelineDefaultTiling.as_reference()))
+			.invoke([this]{ mDescriptorSetsBaked = false; ++mSceneRecordingGeneration; }) // The descriptor set layouts might have changed
+			.update(mPipelineDefaultTiling);
+		mUpdater->on(shader_files_changed_event(mPipelineAfterDepthPrePassDefaultTiling.as_reference()))
+			.invoke([this]{ mDescriptorSetsBaked = false; ++mSceneRecordingGeneration; }) // The descriptor set layouts might have changed
+			.update(mPipelineAfterDepthPrePassDefaultTiling);
 		mUpdater->on(shader_files_changed_event(mSkyboxPipeline.as_reference()))
+			.invoke([this]{ mSkyboxCommandBuffersOutdated = true; }) // They refer to the old pipeline
 			.update(mSkyboxPipeline);
+		mUpdater->on(shader_files_changed_event(mUpscalePipeline.as_reference()))
+			.update(mUpscalePipeline);
+		mUpdater->on(shader_files_changed_event(mCullingPipeline.as_reference()))
+			.invoke([this]{ mDescriptorSetsBaked = false; }) // The descriptor set layouts might have changed
+			.update(mCullingPipeline);
+		mUpdater->on(shader_files_changed_event(mLightClusteringPipeline.as_reference()))
+			.invoke([this]{ mDescriptorSetsBaked = false; }) // The descriptor set layouts might have changed
+			.update(mLightClusteringPipeline);
+		mUpdater->on(shader_files_changed_event(mHiZBuildPipeline.as_reference()))
+			.update(mHiZBuildPipeline); // Its descriptor sets are looked up in every frame
 	}
 
 	// ----------------------- ^^^   INITIALIZATION   ^^^ -----------------------
@@ -370,6 +1238,11 @@ public:
 	{
 		using namespace avk;
 
+		// A frame begins with the first update() callback (this invokee's). Everything between the previous frame's last callback and this one
+		// (acquiring the next swap chain image, waiting for its frame in flight's fence, presenting) is not covered by any of the CPU profiler's scopes:
+		cpu_profiler::get().begin_frame(last_resolved_gpu_frame_time_ms().value_or(0.0f));
+		const cpu_profiler::scope profileUpdate{ "Update" };
+
 		// Keep the cameras sync to make life easier:
 		if (mQuakeCam.is_enabled()) {
 			mOrbitCam.set_matrix(mQuakeCam.matrix());
@@ -378,6 +1251,13 @@ public:
 			mQuakeCam.set_matrix(mOrbitCam.matrix());
 		}
 
+		// In benchmark mode, the benchmark advances the frames (once the scene has been loaded), and everything is torn down after its last run:
+		if (mBenchmark.has_value() && !mAsyncUploader.has_pending_uploads() && !mBenchmark->next_frame(mGpuProfiler)) {
+			mBenchmark->write_report();
+			mBenchmark.reset();
+			avk::current_composition()->stop();
+		}
+
 		// Escape tears everything down (if quake camera is not active):
 		if (!mQuakeCam.is_enabled() && avk::input().key_pressed(avk::key_code::escape) || avk::context().main_window()->should_be_closed()) {
 			// Stop the current composition:
@@ -404,158 +1284,1132 @@ public:
 		//              Hint: There is more than the one issue with the code!
 
 		using namespace avk;
+		// The commands are recorded and submitted in frame_recorder's render() callback, this one prepares the passes and their jobs:
+		const cpu_profiler::scope profileRender{ "Render" };
 
-		// As described above, we get a semaphore from the framework which will get signaled as soon as
-		// the next swap chain image becomes available. Only after it has become available, we may start
-		// rendering the current frame into it.
-		// We get the semaphore here, and use it further down to describe a dependency of our recorded commands:
-		auto imageAvailableSemaphore = context().main_window()->consume_current_image_available_semaphore();
+		// As described above, we must wait for the next swap chain image to become available before rendering into it.
+		// The frame_recorder, which submits all the commands recorded below, consumes the semaphore and waits for it.
+
+		// The scene is rendered at a fraction of the backbuffer's size, which follows the GPU times of the frames:
+		if (mSceneFramebufferOutdated) {
+			create_scene_framebuffer();
+		}
+		update_render_extent();
 
-		
 		// Update the data in our uniform buffers:
 		matrices_and_user_input uni;
 		uni.mViewMatrix = mQuakeCam.view_matrix();
 		uni.mProjMatrix = mQuakeCam.projection_matrix();
 		uni.mCamPos     = glm::translate(mQuakeCam.translation());
 		uni.mUserInput  = glm::vec4{ mNormalMappingStrength };
+		// The clusters' screen tiles cover the whole rendered part, the last row/column of tiles might extend beyond it:
+		const auto resolution = glm::uvec2{ mRenderExtent.width, mRenderExtent.height };
+		const auto clusterTileSize = glm::ceil(glm::vec2{ resolution } / glm::vec2{ LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y });
+		uni.mClusteringParams = glm::vec4{ mQuakeCam.near_plane_distance(), mQuakeCam.far_plane_distance(), mUseClusteredShading ? 1.0f : 0.0f, 0.0f };
+		uni.mClusterTileSize  = glm::vec4{ clusterTileSize, 0.0f, 0.0f };
 		// Since this buffer has its backing memory in a "host visible" memory region, we just need to write the new data to it.
 		// No need to submit the (empty, in this case!) action_type_command that is returned by buffer_t::fill() to a queue.
-		// If its backing memory was in a "device" memory region, we would have to, though (see lights buffer below for the difference!).
-		mUniformsBuffer->fill(&uni, 0);
+		// It is the buffer of the current frame in flight, whose previous use by the GPU has completed when its index comes around again:
+		const auto inFlightIndex = context().main_window()->in_flight_index_for_frame();
+		mUniformsBuffers[inFlightIndex]->fill(&uni, 0);
+		read_culling_stats(inFlightIndex);
+
+		// GPU culling draws all draw calls which pass the culling test, hence, all of their geometry must have been uploaded:
+		const bool useGpuCulling = mCullingMode == culling_mode::gpu && is_gpu_culling_supported() && !mAsyncUploader.has_pending_uploads();
+		// Occlusion culling splits the GPU culling pass into two phases around the shading pass which lays down the depth pyramid's input,
+		// a depth pre-pass would be redundant with it:
+		const bool useOcclusionCulling = useGpuCulling && mUseOcclusionCulling;
+		const bool useDepthPrePass = mUseDepthPrePass && !useOcclusionCulling;
+		// The compute passes are submitted to the compute queue if there is a separate one (see async_compute), otherwise they are
+		// recorded into the frame's command buffer. The light clustering on the compute queue reads its own copies of the inputs.
+		// The phases of occlusion culling depend on the frame's rendering, they stay on the graphics queue:
+		const bool useAsyncCompute = mUseAsyncCompute && mAsyncCompute.is_available() && ((useGpuCulling && !useOcclusionCulling) || mUseClusteredShading);
+		const bool cullingOnComputeQueue = useAsyncCompute && useGpuCulling && !useOcclusionCulling;
+		const bool lightsOnComputeQueue = useAsyncCompute && mUseClusteredShading;
+		if (useAsyncCompute && mAsyncCompute.needs_ownership_transfer()) {
+			mComputeUniformsBuffers[inFlightIndex]->fill(&uni, 0);
+		}
+
+		{
+			const cpu_profiler::scope profileLights{ "Light animation and upload" };
+			// Animate lights (frozen at their initial positions while benchmarking, s.t. every run renders the same frames):
+			static auto startTime = static_cast<float>(context().get_time());
+			helpers::animate_lights(helpers::get_lights(), mBenchmark.has_value() ? 0.0f : static_cast<float>(context().get_time()) - startTime);
+
+			// Update the data in our light sources buffer, only the changed parts of it are written and uploaded. mComputeLightsBuffer misses
+			// the changes of the frames in which the light clustering has not run on the compute queue, in which case all of it is uploaded again:
+			if (lightsOnComputeQueue && !mComputeLightsUpToDate) {
+				mLightsActiveSetVersion = ~uint64_t{ 0 };
+			}
+			mComputeLightsUpToDate = lightsOnComputeQueue;
+			update_lights_data(inFlightIndex, lightsOnComputeQueue);
+		}
+		const light_clustering_push_constants lightClusteringPushConstants{
+			glm::inverse(uni.mProjMatrix),
+			glm::vec4{ clusterTileSize, glm::vec2{ resolution } },
+			glm::vec4{ uni.mClusteringParams.x, uni.mClusteringParams.y, 0.0f, 0.0f }
+		};
+
+		// The pre-baked descriptor sets are (re-)created after initialization, and after swapchain or shader changes:
+		if (mUsePrebakedDescriptorSets && !mDescriptorSetsBaked) {
+			const cpu_profiler::scope profileBaking{ "Descriptor lookup" };
+			bake_descriptor_sets();
+		}
+
+		// Cull the scene's draw calls against the camera's view frustum, either right here on the CPU, or in a compute pass:
+		const auto frustumPlanes = frustum_culling::extract_frustum_planes(mQuakeCam.projection_matrix() * mQuakeCam.view_matrix());
+		// The levels of detail are selected from the projected radii of the draw calls' bounds (in pixels, relative to mLodReferenceRadius):
+		const auto lodParams = mUseMeshLods
+			? glm::vec4{ mQuakeCam.translation(), 0.5f * static_cast<float>(resolution.y) * std::abs(uni.mProjMatrix[1][1]) / mLodReferenceRadius }
+			: glm::vec4{ 0.0f };
+		// The early occlusion culling phase tests against the previous frame's depth pyramid, with the matrix and extent it has been built with:
+		if (useOcclusionCulling) {
+			const occlusion_culling_data occlusionCullingData{
+				uni.mProjMatrix * uni.mViewMatrix, mHiZViewProjMatrix,
+				glm::uvec4{ resolution, mHiZRenderExtent },
+				glm::uvec4{ mHiZLevelCount, mHiZValid ? 1u : 0u, 0u, 0u }
+			};
+			mOcclusionCullingBuffers[inFlightIndex]->fill(&occlusionCullingData, 0);
+			mHiZViewProjMatrix = occlusionCullingData.mViewProjMatrix;
+			mHiZRenderExtent   = resolution;
+		}
+		mHiZValid = useOcclusionCulling; // Not built in this frame otherwise
+		if (mCullingMode == culling_mode::cpu) {
+			const cpu_profiler::scope profileCulling{ "CPU culling" };
+			const auto cullingStart = std::chrono::high_resolution_clock::now();
+			mFrustumCulling.cull(frustumPlanes, mVisibleDrawIndices);
+			const std::chrono::duration<float, std::milli> cullingTime = std::chrono::high_resolution_clock::now() - cullingStart;
+			mCullingTimeMs = mCullingTimeMs * 0.9f + cullingTime.count() * 0.1f;
+		}
+		else if (mVisibleDrawIndices.size() != mDrawCalls.size()) {
+			// Not culled on the CPU => all draw calls are to be recorded
+			mVisibleDrawIndices.resize(mDrawCalls.size());
+			std::iota(std::begin(mVisibleDrawIndices), std::end(mVisibleDrawIndices), 0u);
+		}
+		// Draw calls whose geometry is still being uploaded are skipped, the scene streams in as the uploads complete:
+		if (mAsyncUploader.has_pending_uploads()) {
+			const auto completedUploads = mAsyncUploader.completed_value();
+			std::erase_if(mVisibleDrawIndices, [&](uint32_t i) { return mDrawCalls[i].mUploadValue > completedUploads; });
+		}
+		// Consecutive visible draw calls of the same instance group are drawn with one instanced draw:
+		if (!useGpuCulling) {
+			const cpu_profiler::scope profileInstancedDraws{ "Instanced draws" };
+			update_instanced_draws(inFlightIndex, lodParams, uni.mViewMatrix);
+		}
 
-		// Animate lights:
-		static auto startTime = static_cast<float>(context().get_time());
-		helpers::animate_lights(helpers::get_lights(), static_cast<float>(context().get_time()) - startTime);
+		// The frame_recorder records the scene's draw calls in chunks on worker threads into secondary command buffers, and executes them
+		// after the commands which are recorded before the renderpasses here (compute passes, uploads), all in one single queue submission:
+		auto* recorder = current_composition()->element_by_type<frame_recorder>();
+
+		// The compute passes on the compute queue are submitted right away. They overlap with the graphics work of the previous frame,
+		// the graphics work of this frame waits for them before its first stage which reads their results:
+		const vk::PipelineStageFlags asyncComputeResultStages = vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader;
+		if (useAsyncCompute) {
+			const auto computeValue = mAsyncCompute.submit(inFlightIndex, [&](avk::command_buffer_t& cb) {
+				const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+				mComputeGpuProfiler.begin_frame(vkHppCommandBuffer, inFlightIndex);
+				if (lightsOnComputeQueue && !mLightsUploadRegions.empty()) {
+					record_lights_upload(vkHppCommandBuffer, inFlightIndex, true);
+				}
+				if (cullingOnComputeQueue) {
+					mComputeGpuProfiler.begin_scope(vkHppCommandBuffer, "Frustum culling");
+					record_gpu_culling(cb, inFlightIndex, frustumPlanes, lodParams, true, culling_phase::frustum_only);
+					mComputeGpuProfiler.end_scope(vkHppCommandBuffer);
+				}
+				if (mUseClusteredShading) {
+					mComputeGpuProfiler.begin_scope(vkHppCommandBuffer, "Light clustering");
+					record_light_clustering(cb, inFlightIndex, lightClusteringPushConstants, true);
+					mComputeGpuProfiler.end_scope(vkHppCommandBuffer);
+				}
+				// The memory dependency is established by the timeline semaphores, only the ownership must be transferred:
+				if (mAsyncCompute.needs_ownership_transfer()) {
+					vkHppCommandBuffer.pipelineBarrier(
+						vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe,
+						{}, {}, mAsyncCompute.release_barriers(async_compute_results(inFlightIndex, cullingOnComputeQueue)), {}
+					);
+				}
+			});
+			recorder->wait_for_timeline_semaphore(mAsyncCompute.compute_timeline(), computeValue, asyncComputeResultStages);
+			// The next compute submission with the same frame-in-flight index waits for this one, before it overwrites what this frame reads:
+			recorder->signal_timeline_semaphore(mAsyncCompute.graphics_timeline(), mAsyncCompute.next_graphics_value(inFlightIndex));
+		}
+
+		const auto recordBeforeRenderpasses = [this, inFlightIndex, useGpuCulling, useOcclusionCulling, useAsyncCompute, cullingOnComputeQueue, lightsOnComputeQueue, asyncComputeResultStages, frustumPlanes, lodParams, lightClusteringPushConstants](avk::command_buffer_t& cb) {
+			// Note 1: The Vulkan SDK's command buffer class (from Vulkan-Hpp in this case) provides 
+			//         ALL the commands there are. Use it to record anything into the command buffer:
+			const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+
+			// Resolve the GPU times of the frame which used this frame-in-flight index before (without waiting for them):
+			mGpuProfiler.begin_frame(vkHppCommandBuffer, inFlightIndex);
+			mGpuProfiler.begin_scope(vkHppCommandBuffer, "Frame");
+
+			// Take over the buffers of the completed uploads from the transfer queue, and make their writes visible, before they are used:
+			if (mAsyncUploader.has_pending_uploads()) {
+				mAsyncUploader.record_acquire_barriers_for_completed_uploads(vkHppCommandBuffer);
+			}
+
+			// The copy into the device-local mLightsBuffer is part of the frame's command buffer, s.t. no separate submission is required:
+			if (!mLightsUploadRegions.empty()) {
+				record_lights_upload(vkHppCommandBuffer, inFlightIndex, false);
+			}
+
+			// The results of the compute passes on the compute queue are taken over from its queue family:
+			if (useAsyncCompute && mAsyncCompute.needs_ownership_transfer()) {
+				vkHppCommandBuffer.pipelineBarrier(
+					asyncComputeResultStages, asyncComputeResultStages, {}, {},
+					mAsyncCompute.acquire_barriers(async_compute_results(inFlightIndex, cullingOnComputeQueue), vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead), {}
+				);
+			}
+
+			// The culling and light clustering compute passes must be recorded outside of the renderpass:
+			if (useGpuCulling && !cullingOnComputeQueue) {
+				mGpuProfiler.begin_scope(vkHppCommandBuffer, useOcclusionCulling ? "Occlusion culling (early)" : "Frustum culling");
+				record_gpu_culling(cb, inFlightIndex, frustumPlanes, lodParams, false, useOcclusionCulling ? culling_phase::occlusion_early : culling_phase::frustum_only);
+				mGpuProfiler.end_scope(vkHppCommandBuffer);
+			}
+			if (mUseClusteredShading && !lightsOnComputeQueue) {
+				mGpuProfiler.begin_scope(vkHppCommandBuffer, "Light clustering");
+				record_light_clustering(cb, inFlightIndex, lightClusteringPushConstants, false);
+				mGpuProfiler.end_scope(vkHppCommandBuffer);
+			}
+		};
+
+		// All the scene's pipelines share the same layout, hence, the same descriptor sets. They are retrieved here on the main thread,
+		// because the descriptor cache must not be used by the recording jobs concurrently:
+		const auto descriptorSets = [&] {
+			const cpu_profiler::scope profileDescriptors{ "Descriptor lookup" };
+			return mUsePrebakedDescriptorSets
+				? (useGpuCulling ? mSceneDescriptorSetsGpuCulling[inFlightIndex] : mSceneDescriptorSets[inFlightIndex])
+				: get_scene_descriptor_sets(inFlightIndex, useGpuCulling);
+		}();
+		// Adds one recording job per chunk of instanced draws (or one for the single indirect draw call of GPU culling) to the given pass.
+		// If the same draw calls have been recorded for this frame in flight and pass before, their command buffers are executed again instead:
+		mReusedSceneRecordings = 0;
+		const auto addSceneRecordingJobs = [&](size_t aPass, avk::graphics_pipeline* aPipeline, avk::graphics_pipeline* aDefaultTilingPipeline, scene_recording& aRecording, bool aLatePass) {
+			std::vector<avk::command_buffer>* keepIn = nullptr;
+			if (mReuseSceneCommandBuffers) {
+				const auto signature = scene_recording_signature(*aPipeline, aDefaultTilingPipeline, descriptorSets, useGpuCulling);
+				if (aRecording.mValid && aRecording.mSignature == signature) {
+					for (const auto& cmdBfr : aRecording.mCommandBuffers) {
+						recorder->add_recorded_commands(aPass, *cmdBfr);
+					}
+					++mReusedSceneRecordings;
+					return;
+				}
+				release_scene_recording(aRecording);
+				aRecording.mSignature = signature;
+				aRecording.mValid = true;
+				keepIn = &aRecording.mCommandBuffers;
+			}
+			else if (aRecording.mValid) {
+				release_scene_recording(aRecording);
+			}
+			const size_t numDraws = useGpuCulling ? 1 : mInstancedDraws.size();
+			for (size_t begin = 0; begin < numDraws; begin += sDrawCallsPerRecordingJob) {
+				const size_t end = std::min(begin + sDrawCallsPerRecordingJob, numDraws);
+				recorder->add_job(aPass, [this, aPipeline, aDefaultTilingPipeline, descriptorSets, useGpuCulling, aLatePass, inFlightIndex, begin, end, renderExtent = mRenderExtent](avk::command_buffer_t& cb) {
+					record_scene_draw_calls(cb, *aPipeline, aDefaultTilingPipeline, descriptorSets, useGpuCulling, aLatePass, inFlightIndex, renderExtent, begin, end);
+				}, keepIn);
+			}
+		};
+		if (mSceneRecordings.size() != context().main_window()->number_of_frames_in_flight()) {
+			mSceneRecordings.resize(context().main_window()->number_of_frames_in_flight());
+		}
+		auto& sceneRecordings = mSceneRecordings[inFlightIndex];
+
+		if (useDepthPrePass) {
+			// Lay down the depth of all visible geometry first, s.t. the shading pass only shades the visible fragments:
+			const auto depthPrePass = recorder->add_pass(
+				mDepthPrePassPipeline->renderpass_reference(), mSceneFramebuffer.as_reference(),
+				[this, recordBeforeRenderpasses](avk::command_buffer_t& cb) {
+					recordBeforeRenderpasses(cb);
+					mGpuProfiler.begin_scope(cb.handle(), "Depth pre-pass");
+				},
+				[this](avk::command_buffer_t& cb) { mGpuProfiler.end_scope(cb.handle()); },
+				mRenderExtent
+			);
+			addSceneRecordingJobs(depthPrePass, &mDepthPrePassPipeline, nullptr, sceneRecordings[0], false); // No fragment shader => no variants
+		}
+
+		// With a depth pre-pass, the shading pass must use the pipeline and renderpass which keep the pre-pass's depth:
+		auto& shadingPipeline = useDepthPrePass ? mPipelineAfterDepthPrePass : mPipeline;
+		auto& defaultTilingShadingPipeline = useDepthPrePass ? mPipelineAfterDepthPrePassDefaultTiling : mPipelineDefaultTiling;
+		const auto shadingPass = recorder->add_pass(
+			shadingPipeline->renderpass_reference(), // <-- Use the renderpass of the shading pipeline,
+			mSceneFramebuffer.as_reference(), // <-- render into the scene's framebuffer, which is upscaled into the window's backbuffer afterwards
+			[this, recordBeforeRenderpasses, useDepthPrePass](avk::command_buffer_t& cb) {
+				if (!useDepthPrePass) {
+					recordBeforeRenderpasses(cb);
+				}
+				mGpuProfiler.begin_scope(cb.handle(), "Shading pass");
+			},
+			[this](avk::command_buffer_t& cb) { mGpuProfiler.end_scope(cb.handle()); },
+			mRenderExtent // <-- only the part of it which is rendered at the current render scale
+		);
+		addSceneRecordingJobs(shadingPass, &shadingPipeline, &defaultTilingShadingPipeline, sceneRecordings[1], false);
+
+		// With occlusion culling, the shading pass has drawn what has been visible in the previous frame. Its depth is reduced into the
+		// depth pyramid, against which the rest is tested again, and the newly visible draw calls are drawn on top in the late shading pass:
+		auto skyPass = shadingPass;
+		if (useOcclusionCulling) {
+			const auto latePass = recorder->add_pass(
+				mOcclusionLateRenderpass.as_reference(), mSceneFramebuffer.as_reference(),
+				[this, inFlightIndex, frustumPlanes, lodParams, renderExtent = mRenderExtent](avk::command_buffer_t& cb) {
+					const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+					mGpuProfiler.begin_scope(vkHppCommandBuffer, "HiZ build");
+					record_hiz_build(cb, renderExtent);
+					mGpuProfiler.end_scope(vkHppCommandBuffer);
+					mGpuProfiler.begin_scope(vkHppCommandBuffer, "Occlusion culling (late)");
+					record_gpu_culling(cb, inFlightIndex, frustumPlanes, lodParams, false, culling_phase::occlusion_late);
+					mGpuProfiler.end_scope(vkHppCommandBuffer);
+					mGpuProfiler.begin_scope(vkHppCommandBuffer, "Late shading pass");
+				},
+				[this](avk::command_buffer_t& cb) { mGpuProfiler.end_scope(cb.handle()); },
+				mRenderExtent
+			);
+			addSceneRecordingJobs(latePass, &mPipeline, &mPipelineDefaultTiling, sceneRecordings[2], true);
+			skyPass = latePass;
+		}
+
+		// The sky is drawn after the opaque geometry, with the commands which have been recorded for this frame in flight beforehand:
+		if (mSkyboxCommandBuffersOutdated) {
+			record_skybox_command_buffers();
+		}
+		recorder->add_recorded_commands(skyPass, *mSkyboxCommandBuffers[inFlightIndex]);
+
+		// Upscale the rendered part of the scene's color and depth into the window's backbuffer, where the GUI and gizmos are drawn on top:
+		const auto upscalePass = recorder->add_pass(
+			mUpscalePipeline->renderpass_reference(), context().main_window()->current_backbuffer_reference(),
+			[this](avk::command_buffer_t& cb) { mGpuProfiler.begin_scope(cb.handle(), "Upscale"); },
+			[this](avk::command_buffer_t& cb) {
+				mGpuProfiler.end_scope(cb.handle());
+				mGpuProfiler.end_scope(cb.handle()); // Frame
+			}
+		);
+		const upscale_push_constants upscalePushConstants{
+			glm::vec4{ mRenderExtent.width, mRenderExtent.height, 1.0f / static_cast<float>(mSceneExtent.width), 1.0f / static_cast<float>(mSceneExtent.height) },
+			glm::vec4{ mRenderExtent == mSceneExtent ? 0.0f : mSharpness, 0.0f, 0.0f, 0.0f } // Not sharpened if it is not scaled
+		};
+		const auto upscaleDescriptorSets = mDescriptorCache->get_or_create_descriptor_sets({
+			descriptor_binding(0, 0, mSceneColorSampler->as_combined_image_sampler(layout::shader_read_only_optimal)),
+			descriptor_binding(0, 1, mSceneDepthSampler->as_combined_image_sampler(layout::shader_read_only_optimal))
+		});
+		recorder->add_job(upscalePass, [this, upscalePushConstants, upscaleDescriptorSets](avk::command_buffer_t& cb) {
+			cb.record(command::bind_pipeline(mUpscalePipeline.as_reference()));
+			cb.record(command::bind_descriptors(mUpscalePipeline->layout(), upscaleDescriptorSets));
+			cb.record(command::push_constants(mUpscalePipeline->layout(), upscalePushConstants, shader_type::fragment));
+			cb.handle().draw(3u, 1u, 0u, 0u); // One fullscreen triangle
+		});
+	}
+
+	/** Sets the viewport and scissor of the pipelines with dynamic viewports to the part of mSceneFramebuffer which is rendered into */
+	static void set_render_extent_viewport(const vk::CommandBuffer& aCommandBuffer, const vk::Extent2D& aRenderExtent)
+	{
+		aCommandBuffer.setViewport(0u, vk::Viewport{ 0.0f, 0.0f, static_cast<float>(aRenderExtent.width), static_cast<float>(aRenderExtent.height), 0.0f, 1.0f });
+		aCommandBuffer.setScissor(0u, vk::Rect2D{ vk::Offset2D{ 0, 0 }, aRenderExtent });
+	}
+
+	/** GPU time of the "Frame" scope of the frame which mGpuProfiler has resolved most recently, std::nullopt if there is none */
+	std::optional<float> last_resolved_gpu_frame_time_ms() const
+	{
+		const auto& scopes = mGpuProfiler.last_resolved_scopes();
+		const auto frameScope = std::find_if(std::begin(scopes), std::end(scopes), [](const auto& scope) { return scope.first == "Frame"; });
+		if (!mGpuProfiler.last_resolved_frame_number().has_value() || std::end(scopes) == frameScope) {
+			return {};
+		}
+		return frameScope->second;
+	}
+
+	/**	Feeds the GPU time of the most recently resolved frame into mDynamicResolution, and sets mRenderExtent according to its render scale.
+	 *	The skybox's command buffers are recorded again if the extent has changed, the scene's are (see scene_recording_signature).
+	 */
+	void update_render_extent()
+	{
+		const auto frameNumber = mGpuProfiler.last_resolved_frame_number();
+		mDynamicResolution.update(frameNumber.value_or(0), last_resolved_gpu_frame_time_ms().value_or(0.0f), mGpuProfiler.frame_count());
+
+		const auto renderExtent = mDynamicResolution.extent_for(mSceneExtent);
+		if (renderExtent != mRenderExtent) {
+			mRenderExtent = renderExtent;
+			mSkyboxCommandBuffersOutdated = true;
+		}
+	}
 
-		// Update the data in our light sources buffer:
-		auto activeLights = helpers::get_active_lightsources();
-		lightsource_data lightsData{
-			glm::uvec4{
+	/**	Records the commands for drawing the sky into one reusable secondary command buffer per frame in flight, which the shading pass
+	 *	executes after the scene's draw calls. They only have to be recorded again when mSkyboxPipeline has changed (see enable_the_updater),
+	 *	or mRenderExtent (see update_render_extent).
+	 */
+	void record_skybox_command_buffers()
+	{
+		using namespace avk;
+		auto* mainWnd = context().main_window();
+		// The previous command buffers might still be in use by frames in flight:
+		for (auto& cmdBfr : mSkyboxCommandBuffers) {
+			mainWnd->handle_lifetime(std::move(cmdBfr));
+		}
+		mSkyboxCommandBuffers.clear();
+
+		// The shading pass's renderpasses are all compatible with mSkyboxPipeline's, the framebuffer is not known in advance:
+		const vk::CommandBufferInheritanceInfo inheritanceInfo{ mSkyboxPipeline->renderpass_handle(), 0u, nullptr };
+		for (window::frame_id_t fif = 0; fif < mainWnd->number_of_frames_in_flight(); ++fif) {
+			auto cmdBfr = mCommandPool->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eRenderPassContinue, vk::CommandBufferLevel::eSecondary);
+			cmdBfr->handle().begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo });
+			cmdBfr->record(command::bind_pipeline(mSkyboxPipeline.as_reference()));
+			set_render_extent_viewport(cmdBfr->handle(), mRenderExtent);
+			cmdBfr->record(command::bind_descriptors(mSkyboxPipeline->layout(), mDescriptorCache->get_or_create_descriptor_sets({
+				descriptor_binding(0, 0, mUniformsBuffers[fif])
+			})));
+			cmdBfr->handle().draw(3u, 1u, 0u, 0u); // One fullscreen triangle
+			cmdBfr->handle().end();
+			mSkyboxCommandBuffers.push_back(std::move(cmdBfr));
+		}
+		mSkyboxCommandBuffersOutdated = false;
+	}
+
+	/**	Brings mLightsData up to date with the active lights. They are kept in world space, s.t. camera movement does not require any updates.
+	 *	Everything is rebuilt whenever the set of active lights has changed (or if there is no lights editor which tracks changes),
+	 *	otherwise only the lights which the lights editor reports as changed are converted. The changed byte ranges are written into
+	 *	the given frame's staging buffer, and collected in mLightsUploadRegions to be copied into mLightsBuffer by record_lights_upload.
+	 *	@param	aForComputeQueue	Whether they are copied into mComputeLightsBuffer as well, i.e., written into mComputeLightsStagingBuffers, too
+	 */
+	void update_lights_data(avk::window::frame_id_t aInFlightIndex, bool aForComputeQueue)
+	{
+		using namespace avk;
+		mLightsUploadRegions.clear();
+		const auto addRegion = [this](vk::DeviceSize aOffset, vk::DeviceSize aSize) {
+			if (!mLightsUploadRegions.empty() && mLightsUploadRegions.back().srcOffset + mLightsUploadRegions.back().size == aOffset) {
+				mLightsUploadRegions.back().size += aSize; // Adjacent to the previous region
+				return;
+			}
+			mLightsUploadRegions.push_back(vk::BufferCopy{ aOffset, aOffset, aSize });
+		};
+		constexpr vk::DeviceSize lightDataOffset = offsetof(lightsource_data, mLightData);
+
+		auto* lightsEd = current_composition()->element_by_type<lights_editor>();
+		if (nullptr == lightsEd || lightsEd->active_set_version() != mLightsActiveSetVersion) {
+			const auto activeLights = helpers::get_active_lightsources();
+			mLightsData.mRangesAmbientDirectional = glm::uvec4{
 				helpers::get_lightsource_type_begin_index(activeLights, lightsource_type::ambient),
 				helpers::get_lightsource_type_end_index(activeLights, lightsource_type::ambient),
 				helpers::get_lightsource_type_begin_index(activeLights, lightsource_type::directional),
 				helpers::get_lightsource_type_end_index(activeLights, lightsource_type::directional)
-			},
-			glm::uvec4{
+			};
+			mLightsData.mRangesPointSpot = glm::uvec4{
 				helpers::get_lightsource_type_begin_index(activeLights, lightsource_type::point),
 				helpers::get_lightsource_type_end_index(activeLights, lightsource_type::point),
 				helpers::get_lightsource_type_begin_index(activeLights, lightsource_type::spot),
 				helpers::get_lightsource_type_end_index(activeLights, lightsource_type::spot)
-			},
-			convert_for_gpu_usage<std::array<lightsource_gpu_data, MAX_NUMBER_OF_LIGHTSOURCES>>(activeLights, mQuakeCam.view_matrix())
-		};
-		auto lightsSemaphore = context().record_and_submit_with_semaphore(
-			// The buffer's backing memory is in a "device" memory region. Therefore, the data must first be copied into 
-			// a host visible buffer (done internally) and then transferred onto the device, into that device memory.
-			// This process must be synchronized => we need to submit the action_type_command to a queue:
-			{ mLightsBuffer->fill(&lightsData, 0) }, 
-			*mQueue, 
-			stage::copy
+			};
+			mLightsData.mLightData = convert_for_gpu_usage<std::array<lightsource_gpu_data, MAX_NUMBER_OF_LIGHTSOURCES>>(activeLights, glm::mat4{ 1.0f });
+			helpers::store_attenuation_radii(mLightsData.mLightData, mLightsData.mRangesPointSpot);
+			// Only the ranges and the active lights are uploaded:
+			addRegion(0, lightDataOffset + std::min(activeLights.size(), mLightsData.mLightData.size()) * sizeof(lightsource_gpu_data));
+			if (nullptr != lightsEd) {
+				mLightsActiveSetVersion = lightsEd->active_set_version();
+				lightsEd->clear_changes();
+			}
+		}
+		else {
+			lightsEd->for_each_changed_active_light([&](const lightsource& aLightsource, uint32_t aActiveIndex) {
+				if (aActiveIndex >= mLightsData.mLightData.size()) {
+					return;
+				}
+				mSingleLightsource.assign(1, aLightsource); // Reuses its memory
+				auto& gpuData = mLightsData.mLightData[aActiveIndex];
+				gpuData = convert_for_gpu_usage<std::array<lightsource_gpu_data, 1>>(mSingleLightsource, glm::mat4{ 1.0f })[0];
+				if (lightsource_type::point == aLightsource.mType || lightsource_type::spot == aLightsource.mType) {
+					gpuData.mAttenuation[3] = helpers::calc_attenuation_radius(gpuData.mColor, gpuData.mAttenuation);
+				}
+				addRegion(lightDataOffset + aActiveIndex * sizeof(lightsource_gpu_data), sizeof(lightsource_gpu_data));
+			});
+			lightsEd->clear_changes();
+		}
+
+		for (const auto& region : mLightsUploadRegions) {
+			mLightsStagingBuffers[aInFlightIndex]->fill(reinterpret_cast<const uint8_t*>(&mLightsData) + region.srcOffset, 0, region.srcOffset, region.size);
+			if (aForComputeQueue && mAsyncCompute.needs_ownership_transfer()) {
+				mComputeLightsStagingBuffers[aInFlightIndex]->fill(reinterpret_cast<const uint8_t*>(&mLightsData) + region.srcOffset, 0, region.srcOffset, region.size);
+			}
+		}
+	}
+
+	/**	Records the copies of the changed light data (mLightsUploadRegions) from the current frame's staging buffer into mLightsBuffer, and the
+	 *	barriers which order them after the previous frame's reads and before this frame's reads. Must be recorded outside of a renderpass.
+	 *	@param	aOnComputeQueue		Record the copies into mComputeLightsBuffer for the compute queue instead, which only the light clustering reads
+	 */
+	void record_lights_upload(const vk::CommandBuffer& aCommandBuffer, avk::window::frame_id_t aInFlightIndex, bool aOnComputeQueue)
+	{
+		const vk::PipelineStageFlags readingStages = aOnComputeQueue
+			? vk::PipelineStageFlags{ vk::PipelineStageFlagBits::eComputeShader }
+			: vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader;
+		const auto& stagingBuffer = aOnComputeQueue ? mComputeLightsStagingBuffers[aInFlightIndex] : mLightsStagingBuffers[aInFlightIndex];
+		const auto& lightsBuffer = aOnComputeQueue ? mComputeLightsBuffer : mLightsBuffer;
+
+		// The previous frame's light clustering and fragment shader invocations must have read the light data before it is overwritten:
+		aCommandBuffer.pipelineBarrier(readingStages, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, {});
+		aCommandBuffer.copyBuffer(stagingBuffer->handle(), lightsBuffer->handle(), mLightsUploadRegions);
+		aCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, readingStages, {},
+			vk::MemoryBarrier{ vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead }, {}, {}
 		);
-		// Upon completion of this ^ memory transfer into device memory, a semaphore is signaled.
-		// We can use this semaphore so that other work must wait on it.
-		//
-		// TODO Task 3: Think about which commands need to wait for this memory transfer to have completed, before they may execute!
-		//              Question: Is it sufficient that we wait on the semaphore signal just before we hand over the rendered image
-		//                        to the presentation image? 
-		//
-		context().main_window()->add_present_dependency_for_current_frame(std::move(lightsSemaphore));
+	}
 
-		// Alloc a new command buffer for the current frame, which we are going to record commands into, and then submit to the queue:
-		auto cmdBfr = mCommandPool->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	/**	Selects the level of detail of every entry of mVisibleDrawIndices, and sorts them by their draw_sorting keys (in mDrawOrder).
+	 *	Entries with equal keys are of the same instance group and level, consecutive ones are combined into instanced draws (mInstancedDraws).
+	 *	Writes the visible draw indices, which the instances refer to, and the instanced draws' commands into the given frame-in-flight's buffers.
+	 */
+	void update_instanced_draws(avk::window::frame_id_t aInFlightIndex, const glm::vec4& aLodParams, const glm::mat4& aViewMatrix)
+	{
+		const auto sortStart = std::chrono::high_resolution_clock::now();
+		const auto nearPlane = mQuakeCam.near_plane_distance();
+		const auto farPlane  = mQuakeCam.far_plane_distance();
+		mSortKeys.resize(mVisibleDrawIndices.size());
+		mLodDrawCounts.fill(0);
+		for (size_t v = 0; v < mVisibleDrawIndices.size(); ++v) {
+			const auto i = mVisibleDrawIndices[v];
+			const auto& drawCall = mDrawCalls[i];
+			const auto center = (drawCall.mBoundsMin + drawCall.mBoundsMax) * 0.5f;
+			const auto lod = mesh_lod::select_level(center, (drawCall.mBoundsMax - drawCall.mBoundsMin) * 0.5f, aLodParams, drawCall.mLodCount);
+			++mLodDrawCounts[lod];
+			// Opaque geometry goes front to back (all of the scene is opaque), grouped by the shading pipeline variant of its material:
+			const auto depthBucket = mDrawOrder == draw_sorting::order::scene ? 0u : draw_sorting::depth_bucket(-(aViewMatrix * glm::vec4{ center, 1.0f }).z, nearPlane, farPlane);
+			mSortKeys[v] = draw_sorting::make_key(mDrawOrder, drawCall.mDefaultTextureTiling ? 1u : 0u, static_cast<uint32_t>(drawCall.mMaterialIndex), depthBucket, mInstanceGroupOfDraw[i], lod);
+		}
+		draw_sorting::radix_sort(mSortKeys, mVisibleDrawIndices, mSortScratchKeys, mSortScratchValues);
+		const std::chrono::duration<float, std::milli> sortTime = std::chrono::high_resolution_clock::now() - sortStart;
+		mSortTimeMs = mSortTimeMs * 0.9f + sortTime.count() * 0.1f;
+
+		mInstancedDraws.clear();
+		for (size_t v = 0; v < mVisibleDrawIndices.size(); ++v) {
+			if (v > 0 && mSortKeys[v] == mSortKeys[v - 1]) {
+				++mInstancedDraws.back().mCommand.instanceCount;
+				continue;
+			}
+			const auto i = mVisibleDrawIndices[v];
+			const auto& drawCall = mDrawCalls[i];
+			const auto& lod = drawCall.mLods[draw_sorting::lod_of_key(mSortKeys[v])];
+			// firstInstance is the position of the first instance in mVisibleDrawIndices, which the vertex shader indexes with gl_InstanceIndex:
+			mInstancedDraws.push_back(instanced_draw{ vk::DrawIndexedIndirectCommand{ lod.mIndexCount, 1u, lod.mFirstIndex, drawCall.mVertexOffset, static_cast<uint32_t>(v) }, i });
+		}
 
-		context().record({ // Record a bunch of commands (which can be a mix of state-type commands and action-type commands):
+		if (mVisibleDrawIndices.empty()) {
+			return;
+		}
+		// Both buffers are host-visible => no need to submit the (empty) commands returned by fill():
+		mInstanceDrawIndicesBuffers[aInFlightIndex]->fill(mVisibleDrawIndices.data(), 0, 0, mVisibleDrawIndices.size() * sizeof(uint32_t));
+		if (mUseIndirectDrawing) {
+			mInstancedDrawCommands.clear();
+			for (const auto& draw : mInstancedDraws) {
+				mInstancedDrawCommands.push_back(draw.mCommand);
+			}
+			mInstancedDrawCommandsBuffers[aInFlightIndex]->fill(mInstancedDrawCommands.data(), 0, 0, mInstancedDrawCommands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+		}
+	}
 
-			command::custom_commands([&,this](avk::command_buffer_t& cb) {
-					// Note 1: The Vulkan SDK's command buffer class (from Vulkan-Hpp in this case) provides 
-					//         ALL the commands there are. Use it to record anything into the command buffer:
-					const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+	/** Looks up the descriptor sets of the scene's pipelines for the given frame in flight in the descriptor cache (creates them, if they do not exist yet) */
+	std::vector<avk::descriptor_set> get_scene_descriptor_sets(avk::window::frame_id_t aInFlightIndex, bool aUseGpuCulling)
+	{
+		using namespace avk;
+		return mDescriptorCache->get_or_create_descriptor_sets({
+			descriptor_binding(0, 0, mMaterials),
+			descriptor_binding(0, 1, as_combined_image_samplers(mImageSamplers, layout::shader_read_only_optimal)),
+			descriptor_binding(1, 0, mUniformsBuffers[aInFlightIndex]),
+			descriptor_binding(1, 1, mLightsBuffer),
+			descriptor_binding(1, 2, mClusterLightListsBuffers[aInFlightIndex]),
+			descriptor_binding(2, 0, mDrawDataBuffer),
+			descriptor_binding(2, 1, aUseGpuCulling ? mCulledInstanceDrawIndicesBuffers[aInFlightIndex] : mInstanceDrawIndicesBuffers[aInFlightIndex])
+		});
+	}
 
-					// Note 2: For some commands, the framework's avk::command_buffer_t class provides methods,
-					//         which allow more convenient usage/recording of functionality into the command buffer.
-					//         The following code uses mostly these avk::command_buffer_t methods:
-					cb.record(avk::command::begin_render_pass_for_framebuffer(
-						mPipeline->renderpass_reference(), // <-- Use the renderpass of mPipeline,
-						context().main_window()->current_backbuffer_reference() // <-- render into the window's backbuffer,
-					));
-
-					// Bind the pipeline for subsequent draw calls:
-					cb.record(avk::command::bind_pipeline(mPipeline.as_reference()));
-					// Bind all resources we need in shaders:
-					cb.record(avk::command::bind_descriptors(mPipeline->layout(), mDescriptorCache->get_or_create_descriptor_sets({
-						descriptor_binding(0, 0, mMaterials),
-						descriptor_binding(0, 1, as_combined_image_samplers(mImageSamplers, layout::shader_read_only_optimal)),
-						descriptor_binding(1, 0, mUniformsBuffer),
-						descriptor_binding(1, 1, mLightsBuffer)
-					})));
-
-					for (const auto& drawCall : mDrawCalls) {
-						cb.record(avk::command::push_constants(mPipeline->layout(), push_constants{ drawCall.mModelMatrix, drawCall.mMaterialIndex }));
-						cb.record(avk::command::draw_indexed(
-							drawCall.mIndexBuffer.as_reference(),     // Index buffer
-							drawCall.mPositionsBuffer.as_reference(), // Vertex buffer at index #0
-							drawCall.mTexCoordsBuffer.as_reference(), // Vertex buffer at index #1
-							drawCall.mNormalsBuffer.as_reference()    // Vertex buffer at index #2
-							// TODO Task 1: Provide buffers according to the declaration during creation of mPipeline!
-						));
-					}
+	/**	Looks up the descriptor sets of mCullingPipeline for the given frame in flight in the descriptor cache, with the compute queue's inputs
+	 *	if aOnComputeQueue. The late occlusion culling phase (aLatePhase) writes its own commands, it is never recorded for the compute queue.
+	 */
+	std::vector<avk::descriptor_set> get_culling_descriptor_sets(avk::window::frame_id_t aInFlightIndex, bool aOnComputeQueue, bool aLatePhase)
+	{
+		using namespace avk;
+		const auto& groupCommandsBuffer = aLatePhase ? mLateInstanceGroupCommandsBuffer : (aOnComputeQueue ? mComputeInstanceGroupCommandsBuffer : mInstanceGroupCommandsBuffer);
+		return mDescriptorCache->get_or_create_descriptor_sets({
+			descriptor_binding(0, 0, aOnComputeQueue ? mComputeDrawDataBuffer : mDrawDataBuffer),
+			descriptor_binding(0, 1, aOnComputeQueue ? mComputeDrawBoundsBuffer : mDrawBoundsBuffer),
+			descriptor_binding(0, 2, groupCommandsBuffer),
+			descriptor_binding(0, 3, aLatePhase ? mLateCulledCommandsBuffers[aInFlightIndex] : mCulledCommandsBuffers[aInFlightIndex]),
+			descriptor_binding(0, 4, mCulledInstanceDrawIndicesBuffers[aInFlightIndex]),
+			descriptor_binding(0, 5, mOcclusionCullingBuffers[aInFlightIndex]),
+			descriptor_binding(0, 6, mHiZSampler->as_combined_image_sampler(layout::general)),
+			descriptor_binding(0, 7, mOcclusionCandidatesBuffer),
+			descriptor_binding(0, 8, mCullingStatsBuffers[aInFlightIndex])
+		});
+	}
 
-					cb.record(avk::command::end_render_pass());
+	/** Looks up the descriptor sets of mLightClusteringPipeline for the given frame in flight in the descriptor cache, with the compute queue's inputs if aOnComputeQueue */
+	std::vector<avk::descriptor_set> get_light_clustering_descriptor_sets(avk::window::frame_id_t aInFlightIndex, bool aOnComputeQueue)
+	{
+		using namespace avk;
+		return mDescriptorCache->get_or_create_descriptor_sets({
+			descriptor_binding(0, 0, aOnComputeQueue ? mComputeLightsBuffer : mLightsBuffer),
+			descriptor_binding(0, 1, mClusterLightListsBuffers[aInFlightIndex]),
+			descriptor_binding(0, 2, aOnComputeQueue ? mComputeUniformsBuffers[aInFlightIndex] : mUniformsBuffers[aInFlightIndex])
+		});
+	}
 
-				}),
+	/** The buffers which the compute passes of the given frame in flight write on the compute queue, and the graphics queue reads */
+	std::vector<vk::Buffer> async_compute_results(avk::window::frame_id_t aInFlightIndex, bool aUseGpuCulling) const
+	{
+		std::vector<vk::Buffer> buffers;
+		if (aUseGpuCulling) {
+			buffers.push_back(mCulledCommandsBuffers[aInFlightIndex]->handle());
+			buffers.push_back(mCulledInstanceDrawIndicesBuffers[aInFlightIndex]->handle());
+		}
+		if (mUseClusteredShading) {
+			buffers.push_back(mClusterLightListsBuffers[aInFlightIndex]->handle());
+		}
+		return buffers;
+	}
 
-			}) // End of command recording
-			.into_command_buffer(cmdBfr)
-			.then_submit_to(*mQueue)
-			// The work package we are submitting to the queue must wait in the EARLY FRAGMENT TESTS for the 
-		    // imageAvailableSemaphore being signaled, because in that stage, the depth buffer is accessed:
-			.waiting_for(imageAvailableSemaphore >> stage::early_fragment_tests)
-			// Hint: We could add further semaphore dependencies here, if we needed to wait on other work too.
-			.submit();
+	/**	Retrieves all the descriptor sets which are used every frame once per frame in flight, s.t. render() does not have to look them up
+	 *	in the descriptor cache, which hashes all of their bindings (including every single one of the material textures) for every lookup.
+	 *	None of the bound resources are ever replaced, hence, the sets only have to be baked again when the layouts might have changed.
+	 */
+	void bake_descriptor_sets()
+	{
+		const auto numFramesInFlight = avk::context().main_window()->number_of_frames_in_flight();
+		mSceneDescriptorSets.clear();
+		mSceneDescriptorSetsGpuCulling.clear();
+		mLightClusteringDescriptorSets.clear();
+		mCullingDescriptorSets.clear();
+		mLateCullingDescriptorSets.clear();
+		mAsyncLightClusteringDescriptorSets.clear();
+		mAsyncCullingDescriptorSets.clear();
+		for (avk::window::frame_id_t fif = 0; fif < numFramesInFlight; ++fif) {
+			mSceneDescriptorSets.push_back(get_scene_descriptor_sets(fif, false));
+			mSceneDescriptorSetsGpuCulling.push_back(get_scene_descriptor_sets(fif, true));
+			mLightClusteringDescriptorSets.push_back(get_light_clustering_descriptor_sets(fif, false));
+			mCullingDescriptorSets.push_back(get_culling_descriptor_sets(fif, false, false));
+			mLateCullingDescriptorSets.push_back(get_culling_descriptor_sets(fif, false, true));
+			if (mAsyncCompute.is_available()) {
+				mAsyncLightClusteringDescriptorSets.push_back(get_light_clustering_descriptor_sets(fif, true));
+				mAsyncCullingDescriptorSets.push_back(get_culling_descriptor_sets(fif, true, false));
+			}
+		}
+		mDescriptorSetsBaked = true;
+	}
 
-		// Use a convenience function of avk::window to take care of the command buffer's lifetime:
-		// It will get deleted in the future after #concurrent-frames have passed by.
-		context().main_window()->handle_lifetime(std::move(cmdBfr));
+	/** GPU culling writes the instance groups of all batches into one indirect buffer, which requires all of them to share the same buffers */
+	bool is_gpu_culling_supported() const
+	{
+		return mIndirectBatches.size() == 1;
+	}
+
+	/**	Records the compute pass which culls all draw calls against the given frustum planes, and selects the levels of detail of the visible ones.
+	 *	The instance counts of all levels of all instance groups are written into the given frame in flight's mCulledCommandsBuffers, and the
+	 *	draw indices of their visible instances into its mCulledInstanceDrawIndicesBuffers.
+	 *	With occlusion culling, the early phase additionally tests them against the previous frame's depth pyramid, and the late phase tests
+	 *	the ones which have failed that test against the current frame's pyramid (see record_hiz_build). The late phase writes its instance
+	 *	counts into mLateCulledCommandsBuffers, and its instances after the early phase's ones.
+	 *	Must be recorded outside of a renderpass.
+	 *	@param	aOnComputeQueue		Whether it is recorded for the compute queue, where the graphics work is synchronized through the timeline semaphores instead
+	 */
+	void record_gpu_culling(avk::command_buffer_t& cb, avk::window::frame_id_t aInFlightIndex, const frustum_culling::planes_t& aFrustumPlanes, const glm::vec4& aLodParams, bool aOnComputeQueue, culling_phase aPhase)
+	{
+		using namespace avk;
+		const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+		const bool latePhase = aPhase == culling_phase::occlusion_late;
+
+		// The previous frame's draw calls must have consumed the culled buffers before they are overwritten, the previous phase's and
+		// the depth pyramid's writes must be visible, then the instance counts must have been reset (by copying the templates) before
+		// the compute shader increments them:
+		if (!aOnComputeQueue) {
+			vkHppCommandBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eComputeShader,
+				vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {},
+				vk::MemoryBarrier{ vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite }, {}, {}
+			);
+		}
+		const auto& groupCommandsBuffer = latePhase ? mLateInstanceGroupCommandsBuffer : (aOnComputeQueue ? mComputeInstanceGroupCommandsBuffer : mInstanceGroupCommandsBuffer);
+		const auto& culledCommandsBuffer = latePhase ? mLateCulledCommandsBuffers[aInFlightIndex] : mCulledCommandsBuffers[aInFlightIndex];
+		vkHppCommandBuffer.copyBuffer(groupCommandsBuffer->handle(), culledCommandsBuffer->handle(), vk::BufferCopy{ 0, 0, mInstanceGroupCount * geometry_cache::sMaxLodLevels * sizeof(vk::DrawIndexedIndirectCommand) });
+		// The counters are reset before the frame's first phase:
+		if (!latePhase) {
+			vkHppCommandBuffer.fillBuffer(mCullingStatsBuffers[aInFlightIndex]->handle(), 0, VK_WHOLE_SIZE, 0u);
+			mCullingStatsWritten[aInFlightIndex] = true;
+		}
+		vkHppCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+			vk::MemoryBarrier{ vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite }, {}, {}
+		);
+
+		const culling_push_constants pushConstants{ aFrustumPlanes, aLodParams, static_cast<uint32_t>(mDrawCalls.size()), static_cast<uint32_t>(aPhase) };
+		cb.record(command::bind_pipeline(mCullingPipeline.as_reference()));
+		const auto& prebakedDescriptorSets = latePhase ? mLateCullingDescriptorSets : (aOnComputeQueue ? mAsyncCullingDescriptorSets : mCullingDescriptorSets);
+		cb.record(command::bind_descriptors(mCullingPipeline->layout(), mUsePrebakedDescriptorSets ? prebakedDescriptorSets[aInFlightIndex] : get_culling_descriptor_sets(aInFlightIndex, aOnComputeQueue, latePhase)));
+		cb.record(command::push_constants(mCullingPipeline->layout(), pushConstants));
+		vkHppCommandBuffer.dispatch((pushConstants.mDrawCount + 63u) / 64u, 1u, 1u); // local_size_x = 64
+
+		// The host reads the counters when this frame-in-flight index comes around again (see read_culling_stats):
+		vkHppCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {},
+			vk::MemoryBarrier{ vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead }, {}, {}
+		);
+		// On the compute queue, the graphics work's wait for the compute timeline makes the results visible to it (see render):
+		if (aOnComputeQueue) {
+			return;
+		}
+		// The instance counts are consumed as indirect arguments, the instance draw indices by the vertex shader:
+		vkHppCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader, {},
+			vk::MemoryBarrier{ vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead }, {}, {}
+		);
+	}
+
+	/**	Records the compute passes which build the depth pyramid (mHiZImage) from the depth of the scene's rendered part (aRenderExtent),
+	 *	level by level. Every texel holds the farthest depth of the texels it covers, i.e., geometry which is behind all of them is occluded.
+	 *	Must be recorded outside of a renderpass, after the early shading pass of occlusion culling.
+	 */
+	void record_hiz_build(avk::command_buffer_t& cb, const vk::Extent2D& aRenderExtent)
+	{
+		using namespace avk;
+		const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+
+		// The depth writes must have finished, and the early culling phase's reads of the previous frame's pyramid:
+		std::vector<vk::ImageMemoryBarrier> imageBarriers;
+		if (mHiZLayoutUndefined) {
+			imageBarriers.emplace_back(
+				vk::AccessFlags{}, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+				mHiZImage->handle(), vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0u, VK_REMAINING_MIP_LEVELS, 0u, 1u }
+			);
+			mHiZLayoutUndefined = false;
+		}
+		vkHppCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+			vk::MemoryBarrier{ vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead }, {}, imageBarriers
+		);
+
+		cb.record(command::bind_pipeline(mHiZBuildPipeline.as_reference()));
+		glm::ivec2 srcSize{ aRenderExtent.width, aRenderExtent.height };
+		for (uint32_t level = 0; level < mHiZLevelCount; ++level) {
+			const glm::ivec2 dstSize = (srcSize + 1) / 2;
+			// Level 0 is built from the scene's depth, every other level from the one below it:
+			cb.record(command::bind_descriptors(mHiZBuildPipeline->layout(), mDescriptorCache->get_or_create_descriptor_sets({
+				descriptor_binding(0, 0, 0 == level ? mSceneDepthSampler->as_combined_image_sampler(layout::shader_read_only_optimal) : mHiZSampler->as_combined_image_sampler(layout::general)),
+				descriptor_binding(0, 1, mHiZLevelViews[level]->as_storage_image(layout::general))
+			})));
+			const hiz_build_push_constants pushConstants{ glm::ivec4{ srcSize, dstSize }, 0 == level ? 0 : static_cast<int32_t>(level) - 1 };
+			cb.record(command::push_constants(mHiZBuildPipeline->layout(), pushConstants));
+			vkHppCommandBuffer.dispatch((static_cast<uint32_t>(dstSize.x) + 7u) / 8u, (static_cast<uint32_t>(dstSize.y) + 7u) / 8u, 1u); // local_size = 8x8
+			// The next level (and the late culling phase, after the last one) reads this one:
+			vkHppCommandBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+				vk::MemoryBarrier{ vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead }, {}, {}
+			);
+			srcSize = dstSize;
+		}
+	}
+
+	/** Reads the counters of the GPU culling pass of the previous frame with the given frame-in-flight index (which has completed) into mCullingStats */
+	void read_culling_stats(avk::window::frame_id_t aInFlightIndex)
+	{
+		if (!mCullingStatsWritten[aInFlightIndex]) {
+			return;
+		}
+		mCullingStats = mCullingStatsBuffers[aInFlightIndex]->read<culling_stats>(0);
+		mCullingStatsWritten[aInFlightIndex] = false;
+	}
+
+	/**	Records the compute pass which assigns all point and spot lights to the light clusters they influence,
+	 *	and writes the clusters' light lists into the given frame in flight's mClusterLightListsBuffers. Must be recorded outside of a renderpass.
+	 *	@param	aOnComputeQueue		Whether it is recorded for the compute queue, where the graphics work is synchronized through the timeline semaphores instead
+	 */
+	void record_light_clustering(avk::command_buffer_t& cb, avk::window::frame_id_t aInFlightIndex, const light_clustering_push_constants& aPushConstants, bool aOnComputeQueue)
+	{
+		using namespace avk;
+		const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+
+		// The previous frame's fragment shader invocations must have read the light lists before they are overwritten:
+		if (!aOnComputeQueue) {
+			vkHppCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, {});
+		}
+
+		cb.record(command::bind_pipeline(mLightClusteringPipeline.as_reference()));
+		const auto& prebakedDescriptorSets = aOnComputeQueue ? mAsyncLightClusteringDescriptorSets : mLightClusteringDescriptorSets;
+		cb.record(command::bind_descriptors(mLightClusteringPipeline->layout(), mUsePrebakedDescriptorSets ? prebakedDescriptorSets[aInFlightIndex] : get_light_clustering_descriptor_sets(aInFlightIndex, aOnComputeQueue)));
+		cb.record(command::push_constants(mLightClusteringPipeline->layout(), aPushConstants));
+		vkHppCommandBuffer.dispatch((NUMBER_OF_LIGHT_CLUSTERS + 127u) / 128u, 1u, 1u); // local_size_x = 128
+
+		// On the compute queue, the graphics work's wait for the compute timeline makes the results visible to it (see render):
+		if (aOnComputeQueue) {
+			return;
+		}
+		vkHppCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader, {},
+			vk::MemoryBarrier{ vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead }, {}, {}
+		);
+	}
+
+	/**	Returns a hash of everything which record_scene_draw_calls records for the current frame's draws with the given pipelines and descriptor sets.
+	 *	The contents of the buffers (instance indices, indirect commands, culling results) are not part of it, they are written every frame.
+	 *	Hence, the indirect draw calls are only recorded again when the number of draws or the geometry buffers which they use change.
+	 */
+	uint64_t scene_recording_signature(const avk::graphics_pipeline& aPipeline, const avk::graphics_pipeline* aDefaultTilingPipeline, const std::vector<avk::descriptor_set>& aDescriptorSets, bool aUseGpuCulling) const
+	{
+		// FNV-1a over 64-bit words:
+		uint64_t hash = 14695981039346656037ull;
+		const auto add = [&hash](uint64_t aValue) { hash = (hash ^ aValue) * 1099511628211ull; };
+		add(mSceneRecordingGeneration);
+		add((static_cast<uint64_t>(mRenderExtent.width) << 32) | mRenderExtent.height);
+		add(std::hash<vk::Pipeline>{}(aPipeline->handle()));
+		add(nullptr != aDefaultTilingPipeline ? std::hash<vk::Pipeline>{}((*aDefaultTilingPipeline)->handle()) : 0u);
+		for (const auto& descriptorSet : aDescriptorSets) {
+			add(std::hash<vk::DescriptorSet>{}(descriptorSet.handle()));
+		}
+		add(aUseGpuCulling ? 1u : 0u);
+		if (aUseGpuCulling) {
+			return hash;
+		}
+
+		add(mUseIndirectDrawing ? 1u : 0u);
+		add(mInstancedDraws.size());
+		vk::Buffer previousIndexBuffer = VK_NULL_HANDLE;
+		bool previousDefaultTiling = false;
+		for (size_t d = 0; d < mInstancedDraws.size(); ++d) {
+			const auto& draw = mInstancedDraws[d];
+			const vk::Buffer indexBuffer = mDrawCalls[draw.mFirstDraw].mIndexBuffer->handle();
+			const bool defaultTiling = mDrawCalls[draw.mFirstDraw].mDefaultTextureTiling;
+			// Where the buffers are bound, and the pipeline variant is switched:
+			if (indexBuffer != previousIndexBuffer || defaultTiling != previousDefaultTiling) {
+				add(d);
+				add(draw.mFirstDraw);
+				previousIndexBuffer = indexBuffer;
+				previousDefaultTiling = defaultTiling;
+			}
+			if (!mUseIndirectDrawing) {
+				add((static_cast<uint64_t>(draw.mCommand.indexCount) << 32) | draw.mCommand.instanceCount);
+				add((static_cast<uint64_t>(draw.mCommand.firstIndex) << 32) | static_cast<uint32_t>(draw.mCommand.vertexOffset));
+				add(draw.mCommand.firstInstance);
+			}
+		}
+		return hash;
+	}
+
+	/** Releases the command buffers of the given recording after the frames which might still execute them have completed: */
+	void release_scene_recording(scene_recording& aRecording)
+	{
+		for (auto& cmdBfr : aRecording.mCommandBuffers) {
+			avk::context().main_window()->handle_lifetime(std::move(cmdBfr));
+		}
+		aRecording.mCommandBuffers.clear();
+		aRecording.mValid = false;
+	}
+
+	/**	Records the scene's draw calls with the given pipeline, which must be compatible with mPipeline's layout, into the given command buffer.
+	 *	If aDefaultTilingPipeline is set, the draw calls with default texture tiling are drawn with it instead, which must be compatible, too.
+	 *	Records the instanced draws mInstancedDraws[aBegin, aEnd), or one indirect draw call per pipeline for the results of the GPU culling pass,
+	 *	which are those of its late occlusion culling phase if aLatePass.
+	 *	Must be recorded within a renderpass. Does not use the descriptor cache, s.t. it can be invoked from multiple threads concurrently.
+	 *	The viewport covers aRenderExtent, i.e., it must be recorded again whenever the render scale changes.
+	 */
+	void record_scene_draw_calls(avk::command_buffer_t& cb, avk::graphics_pipeline& aPipeline, avk::graphics_pipeline* aDefaultTilingPipeline, const std::vector<avk::descriptor_set>& aDescriptorSets, bool aUseGpuCulling, bool aLatePass, avk::window::frame_id_t aInFlightIndex, const vk::Extent2D& aRenderExtent, size_t aBegin, size_t aEnd)
+	{
+		using namespace avk;
+		const vk::CommandBuffer& vkHppCommandBuffer = cb.handle();
+
+		// Bind the pipeline for subsequent draw calls, the dynamic state is not inherited by secondary command buffers:
+		cb.record(avk::command::bind_pipeline(aPipeline.as_reference()));
+		set_render_extent_viewport(vkHppCommandBuffer, aRenderExtent);
+		// Bind all resources we need in shaders:
+		cb.record(avk::command::bind_descriptors(aPipeline->layout(), aDescriptorSets));
+
+		// The variants' layouts are identical, i.e., the descriptor sets and the dynamic viewport stay bound when the pipeline is switched:
+		bool defaultTilingBound = false;
+		const auto bindVariant = [&](bool aDefaultTiling) {
+			if (nullptr != aDefaultTilingPipeline && aDefaultTiling != defaultTilingBound) {
+				cb.record(avk::command::bind_pipeline((aDefaultTiling ? *aDefaultTilingPipeline : aPipeline).as_reference()));
+				defaultTilingBound = aDefaultTiling;
+			}
+		};
+
+		if (aUseGpuCulling) {
+			// One indirect draw call for all levels of detail of all instance groups (of each pipeline variant), whose instance counts have been
+			// written by the culling pass. Levels without any visible instances are drawn with zero instances, which costs next to nothing:
+			bind_geometry_buffers(vkHppCommandBuffer, mDrawCalls.front());
+			const auto& culledCommandsBuffer = aLatePass ? mLateCulledCommandsBuffers[aInFlightIndex] : mCulledCommandsBuffers[aInFlightIndex];
+			const auto drawInstanceGroups = [&](uint32_t aFirstGroup, uint32_t aGroupCount) {
+				if (aGroupCount > 0) {
+					vkHppCommandBuffer.drawIndexedIndirect(
+						culledCommandsBuffer->handle(), static_cast<vk::DeviceSize>(aFirstGroup) * geometry_cache::sMaxLodLevels * sizeof(vk::DrawIndexedIndirectCommand),
+						aGroupCount * geometry_cache::sMaxLodLevels, sizeof(vk::DrawIndexedIndirectCommand)
+					);
+				}
+			};
+			if (nullptr == aDefaultTilingPipeline) {
+				drawInstanceGroups(0u, mInstanceGroupCount);
+				return;
+			}
+			drawInstanceGroups(0u, mFirstDefaultTilingInstanceGroup);
+			bindVariant(true);
+			drawInstanceGroups(mFirstDefaultTilingInstanceGroup, mInstanceGroupCount - mFirstDefaultTilingInstanceGroup);
+			return;
+		}
+
+		// Buffers are only (re-)bound if they differ from the previous instanced draw's, which is never the case for geometry_layout::merged_buffers.
+		// The instanced draws are sorted by pipeline variant (see update_instanced_draws), i.e., it is switched at most once:
+		vk::Buffer boundIndexBuffer = VK_NULL_HANDLE;
+		size_t d = aBegin;
+		while (d < aEnd) {
+			const auto& drawCall = mDrawCalls[mInstancedDraws[d].mFirstDraw];
+			bindVariant(drawCall.mDefaultTextureTiling);
+			if (drawCall.mIndexBuffer->handle() != boundIndexBuffer) {
+				bind_geometry_buffers(vkHppCommandBuffer, drawCall);
+				boundIndexBuffer = drawCall.mIndexBuffer->handle();
+			}
+			if (mUseIndirectDrawing) {
+				// One multi draw indirect call for each run of instanced draws which share the same buffers and pipeline variant:
+				size_t runCount = 1;
+				while (d + runCount < aEnd && mDrawCalls[mInstancedDraws[d + runCount].mFirstDraw].mIndexBuffer->handle() == boundIndexBuffer
+				       && (nullptr == aDefaultTilingPipeline || mDrawCalls[mInstancedDraws[d + runCount].mFirstDraw].mDefaultTextureTiling == defaultTilingBound)) {
+					++runCount;
+				}
+				vkHppCommandBuffer.drawIndexedIndirect(
+					mInstancedDrawCommandsBuffers[aInFlightIndex]->handle(),
+					d * sizeof(vk::DrawIndexedIndirectCommand), static_cast<uint32_t>(runCount),
+					sizeof(vk::DrawIndexedIndirectCommand)
+				);
+				d += runCount;
+			}
+			else {
+				const auto& command = mInstancedDraws[d].mCommand;
+				vkHppCommandBuffer.drawIndexed(command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+				++d;
+			}
+		}
+	}
+
+	/**	Binds the index buffer and the vertex buffers of the given draw call for subsequent draw calls.
+	 *	The vertex buffers are bound in the order in which they have been declared during creation of mPipeline.
+	 */
+	void bind_geometry_buffers(const vk::CommandBuffer& aCommandBuffer, const helpers::data_for_draw_call& aDrawCall)
+	{
+		aCommandBuffer.bindIndexBuffer(aDrawCall.mIndexBuffer->handle(), 0, aDrawCall.mIndexType);
+		if (mVertexFormat == helpers::vertex_format::compact) {
+			// One interleaved vertex buffer at index #0
+			aCommandBuffer.bindVertexBuffers(0u, aDrawCall.mCompactVerticesBuffer->handle(), vk::DeviceSize{ 0 });
+			return;
+		}
+
+		const std::array<vk::Buffer, 3> vertexBuffers = {
+			aDrawCall.mPositionsBuffer->handle(), // Vertex buffer at index #0
+			aDrawCall.mTexCoordsBuffer->handle(), // Vertex buffer at index #1
+			aDrawCall.mNormalsBuffer->handle()    // Vertex buffer at index #2
+			// TODO Task 1: Provide buffers according to the declaration during creation of mPipeline!
+		};
+		const std::array<vk::DeviceSize, 3> vertexBufferOffsets = { 0, 0, 0 };
+		aCommandBuffer.bindVertexBuffers(0u, vertexBuffers, vertexBufferOffsets);
 	}
 
 	// ----------------------- ^^^  PER FRAME ACTION  ^^^ -----------------------
 	//
 	// ----------------------- vvv  MEMBER VARIABLES  vvv -----------------------
 private:
-	/** One single queue to submit all the commands to: */
+	/** One single queue to submit all the commands to (except for the geometry uploads): */
 	avk::queue* mQueue;
+	/** Queue which the geometry uploads are submitted to, preferably a transfer-only queue: */
+	avk::queue* mTransferQueue;
+	/** Queue which the compute passes are submitted to, preferably of a compute-only queue family (see mAsyncCompute): */
+	avk::queue* mComputeQueue;
 
 	/** One descriptor cache to use for allocating all the descriptor sets from: */
 	avk::descriptor_cache mDescriptorCache;
+	/** Descriptor sets which are retrieved from mDescriptorCache once (per frame in flight), see bake_descriptor_sets: */
+	bool mUsePrebakedDescriptorSets = true;
+	bool mDescriptorSetsBaked = false;
+	std::vector<std::vector<avk::descriptor_set>> mSceneDescriptorSets;
+	std::vector<std::vector<avk::descriptor_set>> mSceneDescriptorSetsGpuCulling;
+	std::vector<std::vector<avk::descriptor_set>> mLightClusteringDescriptorSets;
+	std::vector<std::vector<avk::descriptor_set>> mCullingDescriptorSets;
+	std::vector<std::vector<avk::descriptor_set>> mAsyncLightClusteringDescriptorSets;
+	std::vector<std::vector<avk::descriptor_set>> mAsyncCullingDescriptorSets;
+	std::vector<std::vector<avk::descriptor_set>> mLateCullingDescriptorSets;
 
 	/** A command pool for allocating (single-use) command buffers from: */
 	avk::command_pool mCommandPool;
 
+	/** Measures the GPU times of the frame's passes, and of the compute passes on the compute queue: */
+	gpu_profiler mGpuProfiler;
+	gpu_profiler mComputeGpuProfiler;
+
+	/** The compute queue's copies of the compute passes' inputs: The constant and host-visible ones are only copies if the compute queue
+	 *	belongs to another queue family than mQueue, mComputeLightsBuffer always is one: */
+	avk::buffer mComputeDrawDataBuffer;
+	avk::buffer mComputeDrawBoundsBuffer;
+	avk::buffer mComputeInstanceGroupCommandsBuffer;
+	std::vector<avk::buffer> mComputeUniformsBuffers;
+	std::vector<avk::buffer> mComputeLightsStagingBuffers;
+	avk::buffer mComputeLightsBuffer;
+	bool mComputeLightsUpToDate = false;
+	/** Submits the culling and light clustering passes to mComputeQueue, if it is a separate queue (declared after the buffers which they use,
+	 *	s.t. it waits for them before they are destroyed): */
+	async_compute mAsyncCompute;
+	bool mUseAsyncCompute = false;
+
 	/** Buffer containing all the different materials as loaded from 3D models/ORCA scenes: */
 	avk::buffer mMaterials;
 	/** Set of image samplers which are referenced by the materials in mMaterials: */
 	std::vector<avk::image_sampler> mImageSamplers;
 	/** Draw calls which are for all the geometry, references materials mMaterials by index: */
 	std::vector<helpers::data_for_draw_call> mDrawCalls;
+	/** Uploads the draw calls' geometry buffers through mTransferQueue (declared after mDrawCalls, s.t. it waits for the uploads before they are destroyed): */
+	async_uploader mAsyncUploader;
+	/** Whether the draw calls use separate buffers per material group, or share merged buffers (load-time option): */
+	helpers::geometry_layout mGeometryLayout = helpers::geometry_layout::merged_buffers;
+	/** Whether the vertices are stored in full precision, or interleaved and quantized (load-time option): */
+	helpers::vertex_format mVertexFormat = helpers::vertex_format::compact;
 
 	/** Cameras to navigate the scene: */
 	avk::orbit_camera mOrbitCam;
 	avk::quake_camera mQuakeCam;
 
+	/** Per-draw data of all draw calls, the ranges of draw calls which share the same buffers, and the instance group of every draw call: */
+	avk::buffer mDrawDataBuffer;
+	std::vector<indirect_batch> mIndirectBatches;
+	std::vector<uint32_t> mInstanceGroupOfDraw;
+	uint32_t mInstanceGroupCount = 0;
+
+	/** World-space bounds of all draw calls, the instance groups' commands (without instances), and the outputs of the GPU culling pass (per frame in flight): */
+	avk::buffer mDrawBoundsBuffer;
+	avk::buffer mInstanceGroupCommandsBuffer;
+	std::vector<avk::buffer> mCulledCommandsBuffers;
+	std::vector<avk::buffer> mCulledInstanceDrawIndicesBuffers;
+	avk::compute_pipeline mCullingPipeline;
+	/** The late occlusion culling phase's commands (template, and per frame in flight), the draw calls which the early phase has found occluded,
+	 *	the matrices and extents of the depth pyramids (per frame in flight, see occlusion_culling_data), and the culling pass's counters
+	 *	(per frame in flight, read back by read_culling_stats when their frame has completed): */
+	avk::buffer mLateInstanceGroupCommandsBuffer;
+	std::vector<avk::buffer> mLateCulledCommandsBuffers;
+	avk::buffer mOcclusionCandidatesBuffer;
+	std::vector<avk::buffer> mOcclusionCullingBuffers;
+	std::vector<avk::buffer> mCullingStatsBuffers;
+	std::vector<bool> mCullingStatsWritten;
+	culling_stats mCullingStats{};
+	/** CPU-side bounds of all draw calls, and the indices of the draw calls to be recorded in the current frame (ascending after culling,
+	 *	sorted by update_instanced_draws): */
+	frustum_culling mFrustumCulling;
+	std::vector<uint32_t> mVisibleDrawIndices;
+
+	/** The current frame's instanced draws of the visible draw calls, and their per-frame-in-flight buffers (instance draw indices, and commands for indirect drawing): */
+	std::vector<instanced_draw> mInstancedDraws;
+	/** Sort keys of the visible draw calls (and scratch memory for sorting them), and their order: */
+	std::vector<uint64_t> mSortKeys, mSortScratchKeys;
+	std::vector<uint32_t> mSortScratchValues;
+	draw_sorting::order mDrawOrder = draw_sorting::order::material_then_depth;
+	float mSortTimeMs = 0.0f;
+	std::array<size_t, geometry_cache::sMaxLodLevels> mLodDrawCounts{};
+	std::vector<vk::DrawIndexedIndirectCommand> mInstancedDrawCommands;
+	std::vector<avk::buffer> mInstanceDrawIndicesBuffers;
+	std::vector<avk::buffer> mInstancedDrawCommandsBuffers;
+
+	/** Number of instanced draws per recording job, i.e., per secondary command buffer which the scene's draw calls are split into: */
+	static constexpr size_t sDrawCallsPerRecordingJob = 256;
+
+	/** The secondary command buffers of one pass's scene draw calls, which are executed again in subsequent frames as long as
+	 *	the signature of the draw calls (see scene_recording_signature) does not change: */
+	struct scene_recording
+	{
+		std::vector<avk::command_buffer> mCommandBuffers;
+		uint64_t mSignature = 0;
+		bool mValid = false;
+	};
+	/** Per frame in flight, the recordings of the depth pre-pass [0], of the shading pass [1], and of the late shading pass of occlusion culling [2].
+	 *	mSceneRecordingGeneration is incremented whenever the pipelines are replaced by mUpdater, which invalidates all of them: */
+	bool mReuseSceneCommandBuffers = true;
+	std::vector<std::array<scene_recording, 3>> mSceneRecordings;
+	uint64_t mSceneRecordingGeneration = 0;
+	size_t mReusedSceneRecordings = 0;
+
 	/** A rasterization-based graphics pipeline with vertex and fragment shaders: */
 	avk::graphics_pipeline mPipeline;
-
-	avk::buffer mUniformsBuffer;
+	/** Depth-only pipeline (no fragment shader) of the depth pre-pass, and the shading pipeline which is used after it instead of mPipeline: */
+	avk::graphics_pipeline mDepthPrePassPipeline;
+	avk::graphics_pipeline mPipelineAfterDepthPrePass;
+	/** The variants of mPipeline and mPipelineAfterDepthPrePass for the draw calls whose materials have default texture tiling, which
+	 *	follow all the other draw calls in mDrawCalls, starting with instance group mFirstDefaultTilingInstanceGroup (see init_indirect_drawing): */
+	avk::graphics_pipeline mPipelineDefaultTiling;
+	avk::graphics_pipeline mPipelineAfterDepthPrePassDefaultTiling;
+	uint32_t mFirstDefaultTilingInstanceGroup = 0;
+	/** The renderpasses of the pipelines above (they are all compatible with mSceneFramebuffer), and of mUpscalePipeline: */
+	avk::renderpass mSceneRenderpass;
+	avk::renderpass mDepthPrePassRenderpass;
+	avk::renderpass mAfterDepthPrePassRenderpass;
+	avk::renderpass mUpscaleRenderpass;
+
+	/** Uniform buffers and light data staging buffers, one of each per frame in flight, and the device-local light data: */
+	std::vector<avk::buffer> mUniformsBuffers;
+	std::vector<avk::buffer> mLightsStagingBuffers;
 	avk::buffer mLightsBuffer;
+	/** CPU-side copy of mLightsBuffer's contents (in world space), the byte ranges of it to be uploaded in the current frame, and
+	 *	the lights editor's active_set_version() it corresponds to (see update_lights_data): */
+	lightsource_data mLightsData{};
+	std::vector<vk::BufferCopy> mLightsUploadRegions;
+	uint64_t mLightsActiveSetVersion = ~uint64_t{ 0 };
+	std::vector<avk::lightsource> mSingleLightsource;
+	/** Light lists of all light clusters (per frame in flight), and the compute pipeline which creates them: */
+	std::vector<avk::buffer> mClusterLightListsBuffers;
+	avk::compute_pipeline mLightClusteringPipeline;
 
 	// ------------------ UI Parameters -------------------
 	/** Factor that determines to which amount normals shall be distorted through normal mapping: */
 	float mNormalMappingStrength = 0.5f;
+	/** Record the scene with indirect draw calls (true) or with one draw_indexed per draw call (false): */
+	bool mUseIndirectDrawing = false;
+	/** How to cull the scene's draw calls against the view frustum, and the averaged CPU time spent for culling on the CPU: */
+	culling_mode mCullingMode = culling_mode::cpu;
+	float mCullingTimeMs = 0.0f;
+	/** Evaluate only the lights of a fragment's light cluster (true), or all point and spot lights for every fragment (false): */
+	bool mUseClusteredShading = true;
+	/** Render the scene's depth in a separate pass first, s.t. the shading pass only shades the visible fragments: */
+	bool mUseDepthPrePass = false;
+	/** Cull the draw calls which are hidden behind the previous frame's depth as well, re-testing them against the current frame's (GPU culling only): */
+	bool mUseOcclusionCulling = true;
+	// Levels of detail: Draw calls whose bounds (their enclosing sphere) project to a smaller radius than this, in pixels, use coarser levels:
+	bool mUseMeshLods = true;
+	float mLodReferenceRadius = 256.0f;
+
+	// -------------------- Benchmark ---------------------
+	/** Settings of the benchmark mode (see enable_benchmark), and the benchmark runs while they are in progress: */
+	std::optional<benchmark::settings> mBenchmarkSettings;
+	std::optional<benchmark> mBenchmark;
 
 	// --------------------- Skybox -----------------------
-	simple_geometry mSkyboxSphere;
+	/** Draws one fullscreen triangle, with the commands recorded into one reusable secondary command buffer per frame in flight: */
 	avk::graphics_pipeline mSkyboxPipeline;
-	avk::command_buffer mSkyboxCommandBuffer;
+	std::vector<avk::command_buffer> mSkyboxCommandBuffers;
+	bool mSkyboxCommandBuffersOutdated = true;
+
+	// ---------------- Dynamic resolution ----------------
+	/** The scene is rendered into the top left mRenderExtent pixels of mSceneFramebuffer (which has the backbuffer's size, mSceneExtent),
+	 *	and upscaled into the backbuffer by mUpscalePipeline. mDynamicResolution adjusts the render scale to the frames' GPU times: */
+	dynamic_resolution mDynamicResolution;
+	avk::framebuffer mSceneFramebuffer;
+	avk::image_sampler mSceneColorSampler;
+	avk::image_sampler mSceneDepthSampler;
+	bool mSceneFramebufferOutdated = true;
+	vk::Extent2D mSceneExtent;
+	vk::Extent2D mRenderExtent;
+	avk::graphics_pipeline mUpscalePipeline;
+	float mSharpness = 0.25f;
+
+	// ---------------- Occlusion culling -----------------
+	/** The depth pyramid of the rendered part of the scene's depth (half its size at level 0, see record_hiz_build), one storage view per level,
+	 *	and the compute pipeline which builds it. It is tested against in the next frame with the matrix and extent it has been built with: */
+	avk::image mHiZImage;
+	std::vector<avk::image_view> mHiZLevelViews;
+	avk::image_sampler mHiZSampler;
+	uint32_t mHiZLevelCount = 1;
+	bool mHiZLayoutUndefined = true;
+	bool mHiZValid = false;
+	glm::mat4 mHiZViewProjMatrix{ 1.0f };
+	glm::uvec2 mHiZRenderExtent{ 0u };
+	avk::compute_pipeline mHiZBuildPipeline;
+	/** Continues the shading pass with the scene's color and depth, for the draw calls which only the late occlusion culling phase has found visible: */
+	avk::renderpass mOcclusionLateRenderpass;
 
 	// ----------------------- ^^^  MEMBER VARIABLES  ^^^ -----------------------
 };
@@ -570,12 +2424,15 @@ private:
 //
 //  So it begins...
 // 
-int main() 
+int main(int argc, char** argv) 
 {
 	using namespace avk;
 
 	int result = EXIT_FAILURE;
 
+	// Benchmark mode: Plays back a camera preset in every render mode, writes a report, and exits (see benchmark::parse_command_line):
+	const auto benchmarkSettings = benchmark::parse_command_line(argc, argv);
+
 	try {
 		// Create a window, set some configuration parameters (also relevant for its swap chain), and open it:
 		auto mainWnd = context().create_window("ARTR 2024 Assignment 1");
@@ -583,7 +2440,7 @@ int main()
 		mainWnd->set_additional_back_buffer_attachments({
 			attachment::declare(vk::Format::eD32Sfloat, on_load::clear, usage::depth_stencil, on_store::dont_care)
 		});
-		mainWnd->enable_resizing(true);
+		mainWnd->enable_resizing(!benchmarkSettings.has_value()); // Every benchmark run renders at the same resolution
 		mainWnd->request_srgb_framebuffer(true);
 		mainWnd->set_presentaton_mode(presentation_mode::mailbox);
 		mainWnd->set_number_of_concurrent_frames(3u);
@@ -595,9 +2452,16 @@ int main()
 		auto& singleQueue = context().create_queue({}, queue_selection_preference::versatile_queue, mainWnd);
 		mainWnd->set_queue_family_ownership(singleQueue.family_index());
 		mainWnd->set_present_queue(singleQueue);
+		// ...except for the scene's geometry uploads, which get a separate queue, preferably of a transfer-only queue family:
+		auto& transferQueue = context().create_queue(vk::QueueFlagBits::eTransfer, queue_selection_preference::specialized_queue);
+		// ...and the per-frame compute passes, which overlap with the graphics work on a compute queue, preferably of a compute-only queue family:
+		auto& computeQueue = context().create_queue(vk::QueueFlagBits::eCompute, queue_selection_preference::specialized_queue);
 
 		// Create an instance of our main class which contains the relevant host code for Assignment 1:
-		auto app = assignment1(singleQueue);
+		auto app = assignment1(singleQueue, transferQueue, computeQueue);
+		if (benchmarkSettings.has_value()) {
+			app.enable_benchmark(*benchmarkSettings);
+		}
 
 		// Create another element for drawing the GUI via the library Dear ImGui:
 		auto ui = imgui_manager(singleQueue);
@@ -606,13 +2470,24 @@ int main()
 		// Two more utility elements:
 		auto lightsEditor = helpers::create_lightsource_editor(singleQueue, false);
 		auto camPresets = helpers::create_camera_presets(singleQueue, false);
+		// ...and one which records the command buffers of all of them on worker threads, and submits them together:
+		auto frameRecorder = frame_recorder(singleQueue);
 
 		// Pass everything to avk::start and off we go:
 		auto composition = configure_and_compose(
 			application_name("ARTR 2024 Framework"),
+			// Indirect drawing of the scene requires multi draw indirect, with firstInstance != 0 (the vertex shaders index the instance draw indices with gl_InstanceIndex):
+			[](vk::PhysicalDeviceFeatures& aFeatures) {
+				aFeatures.setMultiDrawIndirect(VK_TRUE);
+				aFeatures.setDrawIndirectFirstInstance(VK_TRUE);
+			},
+			// The completion of the geometry uploads and of the async compute passes are tracked with timeline semaphores:
+			[](vk::PhysicalDeviceVulkan12Features& aFeatures) {
+				aFeatures.setTimelineSemaphore(VK_TRUE);
+			},
 			mainWnd,
 			// Pass the so-called "invokees" which will get their callback methods (such as update() or render()) invoked:
-			app, ui, lightsEditor, camPresets
+			app, ui, lightsEditor, camPresets, frameRecorder
 		);
 		
 		// Create an invoker object, which defines the way how invokees/elements are invoked
@@ -630,6 +2505,8 @@ int main()
 			[&invoker](const std::vector<invokee*>& aToBeInvoked) {
 				// Sync (wait for fences and so) per window BEFORE executing render callbacks
 				avk::context().execute_for_each_window([](window* wnd) {
+					// Waits for the fence of the frame in flight and for the next swapchain image, i.e., for the GPU:
+					const cpu_profiler::scope profileSync{ "Fence wait and image acquire", true };
 					wnd->sync_before_render();
 				});
 
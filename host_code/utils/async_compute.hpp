@@ -0,0 +1,148 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <functional>
+
+/**	Submits per-frame compute passes to a separate (async compute) queue, s.t. they overlap with the graphics work of the previous frame.
+ *	Two timeline semaphores synchronize them: Every compute submission signals the next value of the compute timeline, which the frame's
+ *	graphics submission waits for, and every graphics submission signals the next value of the graphics timeline, which the compute
+ *	submission of the next frame with the same frame-in-flight index waits for (before overwriting what that frame has read).
+ *	If the compute queue belongs to a different queue family than the graphics queue, the ownership of the buffers which the compute passes
+ *	write must be released after them (see release_barriers), and acquired on the graphics queue before they are read (see acquire_barriers).
+ *	Is not thread-safe, i.e., must be used by the thread which submits to both queues only.
+ */
+class async_compute
+{
+public:
+	async_compute() = default;
+	async_compute(const async_compute&) = delete;
+	async_compute& operator=(const async_compute&) = delete;
+
+	~async_compute()
+	{
+		// Command buffers must not be destroyed while the compute passes are still in flight:
+		if (mComputeTimeline) {
+			const auto result = avk::context().device().waitSemaphores(vk::SemaphoreWaitInfo{}.setSemaphores(*mComputeTimeline).setValues(mLastComputeValue), UINT64_MAX);
+			assert(vk::Result::eSuccess == result);
+		}
+	}
+
+	/**	Create the timeline semaphores and a command pool for the compute queue, must be invoked before any other method.
+	 *	Requires the timelineSemaphore feature (Vulkan 1.2). If both queues are the same, is_available() returns false.
+	 */
+	void init(avk::queue& aComputeQueue, const avk::queue& aGraphicsQueue, uint32_t aFramesInFlight)
+	{
+		mComputeQueue = &aComputeQueue;
+		mComputeFamily = aComputeQueue.family_index();
+		mGraphicsFamily = aGraphicsQueue.family_index();
+		mAvailable = aComputeQueue.handle() != aGraphicsQueue.handle();
+		mCommandPool = avk::context().create_command_pool(mComputeFamily, vk::CommandPoolCreateFlagBits::eTransient);
+		mGraphicsValuesPerFrameInFlight.assign(aFramesInFlight, 0);
+
+		vk::SemaphoreTypeCreateInfo typeCreateInfo{ vk::SemaphoreType::eTimeline, 0 };
+		mComputeTimeline = avk::context().device().createSemaphoreUnique(vk::SemaphoreCreateInfo{}.setPNext(&typeCreateInfo));
+		mGraphicsTimeline = avk::context().device().createSemaphoreUnique(vk::SemaphoreCreateInfo{}.setPNext(&typeCreateInfo));
+	}
+
+	/** Whether there is a separate compute queue, otherwise, the compute passes have to be recorded into the graphics command buffers */
+	bool is_available() const
+	{
+		return mAvailable;
+	}
+
+	/** Whether the buffers written on the compute queue must be transferred to the graphics queue family */
+	bool needs_ownership_transfer() const
+	{
+		return mAvailable && mComputeFamily != mGraphicsFamily;
+	}
+
+	avk::queue& compute_queue() const
+	{
+		return *mComputeQueue;
+	}
+
+	/**	Record the compute passes of a frame into a command buffer, and submit it to the compute queue. It waits for the graphics submission
+	 *	of the previous frame with the same frame-in-flight index, which has read what the passes overwrite.
+	 *	@param	aInFlightIndex		Frame-in-flight index of the frame whose compute passes are recorded
+	 *	@param	aRecord				Records the compute passes (and the release barriers, if needed) into the given command buffer
+	 *	@return	The value of the compute timeline which is signalled when the passes have completed
+	 */
+	uint64_t submit(avk::window::frame_id_t aInFlightIndex, const std::function<void(avk::command_buffer_t&)>& aRecord)
+	{
+		auto cmdBfr = mCommandPool->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		cmdBfr->begin_recording();
+		aRecord(*cmdBfr);
+		cmdBfr->end_recording();
+
+		const uint64_t waitValue = mGraphicsValuesPerFrameInFlight[static_cast<size_t>(aInFlightIndex) % mGraphicsValuesPerFrameInFlight.size()];
+		const uint64_t signalValue = ++mLastComputeValue;
+		const vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader;
+		vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+		timelineSubmitInfo.setWaitSemaphoreValues(waitValue).setSignalSemaphoreValues(signalValue);
+		mComputeQueue->handle().submit(
+			vk::SubmitInfo{}
+				.setWaitSemaphores(*mGraphicsTimeline)
+				.setWaitDstStageMask(waitStage)
+				.setCommandBuffers(cmdBfr->handle())
+				.setSignalSemaphores(*mComputeTimeline)
+				.setPNext(&timelineSubmitInfo)
+		);
+
+		// The command buffer is deleted after #concurrent-frames have passed by, i.e., after the graphics work which waits for it:
+		avk::context().main_window()->handle_lifetime(std::move(cmdBfr));
+		return signalValue;
+	}
+
+	vk::Semaphore compute_timeline() const
+	{
+		return *mComputeTimeline;
+	}
+
+	vk::Semaphore graphics_timeline() const
+	{
+		return *mGraphicsTimeline;
+	}
+
+	/** The next value of the graphics timeline, which the graphics submission of the frame with the given frame-in-flight index must signal */
+	uint64_t next_graphics_value(avk::window::frame_id_t aInFlightIndex)
+	{
+		const uint64_t value = ++mLastGraphicsValue;
+		mGraphicsValuesPerFrameInFlight[static_cast<size_t>(aInFlightIndex) % mGraphicsValuesPerFrameInFlight.size()] = value;
+		return value;
+	}
+
+	/** Barriers which release the given buffers from the compute queue family, to be recorded after the compute passes have written them */
+	std::vector<vk::BufferMemoryBarrier> release_barriers(const std::vector<vk::Buffer>& aBuffers) const
+	{
+		return ownership_transfer_barriers(aBuffers, vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite, {});
+	}
+
+	/** Barriers which acquire the given buffers on the graphics queue family, to be recorded before they are read with the given accesses */
+	std::vector<vk::BufferMemoryBarrier> acquire_barriers(const std::vector<vk::Buffer>& aBuffers, vk::AccessFlags aDstAccess) const
+	{
+		return ownership_transfer_barriers(aBuffers, {}, aDstAccess);
+	}
+
+private:
+	std::vector<vk::BufferMemoryBarrier> ownership_transfer_barriers(const std::vector<vk::Buffer>& aBuffers, vk::AccessFlags aSrcAccess, vk::AccessFlags aDstAccess) const
+	{
+		std::vector<vk::BufferMemoryBarrier> barriers;
+		barriers.reserve(aBuffers.size());
+		for (const auto& buffer : aBuffers) {
+			barriers.emplace_back(aSrcAccess, aDstAccess, mComputeFamily, mGraphicsFamily, buffer, 0, VK_WHOLE_SIZE);
+		}
+		return barriers;
+	}
+
+	avk::queue* mComputeQueue = nullptr;
+	uint32_t mComputeFamily = 0;
+	uint32_t mGraphicsFamily = 0;
+	bool mAvailable = false;
+	avk::command_pool mCommandPool;
+	vk::UniqueSemaphore mComputeTimeline;
+	vk::UniqueSemaphore mGraphicsTimeline;
+	uint64_t mLastComputeValue = 0;
+	uint64_t mLastGraphicsValue = 0;
+	/** The graphics timeline value which the last frame with each frame-in-flight index signals */
+	std::vector<uint64_t> mGraphicsValuesPerFrameInFlight;
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <deque>
+
+/** Submits buffer uploads to a (transfer) queue without waiting for them, and tracks their completion with one timeline semaphore.
+ *	Every submission signals the next value of the timeline semaphore; a resource must not be used before completed_value()
+ *	has reached the value which has been returned for its upload.
+ *	If the transfer queue belongs to a different queue family than the graphics queue, the ownership of the uploaded buffers is
+ *	released after the upload, and must be acquired on the graphics queue through record_acquire_barriers_for_completed_uploads.
+ *	Otherwise, that method records a memory barrier which makes the transfer writes visible to the graphics queue's reads.
+ *	Is not thread-safe, i.e., must be used by the thread which submits to both queues only.
+ */
+class async_uploader
+{
+public:
+	async_uploader() = default;
+	async_uploader(const async_uploader&) = delete;
+	async_uploader& operator=(const async_uploader&) = delete;
+
+	~async_uploader()
+	{
+		// Buffers and command buffers must not be destroyed while the uploads are still in flight:
+		if (mTimelineSemaphore) {
+			wait_until_completed(mLastSubmittedValue);
+		}
+	}
+
+	/** Create the timeline semaphore and a command pool for the transfer queue, must be invoked before any other method.
+	 *	Requires the timelineSemaphore feature (Vulkan 1.2).
+	 */
+	void init(avk::queue& aTransferQueue, const avk::queue& aGraphicsQueue)
+	{
+		mTransferQueue = &aTransferQueue;
+		mTransferFamily = aTransferQueue.family_index();
+		mGraphicsFamily = aGraphicsQueue.family_index();
+		mCommandPool = avk::context().create_command_pool(mTransferFamily, vk::CommandPoolCreateFlagBits::eTransient);
+
+		vk::SemaphoreTypeCreateInfo typeCreateInfo{ vk::SemaphoreType::eTimeline, 0 };
+		mTimelineSemaphore = avk::context().device().createSemaphoreUnique(vk::SemaphoreCreateInfo{}.setPNext(&typeCreateInfo));
+	}
+
+	/** Record the given commands (typically buffer_t::fill commands) into a command buffer, and submit it to the transfer queue.
+	 *	@param	aCommands		The upload commands
+	 *	@param	aBuffers		All buffers which are written by aCommands, their ownership is transferred to the graphics queue family
+	 *	@return	The timeline value which is signalled when the upload has completed
+	 */
+	uint64_t submit(std::vector<avk::recorded_commands_t> aCommands, std::vector<vk::Buffer> aBuffers)
+	{
+		if (needs_ownership_transfer()) {
+			aCommands.push_back(avk::command::custom_commands([this, &aBuffers](avk::command_buffer_t& cb) {
+				// Release the buffers from the transfer queue family, after the transfer writes have completed:
+				cb.handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {},
+					ownership_transfer_barriers(aBuffers, vk::AccessFlagBits::eTransferWrite, {}), {});
+			}));
+		}
+
+		auto cmdBfr = mCommandPool->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		avk::context().record(std::move(aCommands)).into_command_buffer(cmdBfr);
+
+		const uint64_t signalValue = ++mLastSubmittedValue;
+		vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+		timelineSubmitInfo.setSignalSemaphoreValues(signalValue);
+		mTransferQueue->handle().submit(
+			vk::SubmitInfo{}
+				.setCommandBuffers(cmdBfr->handle())
+				.setSignalSemaphores(*mTimelineSemaphore)
+				.setPNext(&timelineSubmitInfo)
+		);
+
+		mPendingUploads.push_back(pending_upload{ signalValue, std::move(cmdBfr), std::move(aBuffers) });
+		return signalValue;
+	}
+
+	/** The value of the highest upload which has completed, does not block */
+	uint64_t completed_value() const
+	{
+		return avk::context().device().getSemaphoreCounterValue(*mTimelineSemaphore);
+	}
+
+	/** The value of the last submitted upload, i.e., all uploads have completed if completed_value() has reached it */
+	uint64_t last_submitted_value() const
+	{
+		return mLastSubmittedValue;
+	}
+
+	/** Whether there are uploads whose resources have not been released by record_acquire_barriers_for_completed_uploads yet */
+	bool has_pending_uploads() const
+	{
+		return !mPendingUploads.empty();
+	}
+
+	/** Block until the upload with the given value has completed */
+	void wait_until_completed(uint64_t aValue) const
+	{
+		const auto result = avk::context().device().waitSemaphores(vk::SemaphoreWaitInfo{}.setSemaphores(*mTimelineSemaphore).setValues(aValue), UINT64_MAX);
+		assert(vk::Result::eSuccess == result);
+	}
+
+	/** Record the acquire barriers (or, within one queue family, a memory barrier) for all completed uploads' buffers into a command buffer
+	 *	which is submitted to the graphics queue, and release the completed uploads' resources. Must be recorded outside of a renderpass, before the buffers are used.
+	 *	@return	The completed value, i.e., all uploads up to this value may be used by commands recorded after the barriers
+	 */
+	uint64_t record_acquire_barriers_for_completed_uploads(const vk::CommandBuffer& aGraphicsCommandBuffer)
+	{
+		const auto completed = completed_value();
+		std::vector<vk::Buffer> buffers;
+		while (!mPendingUploads.empty() && mPendingUploads.front().mValue <= completed) {
+			auto& upload = mPendingUploads.front();
+			buffers.insert(std::end(buffers), std::begin(upload.mBuffers), std::end(upload.mBuffers));
+			if (needs_ownership_transfer()) {
+				// The command buffer which contains the release barriers must stay alive until the acquire barriers have executed:
+				avk::context().main_window()->handle_lifetime(std::move(upload.mCommandBuffer));
+			}
+			mPendingUploads.pop_front();
+		}
+		if (needs_ownership_transfer() && !buffers.empty()) {
+			aGraphicsCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+				vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eComputeShader, {}, {},
+				ownership_transfer_barriers(buffers, {}, vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eShaderRead), {});
+		}
+		else if (!buffers.empty()) {
+			// The host having observed the timeline value only proves that the copies have finished, their writes must still be made visible:
+			aGraphicsCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eComputeShader, {},
+				vk::MemoryBarrier{ vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eShaderRead },
+				{}, {});
+		}
+		return completed;
+	}
+
+private:
+	struct pending_upload
+	{
+		uint64_t mValue;
+		avk::command_buffer mCommandBuffer;
+		std::vector<vk::Buffer> mBuffers;
+	};
+
+	bool needs_ownership_transfer() const
+	{
+		return mTransferFamily != mGraphicsFamily;
+	}
+
+	std::vector<vk::BufferMemoryBarrier> ownership_transfer_barriers(const std::vector<vk::Buffer>& aBuffers, vk::AccessFlags aSrcAccess, vk::AccessFlags aDstAccess) const
+	{
+		std::vector<vk::BufferMemoryBarrier> barriers;
+		barriers.reserve(aBuffers.size());
+		for (const auto& buffer : aBuffers) {
+			barriers.emplace_back(aSrcAccess, aDstAccess, mTransferFamily, mGraphicsFamily, buffer, 0, VK_WHOLE_SIZE);
+		}
+		return barriers;
+	}
+
+	avk::queue* mTransferQueue = nullptr;
+	uint32_t mTransferFamily = 0;
+	uint32_t mGraphicsFamily = 0;
+	avk::command_pool mCommandPool;
+	vk::UniqueSemaphore mTimelineSemaphore;
+	uint64_t mLastSubmittedValue = 0;
+	std::deque<pending_upload> mPendingUploads;
+};
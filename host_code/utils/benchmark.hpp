@@ -0,0 +1,274 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <numeric>
+
+#include "camera_presets.hpp"
+#include "gpu_profiler.hpp"
+
+/**	Deterministic benchmark runs: Every render mode is measured over the same camera_presets motion, which is played back at a
+ *	fixed timestep, s.t. every run renders exactly the same frames, no matter how long they take. Every run consists of warm-up
+ *	frames, measured frames, and a few cool-down frames, during which the GPU times of the last measured frames are resolved.
+ *	The CPU frame times and the GPU times of the profiler's scopes are summarized per run, and written as CSV and JSON report.
+ */
+class benchmark
+{
+public:
+	struct settings
+	{
+		/** Name of the camera preset (a circular motion or a path) which is played back in every run */
+		std::string mCameraPreset = "A1 autocam";
+		uint32_t mWarmupFrames = 120;
+		uint32_t mMeasuredFrames = 600;
+		/** Seconds the camera motion advances per frame */
+		float mTimestep = 1.0f / 60.0f;
+		/** Path of the report files without extension, ".csv" and ".json" are appended */
+		std::string mReportPath = "benchmark_report";
+		/** Names of the render modes to run, all of them if empty */
+		std::vector<std::string> mModes;
+	};
+
+	/** A render mode: its name, and a function which applies its settings (invoked before its run begins) */
+	struct mode
+	{
+		std::string mName;
+		std::function<void()> mApply;
+	};
+
+	/** Summary of the samples of one metric of a run, all in milliseconds */
+	struct metric_summary
+	{
+		size_t mSampleCount = 0;
+		double mAvgMs = 0.0, mMinMs = 0.0, mP50Ms = 0.0, mP90Ms = 0.0, mP95Ms = 0.0, mP99Ms = 0.0, mMaxMs = 0.0;
+	};
+
+	/**	Parse the benchmark options from the command line, available options are:
+	 *	--benchmark, --benchmark-preset=<name>, --benchmark-warmup=<frames>, --benchmark-frames=<frames>,
+	 *	--benchmark-timestep=<seconds>, --benchmark-report=<path without extension>, --benchmark-modes=<name>,<name>,...
+	 *	@return	The settings if any of the options is given, std::nullopt otherwise
+	 */
+	static std::optional<settings> parse_command_line(int argc, char** argv)
+	{
+		std::optional<settings> result;
+		for (int i = 1; i < argc; ++i) {
+			const std::string_view arg = argv[i];
+			if (!arg.starts_with("--benchmark")) {
+				continue;
+			}
+			if (!result.has_value()) {
+				result.emplace();
+			}
+			const auto separator = arg.find('=');
+			const auto key = arg.substr(0, separator);
+			const auto value = std::string{ std::string_view::npos == separator ? std::string_view{} : arg.substr(separator + 1) };
+			try {
+				if ("--benchmark-preset" == key)        { result->mCameraPreset = value; }
+				else if ("--benchmark-warmup" == key)   { result->mWarmupFrames = static_cast<uint32_t>(std::stoul(value)); }
+				else if ("--benchmark-frames" == key)   { result->mMeasuredFrames = std::max(1u, static_cast<uint32_t>(std::stoul(value))); }
+				else if ("--benchmark-timestep" == key) { result->mTimestep = std::stof(value); }
+				else if ("--benchmark-report" == key)   { result->mReportPath = value; }
+				else if ("--benchmark-modes" == key) {
+					for (size_t begin = 0; begin < value.size();) {
+						const auto end = std::min(value.find(',', begin), value.size());
+						result->mModes.push_back(value.substr(begin, end - begin));
+						begin = end + 1;
+					}
+				}
+				else if ("--benchmark" != key) {
+					LOG_WARNING(std::format("Unknown benchmark option '{}'", arg));
+				}
+			}
+			catch (const std::exception&) {
+				LOG_WARNING(std::format("Invalid value of benchmark option '{}'", arg));
+			}
+		}
+		return result;
+	}
+
+	/**	Create a benchmark which measures the given modes (filtered by aSettings.mModes) one after the other.
+	 *	@param	aDescription	Additional key/value pairs written into the report, e.g., compile-time configuration
+	 */
+	benchmark(settings aSettings, std::vector<mode> aModes, std::vector<std::pair<std::string, std::string>> aDescription = {})
+		: mSettings{ std::move(aSettings) }
+		, mDescription{ std::move(aDescription) }
+	{
+		for (auto& m : aModes) {
+			if (mSettings.mModes.empty() || std::end(mSettings.mModes) != std::find(std::begin(mSettings.mModes), std::end(mSettings.mModes), m.mName)) {
+				mRuns.push_back(run{ std::move(m), {}, {} });
+			}
+		}
+		if (mRuns.empty()) {
+			LOG_WARNING("None of the requested benchmark modes exists, nothing to measure.");
+		}
+		mCooldownFrames = static_cast<uint32_t>(avk::context().main_window()->number_of_frames_in_flight());
+	}
+
+	/**	Advance to the next frame, must be invoked once per frame before the camera presets are updated: Collects the samples of
+	 *	the previous frame, begins the next run when the current one is done, and sets the camera presets' playback time.
+	 *	@return	false if all runs are done, i.e., the report can be written
+	 */
+	bool next_frame(const gpu_profiler& aProfiler)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		const auto endOfMeasurement = mSettings.mWarmupFrames + mSettings.mMeasuredFrames;
+		if (mStarted && mRunIndex < mRuns.size()) {
+			auto& r = mRuns[mRunIndex];
+			// The CPU time of a frame is the time from the beginning of its update to the beginning of the next one's:
+			if (mFrameInRun >= mSettings.mWarmupFrames && mFrameInRun < endOfMeasurement) {
+				r.mCpuFrameMs.push_back(std::chrono::duration<double, std::milli>(now - mPreviousFrameStart).count());
+			}
+			// GPU times are resolved some frames later, they are taken from the measured frames only:
+			const auto resolved = aProfiler.last_resolved_frame_number();
+			if (resolved.has_value() && resolved != mLastTakenGpuFrame && *resolved >= r.mFirstGpuFrame && *resolved < r.mEndGpuFrame) {
+				for (const auto& [path, ms] : aProfiler.last_resolved_scopes()) {
+					auto it = std::find_if(std::begin(r.mGpuScopeMs), std::end(r.mGpuScopeMs), [&p = path](const auto& s) { return s.first == p; });
+					if (std::end(r.mGpuScopeMs) == it) {
+						it = r.mGpuScopeMs.insert(std::end(r.mGpuScopeMs), { path, {} });
+					}
+					it->second.push_back(static_cast<double>(ms));
+				}
+				mLastTakenGpuFrame = resolved;
+			}
+
+			// Advance within the current run, or on to the next one:
+			if (++mFrameInRun == endOfMeasurement + mCooldownFrames) {
+				++mRunIndex;
+				mFrameInRun = 0;
+			}
+		}
+		mStarted = true;
+		mPreviousFrameStart = now;
+		if (mRunIndex >= mRuns.size()) {
+			return false;
+		}
+
+		auto& r = mRuns[mRunIndex];
+		if (0 == mFrameInRun) {
+			LOG_INFO(std::format("Benchmark run {}/{}: {}", mRunIndex + 1, mRuns.size(), r.mMode.mName));
+			r.mMode.mApply();
+		}
+		// The profiler numbers the frames consecutively, the frame which is begun next gets the current frame count:
+		if (mFrameInRun == mSettings.mWarmupFrames) {
+			r.mFirstGpuFrame = aProfiler.frame_count();
+		}
+		if (mFrameInRun == endOfMeasurement) {
+			r.mEndGpuFrame = aProfiler.frame_count();
+		}
+
+		// Play back the camera motion at the fixed timestep, from its beginning in every run:
+		auto* camPresets = avk::current_composition()->element_by_type<camera_presets>();
+		if (nullptr != camPresets) {
+			camPresets->set_time_override(time());
+			if (0 == mFrameInRun) {
+				camPresets->invoke_preset(mSettings.mCameraPreset);
+			}
+		}
+		return true;
+	}
+
+	/** Playback time of the current frame in seconds, the same for the same frame of every run */
+	float time() const
+	{
+		return static_cast<float>(mFrameInRun) * mSettings.mTimestep;
+	}
+
+	/** Name of the current run's mode and the progress within it, e.g., for displaying it */
+	std::string progress() const
+	{
+		if (mRunIndex >= mRuns.size()) {
+			return "done";
+		}
+		const auto total = mSettings.mWarmupFrames + mSettings.mMeasuredFrames + mCooldownFrames;
+		return std::format("run {}/{} ({}): frame {}/{}", mRunIndex + 1, mRuns.size(), mRuns[mRunIndex].mMode.mName, mFrameInRun, total);
+	}
+
+	/** Compute the summary of the given samples */
+	static metric_summary summarize(std::vector<double> aSamples)
+	{
+		metric_summary result;
+		result.mSampleCount = aSamples.size();
+		if (aSamples.empty()) {
+			return result;
+		}
+		std::sort(std::begin(aSamples), std::end(aSamples));
+		const auto percentile = [&aSamples](double p) {
+			// Nearest-rank percentile:
+			const auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(aSamples.size())));
+			return aSamples[std::clamp<size_t>(rank, 1, aSamples.size()) - 1];
+		};
+		result.mAvgMs = std::accumulate(std::begin(aSamples), std::end(aSamples), 0.0) / static_cast<double>(aSamples.size());
+		result.mMinMs = aSamples.front();
+		result.mP50Ms = percentile(50.0);
+		result.mP90Ms = percentile(90.0);
+		result.mP95Ms = percentile(95.0);
+		result.mP99Ms = percentile(99.0);
+		result.mMaxMs = aSamples.back();
+		return result;
+	}
+
+	/**	Write the summaries of all runs to <mReportPath>.csv (one row per run and metric) and <mReportPath>.json.
+	 *	The metric of the CPU frame times is named "cpu/frame", those of the GPU scopes "gpu/" followed by the scope's path.
+	 *	@return	true if both files could be written
+	 */
+	bool write_report() const
+	{
+		std::ofstream csv(mSettings.mReportPath + ".csv");
+		std::ofstream json(mSettings.mReportPath + ".json");
+		if (!csv || !json) {
+			LOG_ERROR(std::format("Failed to write the benchmark report to '{}'", mSettings.mReportPath));
+			return false;
+		}
+
+		csv << "mode,metric,samples,avg_ms,min_ms,p50_ms,p90_ms,p95_ms,p99_ms,max_ms\n";
+		json << "{\n\t\"cameraPreset\": \"" << mSettings.mCameraPreset << "\",\n\t\"timestep\": " << mSettings.mTimestep
+			 << ",\n\t\"warmupFrames\": " << mSettings.mWarmupFrames << ",\n\t\"measuredFrames\": " << mSettings.mMeasuredFrames;
+		for (const auto& [key, value] : mDescription) {
+			json << ",\n\t\"" << key << "\": \"" << value << "\"";
+		}
+		json << ",\n\t\"runs\": [";
+		for (size_t i = 0; i < mRuns.size(); ++i) {
+			const auto& r = mRuns[i];
+			std::vector<std::pair<std::string, const std::vector<double>*>> metrics{ { "cpu/frame", &r.mCpuFrameMs } };
+			for (const auto& [path, samples] : r.mGpuScopeMs) {
+				metrics.emplace_back("gpu/" + path, &samples);
+			}
+			json << (0 == i ? "\n" : ",\n") << "\t\t{ \"mode\": \"" << r.mMode.mName << "\", \"metrics\": {";
+			for (size_t j = 0; j < metrics.size(); ++j) {
+				const auto s = summarize(*metrics[j].second);
+				csv << std::format("{},{},{},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f}\n",
+					r.mMode.mName, metrics[j].first, s.mSampleCount, s.mAvgMs, s.mMinMs, s.mP50Ms, s.mP90Ms, s.mP95Ms, s.mP99Ms, s.mMaxMs);
+				json << (0 == j ? "\n" : ",\n") << std::format("\t\t\t\"{}\": {{ \"samples\": {}, \"avgMs\": {:.4f}, \"minMs\": {:.4f}, \"p50Ms\": {:.4f}, \"p90Ms\": {:.4f}, \"p95Ms\": {:.4f}, \"p99Ms\": {:.4f}, \"maxMs\": {:.4f} }}",
+					metrics[j].first, s.mSampleCount, s.mAvgMs, s.mMinMs, s.mP50Ms, s.mP90Ms, s.mP95Ms, s.mP99Ms, s.mMaxMs);
+			}
+			json << "\n\t\t} }";
+		}
+		json << "\n\t]\n}\n";
+		LOG_INFO(std::format("Benchmark report written to '{}.csv' and '{}.json'", mSettings.mReportPath, mSettings.mReportPath));
+		return static_cast<bool>(csv) && static_cast<bool>(json);
+	}
+
+private:
+	struct run
+	{
+		mode mMode;
+		std::vector<double> mCpuFrameMs;
+		/** GPU times per scope path, in the order of the scopes' first appearance */
+		std::vector<std::pair<std::string, std::vector<double>>> mGpuScopeMs;
+		/** Range of the profiler's frame numbers of the measured frames */
+		uint64_t mFirstGpuFrame = std::numeric_limits<uint64_t>::max();
+		uint64_t mEndGpuFrame = std::numeric_limits<uint64_t>::max();
+	};
+
+	settings mSettings;
+	std::vector<std::pair<std::string, std::string>> mDescription;
+	std::vector<run> mRuns;
+	size_t mRunIndex = 0;
+	uint32_t mFrameInRun = 0;
+	uint32_t mCooldownFrames = 3;
+	bool mStarted = false;
+	std::chrono::steady_clock::time_point mPreviousFrameStart;
+	std::optional<uint64_t> mLastTakenGpuFrame;
+};
@@ -10,10 +10,12 @@
 #include "cubic_uniform_b_spline.hpp"
 #include "orbit_camera.hpp"
 #include "quadratic_uniform_b_spline.hpp"
+#include "frame_recorder.hpp"
+#include "cpu_profiler.hpp"
 
 // TODO! light gizmos and path rendering will probably break if main uses a different renderpass setup!
 
-// TODO: paths: constant speed, closed paths
+// TODO: paths: closed paths
 // TODO: paths: autoclose ?
 
 class camera_presets : public avk::invokee
@@ -166,7 +168,7 @@ public:
 		p.path_duration = aDuration;
 		p.path_cyclic = aCyclic;
 		p.path_control_points = aControlPoints;
-		p.path_interpolation()->set_control_points(p.path_control_points);
+		p.path_changed();
 		p.focus = aFocus;
 		p.m_focus_type = aFocusType;
 		mPresets.push_back(p);
@@ -230,20 +232,26 @@ public:
 	bool is_gui_enabled() { return mGuiEnabled; }
 	void set_gui_enabled(bool aEnabled) { mGuiEnabled = aEnabled; }
 
+	// play back the motion presets at the given time (in seconds) instead of the context's time, e.g., for deterministic benchmarks; std::nullopt to use the context's time again
+	void set_time_override(std::optional<float> aTime) { mTimeOverride = aTime; }
+
 	void initialize() override
 	{
+		// Create the path visualization's pipelines up front, s.t. toggling the visualization for the first time doesn't stall:
+		init_rendering();
 		init_gui();
 	}
 
 	void update() override
 	{
+		const cpu_profiler::scope profileUpdate{ "Camera presets (update)" };
 		// check if any motion preset is active
 		auto quakeCam = avk::current_composition()->element_by_type<avk::quake_camera>();
 		auto orbitCam = avk::current_composition()->element_by_type<avk::orbit_camera>();
 		if (!quakeCam || !orbitCam) return;
 		for (auto &p : mPresets) {
 			if (p.motion_active) {
-				float time = static_cast<float>(avk::context().get_time());
+				float time = current_time();
 				if (p.type == preset_type::circular) {
 					float angle = fmod((time - p.motion_start_time) * p.angular_speed + p.start_angle, glm::two_pi<float>());
 					glm::vec3 pos = p.center + glm::vec3(cos(angle) * p.radius_xz[0], 0, sin(angle) * p.radius_xz[1]);
@@ -256,10 +264,8 @@ public:
 					case focus_type::forward:
 					case focus_type::backward:
 					{
-						// TODO calc proper tangent to the ellipse
-						const float da = glm::radians(5.0f) * glm::sign(p.angular_speed);
-						glm::vec3 pos2 = p.center + glm::vec3(cos(angle + da) * p.radius_xz[0], 0, sin(angle + da) * p.radius_xz[1]);
-						dir = pos2 - pos;
+						// tangent to the ellipse: derivative of the position with respect to the angle, in the direction of the motion
+						dir = glm::vec3(-sin(angle) * p.radius_xz[0], 0, cos(angle) * p.radius_xz[1]) * glm::sign(p.angular_speed);
 						if (p.m_focus_type == focus_type::backward) dir = -dir;
 						break;
 					}
@@ -270,29 +276,31 @@ public:
 						orbitCam->look_along(dir);
 					}
 				} else if (p.type == preset_type::path) {
-					float tSpline = 0.0f;
+					// fraction of the path's arc length, i.e., the camera moves at constant speed
+					float tPath = 0.0f;
 
 					if (!p.is_path_valid()) p.motion_active = false;
 
 					if (p.motion_active) {
-						tSpline = (time - p.motion_start_time) / p.path_duration;
-						if (tSpline > 1.0f) {
+						tPath = (time - p.motion_start_time) / p.path_duration;
+						if (tPath > 1.0f) {
 							if (p.path_cyclic) {
-								tSpline = glm::fract(tSpline);
+								tPath = glm::fract(tPath);
 							} else {
 								p.motion_active = false;
 							}
 						}
 					}
 					if (p.motion_active) {
-						glm::vec3 pos = p.path_interpolation()->value_at(tSpline);
-						//glm::vec3 dir = p.path_interpolation()->slope_at(tSpline);
+						p.bake_path(); // only if it has changed since it was baked last
+						glm::vec3 pos, tangent;
+						p.sample_baked_path(tPath, pos, tangent);
 						glm::vec3 dir;
 						switch (p.m_focus_type) {
 						case focus_type::towards_point:		dir = p.focus - pos;	break;
 						case focus_type::away_from_point:	dir = pos - p.focus;	break;
-						case focus_type::forward:			dir =  p.path_interpolation()->slope_at(tSpline);	break;
-						case focus_type::backward:			dir = -p.path_interpolation()->slope_at(tSpline);	break;
+						case focus_type::forward:			dir =  tangent;			break;
+						case focus_type::backward:			dir = -tangent;			break;
 						default:							dir = glm::vec3(0);		break;
 						}
 
@@ -311,8 +319,8 @@ public:
 
 	void render() override
 	{
+		const cpu_profiler::scope profileRender{ "Camera presets (render)" };
 		if (!mVisualizePath) return;
-		if (!mRenderingInited) init_rendering();
 
 		auto preset = find_preset(mVisualizePathPresetName);
 		if (!preset) return;
@@ -324,39 +332,52 @@ public:
 
 		auto fif = avk::context().main_window()->in_flight_index_for_frame();
 
-		// fill path and control points vertex buffer
-		std::vector<glm::vec3> pathPoints(MAX_POINTS_TO_VISUALIZE);
-		for (int i = 0; i < MAX_POINTS_TO_VISUALIZE; ++i) {
-			float t = static_cast<float>(i) / (MAX_POINTS_TO_VISUALIZE - 1);
-			pathPoints[i] = preset->path_interpolation()->value_at(t);
-		}
+		// the visualized path is the baked one, i.e., what the camera follows
+		preset->bake_path();
+		auto &pathPoints = preset->baked_positions;
 		auto &ctrlPoints = preset->path_control_points;
-		auto fence = avk::context().record_and_submit_with_fence({
-			mVertexBufferVisPath1[fif]->fill(pathPoints.data(), 0, 0, pathPoints.size() * sizeof(pathPoints[0])),
-			mVertexBufferVisPath2[fif]->fill(ctrlPoints.data(), 0, 0, ctrlPoints.size() * sizeof(ctrlPoints[0]))
-		}, *mQueue);
-		fence->wait_until_signalled(); // A fence means a heavy barrier here, but ok here, as this is only used for designing paths // TODO: Use semaphore?!
+
+		// fill path and control points vertex buffer of this frame in flight, only if the path has been edited (or another one is visualized) since it was filled last
+		if (mVertexBuffersVisPathVersion[fif] != preset->path_version) {
+			auto fence = avk::context().record_and_submit_with_fence({
+				mVertexBufferVisPath1[fif]->fill(pathPoints.data(), 0, 0, pathPoints.size() * sizeof(pathPoints[0])),
+				mVertexBufferVisPath2[fif]->fill(ctrlPoints.data(), 0, 0, ctrlPoints.size() * sizeof(ctrlPoints[0]))
+			}, *mQueue);
+			fence->wait_until_signalled(); // A fence means a heavy barrier here, but ok here, as this is only used for designing paths // TODO: Use semaphore?!
+			mVertexBuffersVisPathVersion[fif] = preset->path_version;
+		}
+
+		const auto recordPathVisualization = [this, fif, numPathPoints = pathPoints.size(), numCtrlPoints = ctrlPoints.size(), viewProjMatrix = cam->projection_and_view_matrix(), pointToHighlight = mVisualizePathCurrentPointIndex](avk::command_buffer_t& cb) {
+			cb.record(avk::command::bind_pipeline(mPipelineVisPath1.as_reference()));
+			PushConstantsVisPath pushConstants = {};
+			pushConstants.mViewProjMatrix = viewProjMatrix;
+			pushConstants.mColor          = glm::vec4(1,0,0,1);
+			pushConstants.mColor2         = glm::vec4(0);
+			pushConstants.mVertexToHighlight = -1;
+
+			cb.handle().pushConstants(mPipelineVisPath1->layout_handle(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(pushConstants), &pushConstants);
+			cb.record(avk::command::draw_vertices(static_cast<uint32_t>(numPathPoints), 1u, 0u, 0u, mVertexBufferVisPath1[fif].as_reference()));
+			cb.record(avk::command::bind_pipeline(mPipelineVisPath2.as_reference()));
+			pushConstants.mColor          = glm::vec4(0, 1, 0, 10);
+			pushConstants.mColor2         = glm::vec4(0, 1, 1, 0);
+			pushConstants.mVertexToHighlight = pointToHighlight;
+			cb.handle().pushConstants(mPipelineVisPath2->layout_handle(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(pushConstants), &pushConstants);
+			cb.record(avk::command::draw_vertices(static_cast<uint32_t>(numCtrlPoints), 1u, 0u, 0u, mVertexBufferVisPath2[fif].as_reference()));
+		};
+
+		// if there is a frame_recorder, let it record the visualization on a worker thread, and submit it together with everything else:
+		auto recorder = avk::current_composition()->element_by_type<frame_recorder>();
+		if (recorder) {
+			const auto pass = recorder->add_pass(mPipelineVisPath1->renderpass_reference(), avk::context().main_window()->current_backbuffer_reference());
+			recorder->add_job(pass, recordPathVisualization);
+			return;
+		}
 
 		// record command buffer
 		auto cmdBfr = mCommandPool->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 		cmdBfr->begin_recording();
 		cmdBfr->record(avk::command::begin_render_pass_for_framebuffer(mPipelineVisPath1->renderpass_reference(), avk::context().main_window()->current_backbuffer_reference()));
-		cmdBfr->record(avk::command::bind_pipeline(mPipelineVisPath1.as_reference()));
-		PushConstantsVisPath pushConstants = {};
-		pushConstants.mViewProjMatrix = cam->projection_and_view_matrix();
-		pushConstants.mColor          = glm::vec4(1,0,0,1);
-		pushConstants.mColor2         = glm::vec4(0);
-		pushConstants.mVertexToHighlight = -1;
-
-		cmdBfr->handle().pushConstants(mPipelineVisPath1->layout_handle(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(pushConstants), &pushConstants);
-		cmdBfr->record(avk::command::draw_vertices(static_cast<uint32_t>(pathPoints.size()), 1u, 0u, 0u, mVertexBufferVisPath1[fif].as_reference()));
-		cmdBfr->record(avk::command::bind_pipeline(mPipelineVisPath2.as_reference()));
-		pushConstants.mColor          = glm::vec4(0, 1, 0, 10);
-		pushConstants.mColor2         = glm::vec4(0, 1, 1, 0);
-		pushConstants.mVertexToHighlight = mVisualizePathCurrentPointIndex;
-		cmdBfr->handle().pushConstants(mPipelineVisPath2->layout_handle(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(pushConstants), &pushConstants);
-		cmdBfr->record(avk::command::draw_vertices(static_cast<uint32_t>(ctrlPoints.size()), 1u, 0u, 0u, mVertexBufferVisPath2[fif].as_reference()));
-
+		recordPathVisualization(*cmdBfr);
 		cmdBfr->record(avk::command::end_render_pass());
 		cmdBfr->end_recording();
 
@@ -419,6 +440,68 @@ private:
 			if (m_path_type == path_type::catmull_rom && path_control_points.size() < 4) result = false;
 			return result;
 		}
+
+		// baked path (see bake_path()): positions and unit tangents at BAKED_PATH_SAMPLES + 1 points which are equally spaced in arc length
+		std::vector<glm::vec3> baked_positions, baked_tangents;
+		float baked_length = 0.0f;
+		uint64_t path_version = 0; // assigned by path_changed(), unique among all presets
+		uint64_t baked_version = 0;
+
+		// to be invoked whenever the control points or the type of the path have changed
+		void path_changed() {
+			static uint64_t sLastPathVersion = 0;
+			path_interpolation()->set_control_points(path_control_points);
+			path_version = ++sLastPathVersion;
+		}
+
+		// (re)builds the arc-length parameterized lookup table, if the path has changed since it has been baked last
+		void bake_path() {
+			if (baked_version == path_version) return;
+			baked_version = path_version;
+			baked_positions.clear();
+			baked_tangents.clear();
+			baked_length = 0.0f;
+			if (!is_path_valid()) return;
+
+			// cumulative arc lengths of a fine polyline through the curve, over the curve parameter:
+			auto curve = path_interpolation();
+			std::vector<float> arcLengths(ARC_LENGTH_SEGMENTS + 1, 0.0f);
+			glm::vec3 prev = curve->value_at(0.0f);
+			for (int i = 1; i <= ARC_LENGTH_SEGMENTS; ++i) {
+				glm::vec3 cur = curve->value_at(static_cast<float>(i) / ARC_LENGTH_SEGMENTS);
+				arcLengths[i] = arcLengths[i - 1] + glm::distance(prev, cur);
+				prev = cur;
+			}
+			baked_length = arcLengths.back();
+
+			// inverted: the curve parameters at equally spaced arc lengths, where the curve is evaluated once more
+			baked_positions.resize(BAKED_PATH_SAMPLES + 1);
+			baked_tangents.resize(BAKED_PATH_SAMPLES + 1);
+			int segment = 0;
+			for (int k = 0; k <= BAKED_PATH_SAMPLES; ++k) {
+				float s = baked_length * static_cast<float>(k) / BAKED_PATH_SAMPLES;
+				while (segment < ARC_LENGTH_SEGMENTS - 1 && arcLengths[segment + 1] < s) ++segment;
+				float segmentLength = arcLengths[segment + 1] - arcLengths[segment];
+				float f = segmentLength > 0.0f ? glm::clamp((s - arcLengths[segment]) / segmentLength, 0.0f, 1.0f) : 0.0f;
+				float t = (static_cast<float>(segment) + f) / ARC_LENGTH_SEGMENTS;
+				baked_positions[k] = curve->value_at(t);
+				baked_tangents[k] = curve->slope_at(t);
+			}
+			// where the curve's derivative vanishes (e.g., at repeated control points), its direction is taken from the neighbouring samples
+			for (int k = 0; k <= BAKED_PATH_SAMPLES; ++k) {
+				if (glm::length2(baked_tangents[k]) < 1e-12f) baked_tangents[k] = baked_positions[std::min(k + 1, BAKED_PATH_SAMPLES)] - baked_positions[std::max(k - 1, 0)];
+				if (glm::length2(baked_tangents[k]) > 0.0f) baked_tangents[k] = glm::normalize(baked_tangents[k]);
+			}
+		}
+
+		// position and tangent at the given fraction [0..1] of the baked path's arc length, the path must have been baked (and be valid)
+		void sample_baked_path(float aFraction, glm::vec3 &aPosition, glm::vec3 &aTangent) const {
+			float x = glm::clamp(aFraction, 0.0f, 1.0f) * BAKED_PATH_SAMPLES;
+			int i = std::min(static_cast<int>(x), BAKED_PATH_SAMPLES - 1);
+			float f = x - static_cast<float>(i);
+			aPosition = glm::mix(baked_positions[i], baked_positions[i + 1], f);
+			aTangent  = glm::mix(baked_tangents[i],  baked_tangents[i + 1],  f);
+		}
 	private:
 		avk::bezier_curve bezier_curve;
 		avk::quadratic_uniform_b_spline quadratic_uniform_b_spline;
@@ -558,7 +641,7 @@ private:
 							if (Combo("Type", &pathtype, "Bezier Curve\0Quadratic B-Spline\0Cubic B-Spline\0Catmull-Rom Spline\0")) {
 								p->path_interpolation()->set_control_points({}); // clear control points from old interpolator
 								p->m_path_type = static_cast<path_type>(pathtype);
-								p->path_interpolation()->set_control_points(p->path_control_points); // set control points in new interpolator
+								p->path_changed(); // set control points in new interpolator
 							}
 							InputFloat("Duration (sec)", &p->path_duration);
 							Checkbox("Cyclic", &p->path_cyclic);
@@ -639,7 +722,7 @@ private:
 							if (delPos >= 0)												{ points.erase (points.begin() + delPos);							changed = true; }
 							if (moveUp >  0)												{ std::swap(points[moveUp - 1], points[moveUp]);					changed = true; }
 							if (moveDn >= 0 && moveDn < static_cast<int>(points.size())-1)	{ std::swap(points[moveDn + 1], points[moveDn]);					changed = true; }
-							if (changed) p->path_interpolation()->set_control_points(points);
+							if (changed) p->path_changed();
 
 						}
 
@@ -763,6 +846,7 @@ private:
 			mVertexBufferVisPath1.push_back(avk::context().create_buffer(avk::memory_usage::device, {}, avk::vertex_buffer_meta::create_from_element_size(sizeof(glm::vec3), MAX_POINTS_TO_VISUALIZE)        .describe_only_member(glm::vec3(0), avk::content_description::position)));
 			mVertexBufferVisPath2.push_back(avk::context().create_buffer(avk::memory_usage::device, {}, avk::vertex_buffer_meta::create_from_element_size(sizeof(glm::vec3), MAX_CONTROL_POINTS_TO_VISUALIZE).describe_only_member(glm::vec3(0), avk::content_description::position)));
 		}
+		mVertexBuffersVisPathVersion.assign(mVertexBufferVisPath1.size(), 0);
 
 		mRenderingInited = true;
 	}
@@ -785,7 +869,7 @@ private:
 			orbitCam->set_translation(aPreset->translation);
 			orbitCam->set_rotation(aPreset->rotation);
 		} else if (aPreset->type == preset_type::circular || aPreset->type == preset_type::path) {
-			aPreset->motion_start_time = static_cast<float>(avk::context().get_time());
+			aPreset->motion_start_time = current_time();
 			aPreset->motion_active = true;
 		}
 	}
@@ -878,6 +962,10 @@ private:
 		}
 	}
 
+	float current_time() const {
+		return mTimeOverride.value_or(static_cast<float>(avk::context().get_time()));
+	}
+
 	glm::quat camera_rotation_from_direction(const glm::vec3 &aDirection) {
 		// code taken from transform::look_along()
 		if (glm::dot(aDirection, aDirection) < 1.2e-7 /* ~machine epsilon */) return glm::quat();
@@ -898,9 +986,12 @@ private:
 	avk::command_pool mCommandPool;
 	avk::graphics_pipeline mPipelineVisPath1, mPipelineVisPath2;
 	std::vector<avk::buffer> mVertexBufferVisPath1, mVertexBufferVisPath2;
+	// path_version of the path in each frame in flight's vertex buffers
+	std::vector<uint64_t> mVertexBuffersVisPathVersion;
 
 	bool mRenderingInited = false;
 	bool mGuiEnabled = true;
+	std::optional<float> mTimeOverride;
 
 	std::vector<preset_data> mPresets;
 
@@ -915,5 +1006,8 @@ private:
 	static const int MAX_NAME_LEN = 127;
 	static const int MAX_POINTS_TO_VISUALIZE = 5000;
 	static const int MAX_CONTROL_POINTS_TO_VISUALIZE = 500;
+	static const int BAKED_PATH_SAMPLES = 1024;
+	static const int ARC_LENGTH_SEGMENTS = 4096;
+	static_assert(BAKED_PATH_SAMPLES < MAX_POINTS_TO_VISUALIZE, "the baked path is visualized");
 };
 
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**	Measures CPU times of nested, named scopes on any thread, with the RAII timer cpu_profiler::scope.
+ *	The timers write their events into a fixed-size ring without any locks: Every event claims a slot with one atomic increment, and
+ *	publishes it with the slot's sequence number once it has been written. Once per frame, begin_frame() consumes the published events
+ *	on the main thread: The main thread's top-level scopes are stacked in the frame-time history, all scopes go into the per-scope
+ *	statistics and, optionally, into a Chrome trace file which is streamed while the application runs (load it in chrome://tracing
+ *	or https://ui.perfetto.dev). If more than sRingSize events are recorded between two frames, the oldest ones are lost.
+ */
+class cpu_profiler
+{
+public:
+	/** Number of events which the ring holds, must be a power of two */
+	static constexpr size_t sRingSize = 8192;
+	/** Number of frames in the frame-time history, and number of frames from which the scopes' statistics are computed */
+	static constexpr size_t sHistoryLength = 240;
+	/** Maximum number of distinct top-level scopes of the main thread which are stacked in the frame-time history */
+	static constexpr size_t sMaxStackedScopes = 12;
+
+	/** The instance which all scopes are measured with */
+	static cpu_profiler& get()
+	{
+		static cpu_profiler sInstance;
+		return sInstance;
+	}
+
+	/**	Measures the time from its construction until its destruction as one event of the scope with the given name, which must be a
+	 *	string literal (it is stored as pointer). Scopes which wait for something else (e.g., for the GPU) are marked with aIsWait,
+	 *	s.t. they tell CPU-bound frames from GPU-bound ones (see frame_record::mWaitMs).
+	 */
+	class scope
+	{
+	public:
+		explicit scope(const char* aName, bool aIsWait = false)
+			: mName{ aName }, mIsWait{ aIsWait }, mDepth{ sThreadDepth++ }, mBeginNs{ now_ns() }
+		{}
+
+		~scope()
+		{
+			--sThreadDepth;
+			get().record(mName, mIsWait, mDepth, mBeginNs, now_ns());
+		}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+
+	private:
+		const char* mName;
+		bool mIsWait;
+		uint32_t mDepth;
+		uint64_t mBeginNs;
+	};
+
+	/** The CPU times of one frame (from one begin_frame() to the next one), all in milliseconds */
+	struct frame_record
+	{
+		uint64_t mFrameNumber = 0;
+		float mFrameMs = 0.0f;
+		/** Durations of the main thread's top-level scopes, in the order of stacked_scope_names(). The rest of mFrameMs is spent outside of them. */
+		std::array<float, sMaxStackedScopes> mStackedMs{};
+		/** Duration of the main thread's waits among them */
+		float mWaitMs = 0.0f;
+		/** GPU time of the most recently resolved frame when this one has finished (see begin_frame) */
+		float mGpuMs = 0.0f;
+
+		/** Time which the main thread has spent in its top-level scopes, except for waits */
+		float busy_ms() const
+		{
+			float sum = 0.0f;
+			for (const auto ms : mStackedMs) {
+				sum += ms;
+			}
+			return sum - mWaitMs;
+		}
+
+		/** A frame is GPU-bound if the GPU has taken longer than the main thread's work, i.e., if the CPU has waited for it somewhere */
+		bool is_gpu_bound() const
+		{
+			return mGpuMs > busy_ms();
+		}
+	};
+
+	/** Statistics of one scope, over all of its events in a frame, in milliseconds */
+	struct scope_summary
+	{
+		float mLastMs = 0.0f;
+		float mAvgMs = 0.0f;
+		float mMaxMs = 0.0f;
+		uint32_t mLastCalls = 0;
+	};
+
+	/**	Marks the begin of a new frame, and consumes the events which have been published since the previous one. Must be invoked on the
+	 *	main thread once per frame, before any of its scopes, and it must not be invoked while any of the main thread's scopes are open.
+	 *	@param	aGpuMs		GPU time of the most recently resolved frame (e.g., from a gpu_profiler), which is recorded alongside the finished frame's CPU times
+	 */
+	void begin_frame(float aGpuMs = 0.0f)
+	{
+		const auto nowNs = now_ns();
+		mMainThread = thread_index();
+		consume();
+		if (0 != mFrameBeginNs) {
+			mCurrentFrame.mFrameMs = static_cast<float>(nowNs - mFrameBeginNs) * 1e-6f;
+			mCurrentFrame.mGpuMs = aGpuMs;
+			mHistory[mNextFrame] = mCurrentFrame;
+			mNextFrame = (mNextFrame + 1) % sHistoryLength;
+			mHistorySize = std::min(mHistorySize + 1, sHistoryLength);
+			for (auto& stats : mStatistics) {
+				stats.mHistory[stats.mNextSample] = stats.mFrameMs;
+				stats.mNextSample = (stats.mNextSample + 1) % sHistoryLength;
+				stats.mSampleCount = std::min(stats.mSampleCount + 1, static_cast<uint32_t>(sHistoryLength));
+				stats.mLastMs = stats.mFrameMs;
+				stats.mLastCalls = stats.mFrameCalls;
+				stats.mFrameMs = 0.0f;
+				stats.mFrameCalls = 0;
+			}
+			stream_frame(mCurrentFrame, mFrameBeginNs, nowNs);
+		}
+		mCurrentFrame = frame_record{ mFrameNumber++ };
+		mFrameBeginNs = nowNs;
+	}
+
+	/** Number of frames in the frame-time history */
+	size_t history_size() const
+	{
+		return mHistorySize;
+	}
+
+	/** The frame with the given index in the frame-time history, 0 being the oldest one */
+	const frame_record& history(size_t aIndex) const
+	{
+		return mHistory[(mNextFrame + sHistoryLength - mHistorySize + aIndex) % sHistoryLength];
+	}
+
+	/** The most recently finished frame, which must exist (see history_size) */
+	const frame_record& last_frame() const
+	{
+		return history(mHistorySize - 1);
+	}
+
+	/** Names of the main thread's top-level scopes which are stacked in frame_record::mStackedMs, in the order of their first appearance */
+	const std::vector<const char*>& stacked_scope_names() const
+	{
+		return mStackedNames;
+	}
+
+	/** Names of all scopes, in the order of their first appearance */
+	std::vector<const char*> scope_names() const
+	{
+		std::vector<const char*> names;
+		for (const auto& stats : mStatistics) {
+			names.push_back(stats.mName);
+		}
+		return names;
+	}
+
+	/** Nesting depth of the given scope when it has first been recorded, 0 for scopes which are not nested into another one of their thread */
+	uint32_t scope_depth(const char* aName) const
+	{
+		const auto it = mStatisticsIndices.find(aName);
+		return mStatisticsIndices.end() == it ? 0u : mStatistics[it->second].mDepth;
+	}
+
+	/** Compute the statistics of the given scope over the last (up to) sHistoryLength frames, all values are 0 if it has not been recorded yet */
+	scope_summary summary(const char* aName) const
+	{
+		scope_summary result;
+		const auto it = mStatisticsIndices.find(aName);
+		if (mStatisticsIndices.end() == it) {
+			return result;
+		}
+		const auto& stats = mStatistics[it->second];
+		result.mLastMs = stats.mLastMs;
+		result.mLastCalls = stats.mLastCalls;
+		for (uint32_t i = 0; i < stats.mSampleCount; ++i) {
+			result.mAvgMs += stats.mHistory[i];
+			result.mMaxMs = std::max(result.mMaxMs, stats.mHistory[i]);
+		}
+		result.mAvgMs /= static_cast<float>(std::max(stats.mSampleCount, 1u));
+		return result;
+	}
+
+	/** Number of events which have been lost so far, because they have been overwritten before they were consumed */
+	uint64_t lost_events() const
+	{
+		return mLostEvents;
+	}
+
+	/**	Start streaming all events (and one event per frame, with its CPU-bound/GPU-bound classification) into a Chrome trace file,
+	 *	which is written by begin_frame() as the events are consumed. A running stream is stopped first.
+	 *	@return	true if the file could be opened
+	 */
+	bool start_trace_stream(const std::string& aFilePath)
+	{
+		stop_trace_stream();
+		mTraceStream.open(aFilePath);
+		if (!mTraceStream) {
+			return false;
+		}
+		// Timestamps are microseconds since the application's start, i.e., large; print them with a fixed nanosecond resolution:
+		mTraceStream << std::fixed << std::setprecision(3);
+		mTraceStream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+			<< R"({"name":"thread_name","ph":"M","pid":1,"tid":0,"args":{"name":"frames"}})";
+		return true;
+	}
+
+	/** Finish the trace file, if a stream is running. */
+	void stop_trace_stream()
+	{
+		if (mTraceStream.is_open()) {
+			mTraceStream << "\n]}\n";
+			mTraceStream.close();
+		}
+	}
+
+	bool is_streaming() const
+	{
+		return mTraceStream.is_open();
+	}
+
+	~cpu_profiler()
+	{
+		stop_trace_stream();
+	}
+
+private:
+	cpu_profiler() = default;
+
+	/** One slot of the ring. Its fields are atomics, s.t. reading a slot which is being overwritten concurrently is not a data race
+	 *	(the reader detects it with the sequence number, and discards what it has read): */
+	struct slot
+	{
+		/** Index of the event + 1 once it has been published, 0 while it is being written */
+		std::atomic<uint64_t> mSequence{ 0 };
+		std::atomic<const char*> mName{ nullptr };
+		std::atomic<uint64_t> mBeginNs{ 0 };
+		std::atomic<uint64_t> mEndNs{ 0 };
+		/** Thread index (see thread_index) | depth << 32 | is-wait flag << 63 */
+		std::atomic<uint64_t> mInfo{ 0 };
+	};
+
+	struct event
+	{
+		const char* mName;
+		uint64_t mBeginNs;
+		uint64_t mEndNs;
+		uint32_t mThread;
+		uint32_t mDepth;
+		bool mIsWait;
+	};
+
+	struct scope_statistics
+	{
+		const char* mName;
+		uint32_t mDepth = 0;
+		float mFrameMs = 0.0f;
+		uint32_t mFrameCalls = 0;
+		float mLastMs = 0.0f;
+		uint32_t mLastCalls = 0;
+		std::array<float, sHistoryLength> mHistory{};
+		uint32_t mSampleCount = 0;
+		uint32_t mNextSample = 0;
+	};
+
+	static uint64_t now_ns()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	/** Small index of the calling thread, which is assigned when it records its first event (starting at 1; tid 0 is the trace's frames track) */
+	static uint32_t thread_index()
+	{
+		static std::atomic<uint32_t> sThreadCount{ 0 };
+		thread_local const uint32_t sIndex = ++sThreadCount;
+		return sIndex;
+	}
+
+	void record(const char* aName, bool aIsWait, uint32_t aDepth, uint64_t aBeginNs, uint64_t aEndNs)
+	{
+		const auto index = mWriteIndex.fetch_add(1, std::memory_order_relaxed);
+		auto& s = mRing[index & (sRingSize - 1)];
+		s.mSequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		s.mName.store(aName, std::memory_order_relaxed);
+		s.mBeginNs.store(aBeginNs, std::memory_order_relaxed);
+		s.mEndNs.store(aEndNs, std::memory_order_relaxed);
+		s.mInfo.store(thread_index() | (static_cast<uint64_t>(aDepth) << 32) | (aIsWait ? (uint64_t{ 1 } << 63) : 0), std::memory_order_relaxed);
+		s.mSequence.store(index + 1, std::memory_order_release);
+	}
+
+	/** Consume the published events, in the order in which they have claimed their slots */
+	void consume()
+	{
+		const auto end = mWriteIndex.load(std::memory_order_acquire);
+		if (end - mReadIndex > sRingSize) {
+			mLostEvents += end - sRingSize - mReadIndex;
+			mReadIndex = end - sRingSize;
+		}
+		for (; mReadIndex < end; ++mReadIndex) {
+			const auto& s = mRing[mReadIndex & (sRingSize - 1)];
+			const auto sequence = s.mSequence.load(std::memory_order_acquire);
+			if (sequence < mReadIndex + 1) {
+				break; // Still being written, consumed with the next frame
+			}
+			const auto info = s.mInfo.load(std::memory_order_relaxed);
+			const event e{
+				s.mName.load(std::memory_order_relaxed), s.mBeginNs.load(std::memory_order_relaxed), s.mEndNs.load(std::memory_order_relaxed),
+				static_cast<uint32_t>(info), static_cast<uint32_t>(info >> 32) & 0x7fffffffu, 0 != (info >> 63)
+			};
+			// The slot might have been claimed by a newer event while it was read:
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence != mReadIndex + 1 || s.mSequence.load(std::memory_order_relaxed) != sequence) {
+				++mLostEvents;
+				continue;
+			}
+			add(e);
+		}
+	}
+
+	void add(const event& aEvent)
+	{
+		const auto ms = static_cast<float>(aEvent.mEndNs - aEvent.mBeginNs) * 1e-6f;
+		auto [it, inserted] = mStatisticsIndices.try_emplace(aEvent.mName, mStatistics.size());
+		if (inserted) {
+			mStatistics.push_back(scope_statistics{ aEvent.mName, aEvent.mDepth });
+		}
+		auto& stats = mStatistics[it->second];
+		stats.mFrameMs += ms;
+		++stats.mFrameCalls;
+
+		if (aEvent.mThread == mMainThread && 0 == aEvent.mDepth) {
+			auto stacked = std::find_if(std::begin(mStackedNames), std::end(mStackedNames), [&](const char* aName) { return std::string_view{ aName } == aEvent.mName; });
+			if (std::end(mStackedNames) == stacked && mStackedNames.size() < sMaxStackedScopes) {
+				stacked = mStackedNames.insert(stacked, aEvent.mName);
+			}
+			if (std::end(mStackedNames) != stacked) {
+				mCurrentFrame.mStackedMs[std::distance(std::begin(mStackedNames), stacked)] += ms;
+				if (aEvent.mIsWait) {
+					mCurrentFrame.mWaitMs += ms;
+				}
+			}
+		}
+
+		if (mTraceStream.is_open()) {
+			mTraceStream << ",\n{\"name\":\"" << aEvent.mName << "\",\"cat\":\"" << (aEvent.mIsWait ? "wait" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << aEvent.mThread
+				<< ",\"ts\":" << trace_us(aEvent.mBeginNs) << ",\"dur\":" << static_cast<double>(aEvent.mEndNs - aEvent.mBeginNs) * 1e-3 << "}";
+		}
+	}
+
+	void stream_frame(const frame_record& aFrame, uint64_t aBeginNs, uint64_t aEndNs)
+	{
+		if (!mTraceStream.is_open()) {
+			return;
+		}
+		mTraceStream << ",\n{\"name\":\"" << (aFrame.is_gpu_bound() ? "GPU-bound frame" : "CPU-bound frame") << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0"
+			<< ",\"ts\":" << trace_us(aBeginNs) << ",\"dur\":" << static_cast<double>(aEndNs - aBeginNs) * 1e-3
+			<< ",\"args\":{\"frame\":" << aFrame.mFrameNumber << ",\"cpuBusyMs\":" << aFrame.busy_ms() << ",\"cpuWaitMs\":" << aFrame.mWaitMs << ",\"gpuMs\":" << aFrame.mGpuMs << "}}";
+	}
+
+	double trace_us(uint64_t aNs) const
+	{
+		return static_cast<double>(aNs - mOriginNs) * 1e-3;
+	}
+
+	std::array<slot, sRingSize> mRing;
+	std::atomic<uint64_t> mWriteIndex{ 0 };
+	/** Everything below is only accessed by the main thread: */
+	uint64_t mReadIndex = 0;
+	uint64_t mLostEvents = 0;
+	uint32_t mMainThread = 0;
+
+	const uint64_t mOriginNs = now_ns();
+	uint64_t mFrameBeginNs = 0;
+	uint64_t mFrameNumber = 0;
+	frame_record mCurrentFrame;
+	std::array<frame_record, sHistoryLength> mHistory;
+	size_t mNextFrame = 0;
+	size_t mHistorySize = 0;
+
+	std::vector<const char*> mStackedNames;
+	/** Statistics by scope name; names are compared by content, the same literal might have different addresses in different translation units: */
+	std::unordered_map<std::string_view, size_t> mStatisticsIndices;
+	std::vector<scope_statistics> mStatistics;
+
+	std::ofstream mTraceStream;
+
+	/** Nesting depth of the calling thread's open scopes */
+	static inline thread_local uint32_t sThreadDepth = 0;
+};
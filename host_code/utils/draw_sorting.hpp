@@ -0,0 +1,95 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+
+/** Builds 64-bit sort keys for draw calls and sorts draw calls by them with an LSD radix sort.
+ *	Layout of a key, from the most significant bits:
+ *	 - 4 bits pipeline (e.g., opaque before translucent)
+ *	 - 16 bits material and 8 bits depth bucket, in the order given by the order mode
+ *	 - 20 bits instance group and 2 bits level of detail, which make draws with equal keys drawable with one instanced draw
+ *	 - 14 bits unused (zero)
+ */
+class draw_sorting
+{
+public:
+	enum struct order
+	{
+		/** Instance group and level of detail only, i.e., the order in which the scene has been loaded */
+		scene,
+		/** By material, and front to back within every material */
+		material_then_depth,
+		/** Front to back, and by material within every depth bucket */
+		depth_then_material
+	};
+
+	static constexpr uint32_t sDepthBuckets = 256u;
+
+	/** Logarithmically distributed depth bucket of a view-space depth, s.t. near geometry is sorted more finely.
+	 *	Back to front (e.g., for translucent geometry) reverses the buckets' order.
+	 */
+	static uint32_t depth_bucket(float aViewSpaceDepth, float aNearPlane, float aFarPlane, bool aBackToFront = false)
+	{
+		const auto d = std::clamp(aViewSpaceDepth, aNearPlane, aFarPlane);
+		const auto t = std::log(d / aNearPlane) / std::log(aFarPlane / aNearPlane);
+		const auto bucket = std::min(static_cast<uint32_t>(t * static_cast<float>(sDepthBuckets)), sDepthBuckets - 1u);
+		return aBackToFront ? sDepthBuckets - 1u - bucket : bucket;
+	}
+
+	static uint64_t make_key(order aOrder, uint32_t aPipeline, uint32_t aMaterial, uint32_t aDepthBucket, uint32_t aInstanceGroup, uint32_t aLod)
+	{
+		const uint64_t material = aMaterial & 0xFFFFu;
+		const uint64_t depth = aDepthBucket & 0xFFu;
+		uint64_t middle = 0;
+		switch (aOrder) {
+		case order::material_then_depth: middle = (material << 8) | depth; break;
+		case order::depth_then_material: middle = (depth << 16) | material; break;
+		default: break;
+		}
+		return (static_cast<uint64_t>(aPipeline & 0xFu) << 60) | (middle << 36) | (static_cast<uint64_t>(aInstanceGroup & 0xFFFFFu) << 16) | (static_cast<uint64_t>(aLod & 0x3u) << 14);
+	}
+
+	static uint32_t lod_of_key(uint64_t aKey)
+	{
+		return static_cast<uint32_t>((aKey >> 14) & 0x3u);
+	}
+
+	/** Sort aValues by aKeys (both are reordered), stable. Passes over bytes which are the same in all keys are skipped.
+	 *	The scratch vectors are only there to avoid allocations, pass the same ones every frame.
+	 */
+	static void radix_sort(std::vector<uint64_t>& aKeys, std::vector<uint32_t>& aValues, std::vector<uint64_t>& aScratchKeys, std::vector<uint32_t>& aScratchValues)
+	{
+		const size_t n = aKeys.size();
+		if (n < 2) {
+			return;
+		}
+		aScratchKeys.resize(n);
+		aScratchValues.resize(n);
+
+		// Histograms of all eight digits at once:
+		std::array<std::array<size_t, 256>, 8> counts{};
+		for (auto key : aKeys) {
+			for (int d = 0; d < 8; ++d) {
+				++counts[d][(key >> (d * 8)) & 0xFFu];
+			}
+		}
+		for (int d = 0; d < 8; ++d) {
+			auto& c = counts[d];
+			if (c[(aKeys.front() >> (d * 8)) & 0xFFu] == n) {
+				continue; // All keys have the same digit
+			}
+			size_t sum = 0;
+			for (auto& count : c) {
+				const auto tmp = count;
+				count = sum;
+				sum += tmp;
+			}
+			for (size_t i = 0; i < n; ++i) {
+				const auto pos = c[(aKeys[i] >> (d * 8)) & 0xFFu]++;
+				aScratchKeys[pos] = aKeys[i];
+				aScratchValues[pos] = aValues[i];
+			}
+			std::swap(aKeys, aScratchKeys);
+			std::swap(aValues, aScratchValues);
+		}
+	}
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <algorithm>
+#include <cmath>
+
+/**	Controls the render scale, i.e., the fraction of the backbuffer's width and height which the scene is rendered at, s.t. the GPU
+ *	time of the frames approaches a target time. A frame's GPU time is assumed to scale with its number of pixels, i.e., with the
+ *	square of the render scale. Every measurement moves the scale part of the way towards the one which would meet the target,
+ *	unless the (smoothed) time is within a tolerance band around the target, s.t. the scale does not oscillate.
+ *	The GPU times arrive frames in flight later, hence, measurements of frames which have been begun before the scale has last been
+ *	changed are ignored. The scale is quantized, s.t. the extent (and everything which has been recorded for it) changes rarely.
+ */
+class dynamic_resolution
+{
+public:
+	struct settings
+	{
+		/** If disabled, the scene is rendered at mMaxScale */
+		bool mEnabled = true;
+		float mTargetFrameTimeMs = 1000.0f / 60.0f;
+		float mMinScale = 0.5f;
+		float mMaxScale = 1.0f;
+	};
+
+	/** No changes while the smoothed time is within +/- this fraction of the target */
+	static constexpr float sTolerance = 0.08f;
+	/** Fraction of the way towards the scale meeting the target which is taken per change */
+	static constexpr float sGain = 0.5f;
+	/** Weight of a new measurement in the smoothed time */
+	static constexpr float sSmoothing = 0.25f;
+	/** The scale is a multiple of this */
+	static constexpr float sScaleStep = 1.0f / 64.0f;
+	static constexpr float sLowestScale = 0.25f;
+
+	settings& get_settings() { return mSettings; }
+	const settings& get_settings() const { return mSettings; }
+
+	/** The current render scale, within [mMinScale, mMaxScale] */
+	float scale() const { return mScale; }
+
+	/** The smoothed GPU time of the frames which have been rendered at the current scale, 0 if there are none yet */
+	float smoothed_frame_time_ms() const { return mSmoothedMs; }
+
+	/**	Feed the GPU time of a completed frame into the controller. Measurements of the same frame are only taken into account once.
+	 *	@param	aFrameNumber		Number of the measured frame, e.g., gpu_profiler::last_resolved_frame_number()
+	 *	@param	aGpuTimeMs			GPU time of the measured frame
+	 *	@param	aNextFrameNumber	Number of the frame which is rendered next, i.e., the first one with a changed scale
+	 *	@return	true if the scale has changed
+	 */
+	bool update(uint64_t aFrameNumber, float aGpuTimeMs, uint64_t aNextFrameNumber)
+	{
+		const float previousScale = mScale;
+		mSettings.mMinScale = std::clamp(mSettings.mMinScale, sLowestScale, 1.0f);
+		mSettings.mMaxScale = std::clamp(mSettings.mMaxScale, mSettings.mMinScale, 1.0f);
+		if (!mSettings.mEnabled) {
+			mScale = mSettings.mMaxScale;
+		}
+		else if (aFrameNumber >= mFirstValidFrame && aFrameNumber != mLastMeasuredFrame && aGpuTimeMs > 0.0f) {
+			mLastMeasuredFrame = aFrameNumber;
+			mSmoothedMs = mSmoothedMs > 0.0f ? mSmoothedMs + sSmoothing * (aGpuTimeMs - mSmoothedMs) : aGpuTimeMs;
+			const float ratio = mSettings.mTargetFrameTimeMs / mSmoothedMs;
+			if (std::abs(ratio - 1.0f) > sTolerance) {
+				const float desiredScale = mScale * std::sqrt(ratio);
+				mScale = std::round((mScale + sGain * (desiredScale - mScale)) / sScaleStep) * sScaleStep;
+			}
+		}
+		mScale = std::clamp(mScale, mSettings.mMinScale, mSettings.mMaxScale);
+
+		if (mScale == previousScale) {
+			return false;
+		}
+		mFirstValidFrame = aNextFrameNumber;
+		mSmoothedMs = 0.0f;
+		return true;
+	}
+
+	/** Set the scale directly, e.g., when a benchmark run begins */
+	void reset(float aScale = 1.0f)
+	{
+		mScale = std::clamp(aScale, mSettings.mMinScale, mSettings.mMaxScale);
+		mSmoothedMs = 0.0f;
+	}
+
+	/** The extent to render at for the given full extent, at least 1x1 pixels */
+	vk::Extent2D extent_for(vk::Extent2D aFullExtent) const
+	{
+		return vk::Extent2D{
+			std::clamp(static_cast<uint32_t>(std::lround(static_cast<float>(aFullExtent.width) * mScale)), 1u, aFullExtent.width),
+			std::clamp(static_cast<uint32_t>(std::lround(static_cast<float>(aFullExtent.height) * mScale)), 1u, aFullExtent.height)
+		};
+	}
+
+private:
+	settings mSettings;
+	float mScale = 1.0f;
+	float mSmoothedMs = 0.0f;
+	uint64_t mFirstValidFrame = 0;
+	uint64_t mLastMeasuredFrame = ~uint64_t{ 0 };
+};
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <chrono>
+#include <functional>
+
+#include "invokee.hpp"
+#include "cpu_profiler.hpp"
+#include "thread_pool.hpp"
+
+/**	Records the command buffers of a frame on worker threads, and submits all of them with one single queue submission.
+ *
+ *	During their render() callbacks, invokees add passes (in the order in which they are to be executed on the GPU) and recording jobs
+ *	to them. A pass consists of commands which are recorded into the frame's primary command buffer before and after a renderpass, and of
+ *	any number of jobs which are recorded into secondary command buffers and executed within that renderpass. In its own render() callback,
+ *	which runs after the invokees that add passes, the frame_recorder runs all jobs of all passes in parallel, using one command pool per
+ *	worker thread and frame in flight. The primary command buffer executes the secondary ones in the order in which the jobs were added.
+ *
+ *	Jobs run after the render() callback which added them has returned, i.e., they must not refer to its local variables. They also run
+ *	concurrently to each other, i.e., they must not use anything that is not thread-safe, such as a descriptor cache (get the descriptor
+ *	sets beforehand). The before/after callbacks of the passes run on the main thread.
+ *
+ *	The frame's submission can additionally wait for and signal values of timeline semaphores, e.g., to synchronize with other queues.
+ */
+class frame_recorder : public avk::invokee
+{
+public:
+	/** Records commands into the given command buffer: the primary command buffer for before/after callbacks, a secondary one for jobs */
+	using recording_function = std::function<void(avk::command_buffer_t&)>;
+
+	frame_recorder(avk::queue& aQueue, uint32_t aNumWorkerThreads = 0, std::string aName = "frame_recorder", bool aIsEnabled = true)
+		: invokee(std::move(aName), aIsEnabled)
+		, mQueue{ &aQueue }
+		, mWorkers{ aNumWorkerThreads }
+	{}
+
+	// After all the invokees which add passes, but before the imgui_manager, which renders on top of everything else
+	int execution_order() const override { return 100000; }
+
+	void initialize() override
+	{
+		const auto numFramesInFlight = avk::context().main_window()->number_of_frames_in_flight();
+		for (avk::window::frame_id_t fif = 0; fif < numFramesInFlight; ++fif) {
+			mPrimaryCommandPools.push_back(avk::context().create_command_pool(mQueue->family_index(), vk::CommandPoolCreateFlagBits::eTransient));
+			auto& secondaryCommandPools = mSecondaryCommandPools.emplace_back();
+			for (size_t t = 0; t < mWorkers.size(); ++t) {
+				secondaryCommandPools.push_back(avk::context().create_command_pool(mQueue->family_index(), vk::CommandPoolCreateFlagBits::eTransient));
+			}
+		}
+		// Secondary command buffers which are kept (see add_job) outlive the frame, they are allocated from pools which are not transient:
+		for (size_t t = 0; t < mWorkers.size(); ++t) {
+			mKeptCommandPools.push_back(avk::context().create_command_pool(mQueue->family_index(), {}));
+		}
+	}
+
+	/**	Add a pass which renders into the given framebuffer with the given renderpass (both as accepted by avk::command::begin_render_pass_for_framebuffer)
+	 *	@param	aBefore		Optional commands to be recorded into the primary command buffer before the renderpass begins
+	 *	@param	aAfter		Optional commands to be recorded into the primary command buffer after the renderpass has ended
+	 *	@param	aRenderAreaExtent	Extent of the render area (at the framebuffer's origin), the whole framebuffer if not set
+	 *	@return	The index of the new pass, to add jobs to it
+	 */
+	template <typename R, typename F>
+	size_t add_pass(R aRenderpass, F aFramebuffer, recording_function aBefore = {}, recording_function aAfter = {}, std::optional<vk::Extent2D> aRenderAreaExtent = {})
+	{
+		auto& newPass = mPasses.emplace_back();
+		newPass.mInheritanceInfo = vk::CommandBufferInheritanceInfo{ aRenderpass->handle(), 0u, aFramebuffer->handle() };
+		newPass.mBegin = [aRenderpass, aFramebuffer, aRenderAreaExtent](avk::command_buffer_t& cb) {
+			// The renderpass's contents are provided by secondary command buffers exclusively:
+			cb.record(avk::command::begin_render_pass_for_framebuffer(aRenderpass, aFramebuffer, { 0, 0 }, aRenderAreaExtent, false));
+		};
+		newPass.mBefore = std::move(aBefore);
+		newPass.mAfter = std::move(aAfter);
+		return mPasses.size() - 1;
+	}
+
+	/**	Add a job to the pass with the given index, which records commands within its renderpass into a secondary command buffer.
+	 *	@param	aKeepIn		If given, the secondary command buffer is appended to it after recording (in the order of the jobs), s.t. it can be
+	 *						executed again in later frames with add_recorded_commands. It is recorded without a framebuffer, hence, it can be
+	 *						executed with any framebuffer which is compatible with the pass's. The vector must stay alive until render().
+	 */
+	void add_job(size_t aPassIndex, recording_function aJob, std::vector<avk::command_buffer>* aKeepIn = nullptr)
+	{
+		auto& pass = mPasses[aPassIndex];
+		pass.mSecondaries.push_back(secondary{ mJobs.size(), nullptr });
+		pass.mJobs.push_back(std::move(aJob));
+		mJobs.emplace_back(aPassIndex, pass.mJobs.size() - 1, aKeepIn);
+	}
+
+	/**	Add a secondary command buffer which has been recorded beforehand (with eRenderPassContinue, for a compatible renderpass) to the pass
+	 *	with the given index. It is executed in the order of the pass's jobs, and it must stay alive until the frame has completed.
+	 */
+	void add_recorded_commands(size_t aPassIndex, const avk::command_buffer_t& aSecondaryCommandBuffer)
+	{
+		mPasses[aPassIndex].mSecondaries.push_back(secondary{ secondary::sNoJob, aSecondaryCommandBuffer.handle() });
+	}
+
+	/** Let the frame's submission wait until the given timeline semaphore has reached the given value, before the given stages */
+	void wait_for_timeline_semaphore(vk::Semaphore aSemaphore, uint64_t aValue, vk::PipelineStageFlags aStages)
+	{
+		mTimelineWaits.push_back(timeline_wait{ aSemaphore, aValue, aStages });
+	}
+
+	/** Let the frame's submission signal the given value of the given timeline semaphore, when all of its commands have completed */
+	void signal_timeline_semaphore(vk::Semaphore aSemaphore, uint64_t aValue)
+	{
+		mTimelineSignals.emplace_back(aSemaphore, aValue);
+	}
+
+	/** Number of worker threads, i.e., the maximum number of jobs being recorded concurrently */
+	size_t number_of_worker_threads() const { return mWorkers.size(); }
+
+	/** Averaged CPU time which recording all the jobs takes (wall-clock time, from the start of the first job until all jobs are done) */
+	float recording_time_ms() const { return mRecordingTimeMs; }
+
+	void render() override
+	{
+		if (mPasses.empty() && mTimelineWaits.empty() && mTimelineSignals.empty()) {
+			return;
+		}
+		const cpu_profiler::scope profileRecording{ "Command recording" };
+		auto* mainWnd = avk::context().main_window();
+		const auto fif = mainWnd->in_flight_index_for_frame();
+
+		// Record all jobs in parallel. Every worker thread records the jobs j, j + numLanes, ... with its own command pool:
+		const auto recordingStart = std::chrono::high_resolution_clock::now();
+		std::vector<avk::command_buffer> secondaryCommandBuffers(mJobs.size());
+		const size_t numLanes = std::min(mWorkers.size(), mJobs.size());
+		mWorkers.parallel_for(numLanes, [&](size_t aLane) {
+			const cpu_profiler::scope profileLane{ "Recording jobs" };
+			auto& commandPool = mSecondaryCommandPools[fif][aLane];
+			for (size_t j = aLane; j < mJobs.size(); j += numLanes) {
+				const auto& [passIndex, jobIndex, keepIn] = mJobs[j];
+				const auto& pass = mPasses[passIndex];
+				if (nullptr != keepIn) {
+					// Executed again in later frames, possibly with other framebuffers:
+					const auto usage = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+					const auto inheritanceInfo = vk::CommandBufferInheritanceInfo{ pass.mInheritanceInfo }.setFramebuffer(nullptr);
+					auto cmdBfr = mKeptCommandPools[aLane]->alloc_command_buffer(usage, vk::CommandBufferLevel::eSecondary);
+					cmdBfr->handle().begin(vk::CommandBufferBeginInfo{ usage, &inheritanceInfo });
+					pass.mJobs[jobIndex](*cmdBfr);
+					cmdBfr->handle().end();
+					secondaryCommandBuffers[j] = std::move(cmdBfr);
+					continue;
+				}
+				auto cmdBfr = commandPool->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, vk::CommandBufferLevel::eSecondary);
+				cmdBfr->handle().begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &pass.mInheritanceInfo });
+				pass.mJobs[jobIndex](*cmdBfr);
+				cmdBfr->handle().end();
+				secondaryCommandBuffers[j] = std::move(cmdBfr);
+			}
+		});
+		const std::chrono::duration<float, std::milli> recordingTime = std::chrono::high_resolution_clock::now() - recordingStart;
+		mRecordingTimeMs = mRecordingTimeMs * 0.9f + recordingTime.count() * 0.1f;
+
+		// The primary command buffer executes the passes in order, and the secondary command buffers of each pass in the order of their jobs:
+		auto cmdBfr = mPrimaryCommandPools[fif]->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		cmdBfr->begin_recording();
+		std::vector<vk::CommandBuffer> secondaryHandles;
+		for (auto& pass : mPasses) {
+			if (pass.mBefore) {
+				pass.mBefore(*cmdBfr);
+			}
+			pass.mBegin(*cmdBfr);
+			secondaryHandles.clear();
+			for (const auto& s : pass.mSecondaries) {
+				secondaryHandles.push_back(secondary::sNoJob == s.mJob ? s.mRecorded : secondaryCommandBuffers[s.mJob]->handle());
+			}
+			if (!secondaryHandles.empty()) {
+				cmdBfr->handle().executeCommands(secondaryHandles);
+			}
+			cmdBfr->record(avk::command::end_render_pass());
+			if (pass.mAfter) {
+				pass.mAfter(*cmdBfr);
+			}
+		}
+		cmdBfr->end_recording();
+
+		const cpu_profiler::scope profileSubmit{ "Submit" };
+		// SUBMIT, and establish necessary sync. We assume that imgui_manager ALWAYS runs afterwards, which adds the present dependency for the current frame:
+		if (mTimelineWaits.empty() && mTimelineSignals.empty()) {
+			auto submission = mQueue->submit(cmdBfr.as_reference());
+			// Unless somebody else has consumed it already, wait for the swap chain image to become available:
+			if (!mainWnd->has_consumed_current_image_available_semaphore()) {
+				submission
+					.waiting_for(mainWnd->consume_current_image_available_semaphore() >> avk::stage::early_fragment_tests);
+			}
+			submission.submit();
+		}
+		else {
+			submit_with_timeline_semaphores(cmdBfr->handle());
+		}
+
+		// The command buffers are deleted after #concurrent-frames have passed by, before their pools are used again:
+		mainWnd->handle_lifetime(std::move(cmdBfr));
+		for (size_t j = 0; j < mJobs.size(); ++j) {
+			auto* keepIn = std::get<2>(mJobs[j]);
+			if (nullptr != keepIn) {
+				keepIn->push_back(std::move(secondaryCommandBuffers[j]));
+			}
+			else {
+				mainWnd->handle_lifetime(std::move(secondaryCommandBuffers[j]));
+			}
+		}
+		mPasses.clear();
+		mJobs.clear();
+	}
+
+private:
+	/** Submits the frame's primary command buffer with the timeline semaphore operations, and the wait for the swap chain image (if any) */
+	void submit_with_timeline_semaphores(const vk::CommandBuffer& aCommandBuffer)
+	{
+		auto* mainWnd = avk::context().main_window();
+		std::vector<vk::Semaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<vk::PipelineStageFlags> waitStages;
+		if (!mainWnd->has_consumed_current_image_available_semaphore()) {
+			waitSemaphores.push_back(mainWnd->consume_current_image_available_semaphore()->handle());
+			waitValues.push_back(0); // Binary semaphore, the value is ignored
+			waitStages.push_back(vk::PipelineStageFlagBits::eEarlyFragmentTests);
+		}
+		for (const auto& wait : mTimelineWaits) {
+			waitSemaphores.push_back(wait.mSemaphore);
+			waitValues.push_back(wait.mValue);
+			waitStages.push_back(wait.mStages);
+		}
+		std::vector<vk::Semaphore> signalSemaphores;
+		std::vector<uint64_t> signalValues;
+		for (const auto& [semaphore, value] : mTimelineSignals) {
+			signalSemaphores.push_back(semaphore);
+			signalValues.push_back(value);
+		}
+
+		vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+		timelineSubmitInfo.setWaitSemaphoreValues(waitValues).setSignalSemaphoreValues(signalValues);
+		mQueue->handle().submit(
+			vk::SubmitInfo{}
+				.setWaitSemaphores(waitSemaphores)
+				.setWaitDstStageMask(waitStages)
+				.setCommandBuffers(aCommandBuffer)
+				.setSignalSemaphores(signalSemaphores)
+				.setPNext(&timelineSubmitInfo)
+		);
+		mTimelineWaits.clear();
+		mTimelineSignals.clear();
+	}
+
+	struct timeline_wait
+	{
+		vk::Semaphore mSemaphore;
+		uint64_t mValue;
+		vk::PipelineStageFlags mStages;
+	};
+
+	/** A secondary command buffer to be executed within a pass: the one of a job (by the job's index in mJobs), or one recorded beforehand */
+	struct secondary
+	{
+		static constexpr size_t sNoJob = std::numeric_limits<size_t>::max();
+		size_t mJob;
+		vk::CommandBuffer mRecorded;
+	};
+
+	struct pass
+	{
+		vk::CommandBufferInheritanceInfo mInheritanceInfo;
+		recording_function mBegin;
+		recording_function mBefore;
+		recording_function mAfter;
+		std::vector<recording_function> mJobs;
+		/** The secondary command buffers of the jobs and the ones recorded beforehand, in the order in which they have been added: */
+		std::vector<secondary> mSecondaries;
+	};
+
+	avk::queue* mQueue;
+	thread_pool mWorkers;
+	/** One pool per frame in flight for the primary command buffers, and one per frame in flight and worker thread for the secondary ones,
+	 *	plus one per worker thread for the secondary command buffers which are kept: */
+	std::vector<avk::command_pool> mPrimaryCommandPools;
+	std::vector<std::vector<avk::command_pool>> mSecondaryCommandPools;
+	std::vector<avk::command_pool> mKeptCommandPools;
+
+	/** The passes of the current frame, and (pass index, job index, where to keep its command buffer) of all their jobs in the order in which they have been added: */
+	std::vector<pass> mPasses;
+	std::vector<std::tuple<size_t, size_t, std::vector<avk::command_buffer>*>> mJobs;
+	/** The timeline semaphore operations of the current frame's submission: */
+	std::vector<timeline_wait> mTimelineWaits;
+	std::vector<std::tuple<vk::Semaphore, uint64_t>> mTimelineSignals;
+
+	float mRecordingTimeMs = 0.0f;
+};
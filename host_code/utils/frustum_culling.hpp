@@ -0,0 +1,147 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+
+// SSE is available on all x64 targets, and on x86 targets if enabled through the compiler flags:
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLING_USE_SSE 1
+#include <xmmintrin.h>
+#else
+#define FRUSTUM_CULLING_USE_SSE 0
+#endif
+
+/** Tests axis-aligned bounding boxes against a view frustum on the CPU.
+ *	The boxes are stored as structure of arrays (centers and half extents per axis),
+ *	s.t. four of them can be tested at once if SSE is available. Otherwise, a scalar
+ *	implementation is used, which yields identical results.
+ */
+class frustum_culling
+{
+public:
+	using planes_t = std::array<glm::vec4, 6>;
+
+	/** Extract the six frustum planes (xyz = normal pointing inwards, w = distance) from a projection * view matrix.
+	 *	The near plane is extracted for a clip space depth range of [-w, w], which is conservative for [0, w], too.
+	 */
+	static planes_t extract_frustum_planes(const glm::mat4& aViewProjMatrix)
+	{
+		const auto row = [&aViewProjMatrix](int i) {
+			return glm::vec4{ aViewProjMatrix[0][i], aViewProjMatrix[1][i], aViewProjMatrix[2][i], aViewProjMatrix[3][i] };
+		};
+		planes_t planes = {
+			row(3) + row(0), // left
+			row(3) - row(0), // right
+			row(3) + row(1), // bottom (or top, if y is flipped)
+			row(3) - row(1), // top (or bottom, if y is flipped)
+			row(3) + row(2), // near
+			row(3) - row(2)  // far
+		};
+		for (auto& p : planes) {
+			p /= glm::length(glm::vec3{ p });
+		}
+		return planes;
+	}
+
+	/** Remove all bounding boxes */
+	void clear()
+	{
+		mCount = 0;
+		for (auto* v : { &mCenterX, &mCenterY, &mCenterZ, &mHalfExtentX, &mHalfExtentY, &mHalfExtentZ }) {
+			v->clear();
+		}
+	}
+
+	/** Add a bounding box, it can later be identified by its index, i.e., by the order of add_bounding_box calls */
+	void add_bounding_box(const glm::vec3& aMin, const glm::vec3& aMax)
+	{
+		const auto c = (aMin + aMax) * 0.5f;
+		const auto e = (aMax - aMin) * 0.5f;
+		mCenterX.push_back(c.x); mCenterY.push_back(c.y); mCenterZ.push_back(c.z);
+		mHalfExtentX.push_back(e.x); mHalfExtentY.push_back(e.y); mHalfExtentZ.push_back(e.z);
+		++mCount;
+	}
+
+	size_t size() const { return mCount; }
+
+	/** Test all bounding boxes against the given frustum planes, and write the (ascending) indices of
+	 *	those which are at least partially inside into aVisibleIndices.
+	 */
+	void cull(const planes_t& aPlanes, std::vector<uint32_t>& aVisibleIndices) const
+	{
+#if FRUSTUM_CULLING_USE_SSE
+		cull_sse(aPlanes, aVisibleIndices);
+#else
+		cull_scalar(aPlanes, aVisibleIndices);
+#endif
+	}
+
+	/** Scalar implementation of cull */
+	void cull_scalar(const planes_t& aPlanes, std::vector<uint32_t>& aVisibleIndices) const
+	{
+		aVisibleIndices.clear();
+		for (size_t i = 0; i < mCount; ++i) {
+			if (is_visible(i, aPlanes)) {
+				aVisibleIndices.push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+
+#if FRUSTUM_CULLING_USE_SSE
+	/** SSE implementation of cull, which tests four bounding boxes at once */
+	void cull_sse(const planes_t& aPlanes, std::vector<uint32_t>& aVisibleIndices) const
+	{
+		aVisibleIndices.clear();
+
+		// Broadcast the planes' components (and their absolute values) once:
+		__m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+		for (int j = 0; j < 6; ++j) {
+			nx[j] = _mm_set1_ps(aPlanes[j].x);           ny[j] = _mm_set1_ps(aPlanes[j].y);           nz[j] = _mm_set1_ps(aPlanes[j].z); nw[j] = _mm_set1_ps(aPlanes[j].w);
+			ax[j] = _mm_set1_ps(std::abs(aPlanes[j].x)); ay[j] = _mm_set1_ps(std::abs(aPlanes[j].y)); az[j] = _mm_set1_ps(std::abs(aPlanes[j].z));
+		}
+
+		const auto zero = _mm_setzero_ps();
+		size_t i = 0;
+		for (; i + 4 <= mCount; i += 4) {
+			const __m128 cx = _mm_loadu_ps(&mCenterX[i]),     cy = _mm_loadu_ps(&mCenterY[i]),     cz = _mm_loadu_ps(&mCenterZ[i]);
+			const __m128 ex = _mm_loadu_ps(&mHalfExtentX[i]), ey = _mm_loadu_ps(&mHalfExtentY[i]), ez = _mm_loadu_ps(&mHalfExtentZ[i]);
+			__m128 minDist = _mm_set1_ps(std::numeric_limits<float>::max());
+			for (int j = 0; j < 6; ++j) {
+				const __m128 dc = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[j], cx), _mm_mul_ps(ny[j], cy)), _mm_add_ps(_mm_mul_ps(nz[j], cz), nw[j]));
+				const __m128 de = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[j], ex), _mm_mul_ps(ay[j], ey)), _mm_mul_ps(az[j], ez));
+				minDist = _mm_min_ps(minDist, _mm_add_ps(dc, de));
+			}
+			const int mask = _mm_movemask_ps(_mm_cmpge_ps(minDist, zero));
+			for (int k = 0; k < 4; ++k) {
+				if (mask & (1 << k)) {
+					aVisibleIndices.push_back(static_cast<uint32_t>(i + k));
+				}
+			}
+		}
+
+		// Test the remaining (fewer than four) boxes one by one:
+		for (; i < mCount; ++i) {
+			if (is_visible(i, aPlanes)) {
+				aVisibleIndices.push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+#endif
+
+private:
+	bool is_visible(size_t i, const planes_t& aPlanes) const
+	{
+		for (const auto& p : aPlanes) {
+			// Signed distance of the box corner which lies farthest in the direction of the plane's normal:
+			const float d = p.x * mCenterX[i] + p.y * mCenterY[i] + p.z * mCenterZ[i] + p.w
+			              + std::abs(p.x) * mHalfExtentX[i] + std::abs(p.y) * mHalfExtentY[i] + std::abs(p.z) * mHalfExtentZ[i];
+			if (d < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t mCount = 0;
+	std::vector<float> mCenterX, mCenterY, mCenterZ;
+	std::vector<float> mHalfExtentX, mHalfExtentY, mHalfExtentZ;
+};
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <filesystem>
+#include <fstream>
+#include <span>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** A binary cache file of a scene's geometry, which is memory-mapped for reading, s.t. its data can be copied
+ *	straight into (staging) buffers, without having to deserialize anything into intermediate containers.
+ *
+ *	Layout of the file:
+ *	 - file_header
+ *	 - file_header::mGroupCount    x material_group_entry
+ *	 - file_header::mInstanceCount x instance_entry
+ *	 - Page-aligned blobs: the indices of all material groups, followed by one blob per vertex stream.
+ *	   The material groups' indices are relative to their mVertexOffset, like with geometry_layout::merged_buffers.
+ *	   Therefore, they are stored as 16-bit indices if no material group has more than 65536 vertices (see file_header::mIndexSize).
+ *	   Every material group's index range contains the indices of all of its levels of detail, one after the other.
+ */
+class geometry_cache
+{
+public:
+	/** "A1GC", identifies geometry cache files */
+	static constexpr uint32_t sMagic = 0x43473141u;
+	/** Increment whenever the layout of the file changes */
+	static constexpr uint32_t sVersion = 3u;
+	/** Blobs start at multiples of the (most common) page size */
+	static constexpr uint64_t sBlobAlignment = 4096u;
+	static constexpr uint32_t sMaxVertexStreams = 5u;
+	/** Maximum number of levels of detail per material group, including the full detail level */
+	static constexpr uint32_t sMaxLodLevels = 4u;
+
+	struct file_header
+	{
+		uint32_t mMagic;
+		uint32_t mVersion;
+		uint32_t mVertexFormat;   // A helpers::vertex_format value
+		uint32_t mVertexStreamCount;
+		uint32_t mGroupCount;
+		uint32_t mInstanceCount;
+		uint64_t mIndexCount;     // Of all material groups
+		uint64_t mVertexCount;    // Of all material groups
+		uint64_t mIndexBlobOffset;
+		uint64_t mVertexStreamBlobOffsets[sMaxVertexStreams];
+		uint32_t mVertexStreamStrides[sMaxVertexStreams];
+		uint32_t mIndexSize;      // 2 or 4 bytes per index
+	};
+
+	/** Range of indices of one level of detail */
+	struct lod_range
+	{
+		uint32_t mFirstIndex;
+		uint32_t mIndexCount;
+	};
+
+	struct material_group_entry
+	{
+		uint32_t mFirstIndex;
+		uint32_t mIndexCount;     // Of all levels of detail
+		int32_t  mVertexOffset;
+		uint32_t mVertexCount;
+		int32_t  mMaterialIndex;
+		uint32_t mLoadeeIndex;    // Index of the model/ORCA scene the material group has been loaded from
+		uint32_t mFirstInstance;  // Range of instance_entry elements
+		uint32_t mInstanceCount;
+		glm::vec4 mPositionOffset;
+		glm::vec4 mPositionScale;
+		glm::vec4 mTexCoordsOffsetScale;
+		glm::vec4 mBoundsMin;     // Object space, w unused
+		glm::vec4 mBoundsMax;     // Object space, w unused
+		uint32_t mLodCount;       // Number of valid elements in mLods, level 0 is the full detail level
+		lod_range mLods[sMaxLodLevels]; // Relative to mFirstIndex
+	};
+
+	struct instance_entry
+	{
+		glm::mat4 mModelMatrix;   // Without the loadee's transformation, s.t. it can be changed without invalidating the cache
+	};
+
+	static_assert(std::is_trivially_copyable_v<file_header> && std::is_trivially_copyable_v<material_group_entry> && std::is_trivially_copyable_v<instance_entry>);
+
+	geometry_cache() = default;
+	geometry_cache(const geometry_cache&) = delete;
+	geometry_cache& operator=(const geometry_cache&) = delete;
+	~geometry_cache()
+	{
+		close();
+	}
+
+	/** Write a cache file. The indices are written as 16-bit indices if all material groups' vertices can be addressed with them.
+	 *	@param	aHeader				Only the vertex format is used, all other members are determined from the other parameters
+	 *	@param	aIndices			The indices of all material groups
+	 *	@param	aVertexStreams		One blob per vertex stream, and the stride of its elements
+	 *	@return	true if the file could be written
+	 */
+	static bool write(const std::string& aFilePath, file_header aHeader,
+		const std::vector<material_group_entry>& aGroups, const std::vector<instance_entry>& aInstances,
+		std::span<const uint32_t> aIndices, const std::vector<std::tuple<std::span<const std::byte>, uint32_t>>& aVertexStreams)
+	{
+		assert(aVertexStreams.size() <= sMaxVertexStreams);
+		const auto align = [](uint64_t aOffset) { return (aOffset + sBlobAlignment - 1) / sBlobAlignment * sBlobAlignment; };
+
+		aHeader.mMagic = sMagic;
+		aHeader.mVersion = sVersion;
+		aHeader.mVertexStreamCount = static_cast<uint32_t>(aVertexStreams.size());
+		aHeader.mGroupCount = static_cast<uint32_t>(aGroups.size());
+		aHeader.mInstanceCount = static_cast<uint32_t>(aInstances.size());
+		aHeader.mIndexCount = aIndices.size();
+		const bool use16BitIndices = std::all_of(std::begin(aGroups), std::end(aGroups), [](const material_group_entry& g) { return g.mVertexCount <= 65536u; });
+		aHeader.mIndexSize = use16BitIndices ? 2u : 4u;
+		std::vector<uint16_t> indices16;
+		if (use16BitIndices) {
+			indices16.assign(std::begin(aIndices), std::end(aIndices));
+		}
+		const auto indexBlob = use16BitIndices ? std::as_bytes(std::span<const uint16_t>{ indices16 }) : std::as_bytes(aIndices);
+		aHeader.mVertexCount = aVertexStreams.empty() ? 0 : std::get<std::span<const std::byte>>(aVertexStreams.front()).size() / std::get<uint32_t>(aVertexStreams.front());
+		aHeader.mIndexBlobOffset = align(sizeof(file_header) + aGroups.size() * sizeof(material_group_entry) + aInstances.size() * sizeof(instance_entry));
+		uint64_t offset = align(aHeader.mIndexBlobOffset + indexBlob.size());
+		for (size_t i = 0; i < aVertexStreams.size(); ++i) {
+			aHeader.mVertexStreamBlobOffsets[i] = offset;
+			aHeader.mVertexStreamStrides[i] = std::get<uint32_t>(aVertexStreams[i]);
+			offset = align(offset + std::get<std::span<const std::byte>>(aVertexStreams[i]).size());
+		}
+
+		// Write to a temporary file first, s.t. an incomplete file is never mistaken for a valid cache:
+		const auto tmpFilePath = aFilePath + ".tmp";
+		{
+			std::ofstream file(tmpFilePath, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				return false;
+			}
+			const auto padTo = [&file](uint64_t aOffset) {
+				static const std::array<char, sBlobAlignment> sZeros{};
+				const auto pos = static_cast<uint64_t>(file.tellp());
+				file.write(sZeros.data(), static_cast<std::streamsize>(aOffset - pos));
+			};
+			file.write(reinterpret_cast<const char*>(&aHeader), sizeof(aHeader));
+			file.write(reinterpret_cast<const char*>(aGroups.data()), static_cast<std::streamsize>(aGroups.size() * sizeof(material_group_entry)));
+			file.write(reinterpret_cast<const char*>(aInstances.data()), static_cast<std::streamsize>(aInstances.size() * sizeof(instance_entry)));
+			padTo(aHeader.mIndexBlobOffset);
+			file.write(reinterpret_cast<const char*>(indexBlob.data()), static_cast<std::streamsize>(indexBlob.size()));
+			for (size_t i = 0; i < aVertexStreams.size(); ++i) {
+				padTo(aHeader.mVertexStreamBlobOffsets[i]);
+				const auto& blob = std::get<std::span<const std::byte>>(aVertexStreams[i]);
+				file.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+			}
+			if (!file) {
+				return false;
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(tmpFilePath, aFilePath, ec);
+		return !ec;
+	}
+
+	/** Memory-map a cache file for reading.
+	 *	@param	aExpectedVertexFormat	The file is rejected if it has been written for a different vertex format
+	 *	@return	true if the file exists, could be mapped, and is a valid cache file of the current version
+	 */
+	bool open(const std::string& aFilePath, uint32_t aExpectedVertexFormat)
+	{
+		close();
+#ifdef _WIN32
+		mFile = CreateFileA(aFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (INVALID_HANDLE_VALUE == mFile) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(mFile, &size);
+		mSize = static_cast<size_t>(size.QuadPart);
+		mMapping = mSize > 0 ? CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		mData = nullptr != mMapping ? static_cast<const std::byte*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+		mFile = ::open(aFilePath.c_str(), O_RDONLY);
+		if (mFile < 0) {
+			return false;
+		}
+		struct stat st;
+		mSize = 0 == fstat(mFile, &st) ? static_cast<size_t>(st.st_size) : 0;
+		if (mSize > 0) {
+			void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+			mData = MAP_FAILED != data ? static_cast<const std::byte*>(data) : nullptr;
+			if (nullptr != mData) {
+				madvise(data, mSize, MADV_SEQUENTIAL); // The blobs are read front to back
+			}
+		}
+#endif
+		if (nullptr == mData || mSize < sizeof(file_header)) {
+			close();
+			return false;
+		}
+
+		// A truncated or corrupt file must be rejected (and rebuilt) rather than lead to reads beyond the mapping:
+		const auto& h = header();
+		bool valid = sMagic == h.mMagic && sVersion == h.mVersion && aExpectedVertexFormat == h.mVertexFormat && h.mVertexStreamCount <= sMaxVertexStreams
+			&& fits_into_file(sizeof(file_header), h.mGroupCount, sizeof(material_group_entry))
+			&& fits_into_file(sizeof(file_header) + uint64_t{ h.mGroupCount } * sizeof(material_group_entry), h.mInstanceCount, sizeof(instance_entry))
+			&& (2u == h.mIndexSize || 4u == h.mIndexSize) && fits_into_file(h.mIndexBlobOffset, h.mIndexCount, h.mIndexSize);
+		for (uint32_t i = 0; valid && i < h.mVertexStreamCount; ++i) {
+			valid = h.mVertexStreamStrides[i] > 0 && fits_into_file(h.mVertexStreamBlobOffsets[i], h.mVertexCount, h.mVertexStreamStrides[i]);
+		}
+		for (uint32_t i = 0; valid && i < h.mGroupCount; ++i) {
+			const auto& g = groups()[i];
+			valid = uint64_t{ g.mFirstIndex } + g.mIndexCount <= h.mIndexCount
+				&& g.mVertexOffset >= 0 && static_cast<uint64_t>(g.mVertexOffset) + g.mVertexCount <= h.mVertexCount
+				&& uint64_t{ g.mFirstInstance } + g.mInstanceCount <= h.mInstanceCount
+				&& g.mLodCount <= sMaxLodLevels;
+			for (uint32_t l = 0; valid && (0 == l || l < g.mLodCount); ++l) { // Level 0 is used even if mLodCount is 0
+				valid = uint64_t{ g.mLods[l].mFirstIndex } + g.mLods[l].mIndexCount <= g.mIndexCount;
+			}
+		}
+		if (!valid) {
+			close();
+		}
+		return valid;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (nullptr != mData) { UnmapViewOfFile(mData); }
+		if (nullptr != mMapping) { CloseHandle(mMapping); }
+		if (INVALID_HANDLE_VALUE != mFile) { CloseHandle(mFile); }
+		mMapping = nullptr;
+		mFile = INVALID_HANDLE_VALUE;
+#else
+		if (nullptr != mData) { munmap(const_cast<std::byte*>(mData), mSize); }
+		if (mFile >= 0) { ::close(mFile); }
+		mFile = -1;
+#endif
+		mData = nullptr;
+		mSize = 0;
+	}
+
+	const file_header& header() const
+	{
+		return *reinterpret_cast<const file_header*>(mData);
+	}
+
+	std::span<const material_group_entry> groups() const
+	{
+		return { reinterpret_cast<const material_group_entry*>(mData + sizeof(file_header)), header().mGroupCount };
+	}
+
+	std::span<const instance_entry> instances() const
+	{
+		return { reinterpret_cast<const instance_entry*>(mData + sizeof(file_header) + header().mGroupCount * sizeof(material_group_entry)), header().mInstanceCount };
+	}
+
+	/** Pointer to the given index within the mapped index blob, whose elements are header().mIndexSize bytes large */
+	const std::byte* indices(uint64_t aFirstIndex = 0) const
+	{
+		return mData + header().mIndexBlobOffset + aFirstIndex * header().mIndexSize;
+	}
+
+	/** Pointer to the given vertex within the mapped blob of the given vertex stream */
+	const std::byte* vertices(uint32_t aStream, uint64_t aFirstVertex = 0) const
+	{
+		return mData + header().mVertexStreamBlobOffsets[aStream] + aFirstVertex * header().mVertexStreamStrides[aStream];
+	}
+
+private:
+	/** Whether aCount elements of aElementSize bytes each, starting at aOffset, lie within the mapped file, without overflowing */
+	bool fits_into_file(uint64_t aOffset, uint64_t aCount, uint64_t aElementSize) const
+	{
+		return aOffset <= mSize && aCount <= (mSize - aOffset) / aElementSize;
+	}
+
+#ifdef _WIN32
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+#else
+	int mFile = -1;
+#endif
+	const std::byte* mData = nullptr;
+	size_t mSize = 0;
+};
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+/** Measures GPU times of nested, named scopes with timestamp queries, without ever stalling the CPU.
+ *	There is one query pool per frame in flight: When a frame begins, the results of the frame which used the same
+ *	frame-in-flight index before are read back (it has finished on the GPU by then), and its queries are reset.
+ *	The times of each scope are kept in a history, from which min/avg/p99 are computed, and the recent scopes
+ *	can be exported as a Chrome trace (load it in chrome://tracing or https://ui.perfetto.dev).
+ *	It is meant to be used from the thread recording the frame's commands only, i.e., it does not need any locks.
+ */
+class gpu_profiler
+{
+public:
+	/** Maximum number of scopes per frame (every scope needs two timestamp queries) */
+	static constexpr uint32_t sMaxScopesPerFrame = 64;
+	/** Number of samples per scope from which the statistics are computed */
+	static constexpr size_t sHistoryLength = 256;
+	/** Number of resolved scopes which are kept for the Chrome trace export */
+	static constexpr size_t sMaxTraceEvents = 16384;
+
+	/** Statistics of one scope over the last (up to) sHistoryLength frames it has been recorded in, all in milliseconds */
+	struct scope_summary
+	{
+		float mLastMs = 0.0f;
+		float mMinMs = 0.0f;
+		float mAvgMs = 0.0f;
+		float mP99Ms = 0.0f;
+	};
+
+	/** Create the query pools, must be invoked before any other method.
+	 *	@param	aQueue				The queue the frames are submitted to, determines the number of valid timestamp bits
+	 *	@param	aFramesInFlight		Number of frames which can be in flight concurrently, i.e., number of query pools
+	 */
+	void init(const avk::queue& aQueue, uint32_t aFramesInFlight)
+	{
+		const auto& physicalDevice = avk::context().physical_device();
+		// Query the properties only once; they are needed in every frame:
+		mTimestampPeriodNs = physicalDevice.getProperties().limits.timestampPeriod;
+		const auto validBits = physicalDevice.getQueueFamilyProperties()[aQueue.family_index()].timestampValidBits;
+		mTimestampMask = validBits >= 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << validBits) - 1;
+
+		vk::QueryPoolCreateInfo queryPoolCreateInfo;
+		queryPoolCreateInfo.setQueryCount(2 * sMaxScopesPerFrame);
+		queryPoolCreateInfo.setQueryType(vk::QueryType::eTimestamp);
+		mFrames.resize(aFramesInFlight);
+		for (auto& frame : mFrames) {
+			frame.mQueryPool = avk::context().device().createQueryPoolUnique(queryPoolCreateInfo);
+		}
+		mResults.resize(2 * 2 * sMaxScopesPerFrame); // (timestamp, availability) per query
+	}
+
+	/** Resolve the results of the frame which used the same frame-in-flight index before, and reset its queries.
+	 *	Must be recorded outside of a renderpass, before any scopes of the current frame.
+	 *	@param	aCommandBuffer		Command buffer of the current frame
+	 *	@param	aInFlightIndex		Frame-in-flight index of the current frame, e.g., window::in_flight_index_for_frame()
+	 */
+	void begin_frame(const vk::CommandBuffer& aCommandBuffer, avk::window::frame_id_t aInFlightIndex)
+	{
+		mCurrentFrame = &mFrames[static_cast<size_t>(aInFlightIndex) % mFrames.size()];
+		resolve(*mCurrentFrame);
+
+		aCommandBuffer.resetQueryPool(*mCurrentFrame->mQueryPool, 0u, 2 * sMaxScopesPerFrame);
+		mCurrentFrame->mScopes.clear();
+		mCurrentFrame->mQueryCount = 0;
+		mCurrentFrame->mFrameNumber = mFrameNumber++;
+		mOpenScopes.clear();
+	}
+
+	/** Begin a scope, which is nested into the currently open scope (if any). Scopes are identified by their full path of names.
+	 *	@param	aStage		Pipeline stage after which the begin timestamp is written
+	 */
+	void begin_scope(const vk::CommandBuffer& aCommandBuffer, const std::string& aName, vk::PipelineStageFlagBits aStage = vk::PipelineStageFlagBits::eTopOfPipe)
+	{
+		assert(nullptr != mCurrentFrame);
+		scope_record scope;
+		scope.mPath = mOpenScopes.empty() ? aName : mCurrentFrame->mScopes[mOpenScopes.back()].mPath + "/" + aName;
+		scope.mDepth = static_cast<uint32_t>(mOpenScopes.size());
+		if (mCurrentFrame->mQueryCount + 2 <= 2 * sMaxScopesPerFrame) {
+			// Reserve the end query right away, s.t. every scope that has been begun can be ended:
+			scope.mBeginQuery = mCurrentFrame->mQueryCount;
+			mCurrentFrame->mQueryCount += 2;
+			aCommandBuffer.writeTimestamp(aStage, *mCurrentFrame->mQueryPool, scope.mBeginQuery);
+		}
+		mOpenScopes.push_back(mCurrentFrame->mScopes.size());
+		mCurrentFrame->mScopes.push_back(std::move(scope));
+	}
+
+	/** End the innermost open scope.
+	 *	@param	aStage		Pipeline stage after which the end timestamp is written
+	 */
+	void end_scope(const vk::CommandBuffer& aCommandBuffer, vk::PipelineStageFlagBits aStage = vk::PipelineStageFlagBits::eBottomOfPipe)
+	{
+		assert(nullptr != mCurrentFrame && !mOpenScopes.empty());
+		const auto& scope = mCurrentFrame->mScopes[mOpenScopes.back()];
+		mOpenScopes.pop_back();
+		if (scope_record::sNoQuery != scope.mBeginQuery) {
+			aCommandBuffer.writeTimestamp(aStage, *mCurrentFrame->mQueryPool, scope.mBeginQuery + 1);
+		}
+	}
+
+	/** Number of frames which have been begun so far, i.e., the frame number which the next begun frame gets */
+	uint64_t frame_count() const
+	{
+		return mFrameNumber;
+	}
+
+	/** Frame number of the frame which has been resolved most recently, std::nullopt if none has been resolved yet */
+	std::optional<uint64_t> last_resolved_frame_number() const
+	{
+		return mLastResolvedFrameNumber;
+	}
+
+	/** GPU times (in milliseconds) of the scopes of the frame which has been resolved most recently, by scope path */
+	const std::vector<std::pair<std::string, float>>& last_resolved_scopes() const
+	{
+		return mLastResolvedScopes;
+	}
+
+	/** Paths of all scopes which have been resolved so far, in the order of their first appearance */
+	const std::vector<std::string>& scope_paths() const
+	{
+		return mScopeOrder;
+	}
+
+	/** Nesting depth of the given scope, 0 for scopes which are not nested into another one */
+	uint32_t scope_depth(const std::string& aPath) const
+	{
+		const auto it = mStatistics.find(aPath);
+		return mStatistics.end() == it ? 0u : it->second.mDepth;
+	}
+
+	/** Compute the statistics of the given scope, all values are 0 if it has not been resolved yet */
+	scope_summary summary(const std::string& aPath) const
+	{
+		scope_summary result;
+		const auto it = mStatistics.find(aPath);
+		if (mStatistics.end() == it || 0 == it->second.mSampleCount) {
+			return result;
+		}
+		const auto& stats = it->second;
+		const auto n = std::min(static_cast<size_t>(stats.mSampleCount), sHistoryLength);
+		std::array<float, sHistoryLength> sorted;
+		std::copy_n(std::begin(stats.mHistory), n, std::begin(sorted));
+		std::sort(std::begin(sorted), std::begin(sorted) + n);
+		result.mLastMs = stats.mHistory[(stats.mNextSample + sHistoryLength - 1) % sHistoryLength];
+		result.mMinMs = sorted[0];
+		result.mAvgMs = std::accumulate(std::begin(sorted), std::begin(sorted) + n, 0.0f) / static_cast<float>(n);
+		result.mP99Ms = sorted[std::min(n - 1, (n * 99) / 100)];
+		return result;
+	}
+
+	/** Write the recently resolved scopes as Chrome trace event file (JSON). Nesting depths are mapped to thread ids.
+	 *	@return	true if the file could be written
+	 */
+	bool export_chrome_trace(const std::string& aFilePath) const
+	{
+		std::ofstream file(aFilePath);
+		if (!file) {
+			return false;
+		}
+		// Print the microsecond timestamps with a fixed nanosecond resolution, regardless of how far they are from the trace's origin:
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		for (size_t i = 0; i < mTraceEvents.size(); ++i) {
+			const auto& e = mTraceEvents[i];
+			file << (0 == i ? "\n" : ",\n")
+				<< "{\"name\":\"" << e.mName << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.mDepth
+				<< ",\"ts\":" << e.mBeginUs << ",\"dur\":" << e.mDurationUs << ",\"args\":{\"frame\":" << e.mFrameNumber << "}}";
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+private:
+	struct scope_record
+	{
+		static constexpr uint32_t sNoQuery = std::numeric_limits<uint32_t>::max();
+		std::string mPath;
+		uint32_t mDepth = 0;
+		/** Index of the begin query, the end query follows it; sNoQuery if the query pool has been exhausted */
+		uint32_t mBeginQuery = sNoQuery;
+	};
+
+	struct frame_data
+	{
+		vk::UniqueQueryPool mQueryPool;
+		std::vector<scope_record> mScopes;
+		uint32_t mQueryCount = 0;
+		uint64_t mFrameNumber = 0;
+	};
+
+	struct scope_statistics
+	{
+		uint32_t mDepth = 0;
+		std::array<float, sHistoryLength> mHistory{};
+		uint32_t mSampleCount = 0;
+		uint32_t mNextSample = 0;
+	};
+
+	struct trace_event
+	{
+		std::string mName;
+		uint32_t mDepth;
+		uint64_t mFrameNumber;
+		double mBeginUs;
+		double mDurationUs;
+	};
+
+	/** Read the results of the given frame's queries without waiting, and add them to the statistics.
+	 *	Scopes whose queries are not available (yet) are skipped.
+	 */
+	void resolve(const frame_data& aFrame)
+	{
+		if (0 == aFrame.mQueryCount) {
+			return;
+		}
+		constexpr auto stride = 2 * sizeof(uint64_t);
+		const auto result = avk::context().device().getQueryPoolResults(
+			*aFrame.mQueryPool, 0u, aFrame.mQueryCount, aFrame.mQueryCount * stride, mResults.data(), stride,
+			vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability
+		);
+		if (vk::Result::eSuccess != result && vk::Result::eNotReady != result) {
+			return;
+		}
+		mLastResolvedFrameNumber = aFrame.mFrameNumber;
+		mLastResolvedScopes.clear();
+
+		for (const auto& scope : aFrame.mScopes) {
+			if (scope_record::sNoQuery == scope.mBeginQuery) {
+				continue;
+			}
+			const auto* begin = &mResults[2 * scope.mBeginQuery];
+			const auto* end = begin + 2;
+			if (0 == begin[1] || 0 == end[1]) {
+				continue; // Not available
+			}
+			const double ticks = static_cast<double>((end[0] - begin[0]) & mTimestampMask);
+			const auto durationMs = static_cast<float>(ticks * mTimestampPeriodNs / 1000000.0);
+			mLastResolvedScopes.emplace_back(scope.mPath, durationMs);
+
+			auto [it, inserted] = mStatistics.try_emplace(scope.mPath);
+			auto& stats = it->second;
+			if (inserted) {
+				stats.mDepth = scope.mDepth;
+				mScopeOrder.push_back(scope.mPath);
+			}
+			stats.mHistory[stats.mNextSample] = durationMs;
+			stats.mNextSample = (stats.mNextSample + 1) % sHistoryLength;
+			++stats.mSampleCount;
+
+			if (!mTraceOriginSet) {
+				mTraceOrigin = begin[0];
+				mTraceOriginSet = true;
+			}
+			if (mTraceEvents.size() == sMaxTraceEvents) {
+				mTraceEvents.pop_front();
+			}
+			const auto name = scope.mPath.substr(scope.mPath.find_last_of('/') + 1);
+			mTraceEvents.push_back(trace_event{ name, scope.mDepth, aFrame.mFrameNumber,
+				static_cast<double>((begin[0] - mTraceOrigin) & mTimestampMask) * mTimestampPeriodNs / 1000.0,
+				ticks * mTimestampPeriodNs / 1000.0
+			});
+		}
+	}
+
+	std::vector<frame_data> mFrames;
+	frame_data* mCurrentFrame = nullptr;
+	/** Indices into mCurrentFrame->mScopes of the scopes which have been begun, but not ended yet */
+	std::vector<size_t> mOpenScopes;
+	uint64_t mFrameNumber = 0;
+	/** Buffer for the query results of one frame */
+	std::vector<uint64_t> mResults;
+
+	float mTimestampPeriodNs = 1.0f;
+	uint64_t mTimestampMask = ~uint64_t{ 0 };
+
+	std::unordered_map<std::string, scope_statistics> mStatistics;
+	std::vector<std::string> mScopeOrder;
+	std::optional<uint64_t> mLastResolvedFrameNumber;
+	std::vector<std::pair<std::string, float>> mLastResolvedScopes;
+
+	std::deque<trace_event> mTraceEvents;
+	uint64_t mTraceOrigin = 0;
+	bool mTraceOriginSet = false;
+};
@@ -9,11 +9,56 @@
 #include "../../shaders/lightsource_limits.h"
 #include "lights_editor.hpp"
 #include "camera_presets.hpp"
+#include "thread_pool.hpp"
+#include "geometry_cache.hpp"
+#include "async_uploader.hpp"
+#include "texture_compression.hpp"
+#include "mesh_lod.hpp"
+#include "mesh_optimization.hpp"
 
 namespace helpers
 {
+	/** Describes in which format load_models_and_scenes_from_file shall store the vertex data */
+	enum struct vertex_format
+	{
+		/** Positions, texture coordinates, normals, tangents, and bitangents in separate 32-bit float buffers */
+		full_precision,
+		/** One interleaved buffer of quantized compact_vertex elements */
+		compact
+	};
+
+	/** An interleaved, quantized vertex of 20 bytes (instead of 56 bytes in full precision):
+	 *	- mPosition.xyz:   snorm16 position relative to the material group's bounding box, mPosition.w: sign of the bitangent
+	 *	- mTexCoords:      unorm16 texture coordinates relative to the material group's texture coordinates range
+	 *	- mNormal/mTangent: snorm16 octahedral-encoded unit vectors
+	 *	The parameters to reconstruct positions and texture coordinates are stored in a vertex_dequantization.
+	 */
+	struct compact_vertex
+	{
+		int16_t  mPosition[4];
+		uint16_t mTexCoords[2];
+		int16_t  mNormal[2];
+		int16_t  mTangent[2];
+	};
+	static_assert(sizeof(compact_vertex) == 20);
+
+	/** Parameters to reconstruct the positions and texture coordinates of compact_vertex data:
+	 *	position  = mPositionOffset.xyz + mPositionScale.xyz * quantized position
+	 *	texCoords = mTexCoordsOffsetScale.xy + mTexCoordsOffsetScale.zw * quantized texture coordinates
+	 *	The defaults describe the identity, i.e., full precision data.
+	 */
+	struct vertex_dequantization
+	{
+		glm::vec4 mPositionOffset       = glm::vec4{ 0.0f, 0.0f, 0.0f, 0.0f };
+		glm::vec4 mPositionScale        = glm::vec4{ 1.0f, 1.0f, 1.0f, 0.0f };
+		glm::vec4 mTexCoordsOffsetScale = glm::vec4{ 0.0f, 0.0f, 1.0f, 1.0f };
+	};
+
 	/** A small helper struct which contains data for a draw call,
 	 *	including all relevant vertex attributes, and the material index.
+	 *	The buffers might be shared with other draw calls (see geometry_layout), therefore,
+	 *	the range of indices to be drawn is described by mIndexCount, mFirstIndex, and mVertexOffset.
+	 *	These describe the full detail level, which is also the first element of mLods.
 	 */
 	struct data_for_draw_call
 	{
@@ -23,10 +68,232 @@ namespace helpers
 		avk::buffer mNormalsBuffer;
 		avk::buffer mTangentsBuffer;
 		avk::buffer mBitangentsBuffer;
+		avk::buffer mCompactVerticesBuffer; // Only set with vertex_format::compact, instead of the five buffers above
+		uint32_t mIndexCount;
+		uint32_t mFirstIndex;
+		int32_t mVertexOffset;
+		vk::IndexType mIndexType = vk::IndexType::eUint32; // 16-bit indices, if the geometry cache has been written with them
 		int mMaterialIndex;
 		glm::mat4 mModelMatrix;
+		vertex_dequantization mDequantization;
+		// World-space axis-aligned bounding box of the draw call's geometry (used for frustum culling):
+		glm::vec3 mBoundsMin;
+		glm::vec3 mBoundsMax;
+		// Index ranges of the levels of detail in mIndexBuffer (all of which use mVertexOffset), from full to lowest detail:
+		std::array<geometry_cache::lod_range, geometry_cache::sMaxLodLevels> mLods{};
+		uint32_t mLodCount = 1;
+		// The buffers must not be used before the async_uploader's completed value has reached this (0 => ready immediately):
+		uint64_t mUploadValue = 0;
+		// All textures of the material are sampled with offset 0 and tiling 1, i.e., it can be drawn with a pipeline specialized for that:
+		bool mDefaultTextureTiling = false;
+	};
+
+	/** Describes how load_models_and_scenes_from_file shall create the geometry buffers */
+	enum struct geometry_layout
+	{
+		/** One index buffer and one buffer per vertex attribute for every material group */
+		buffers_per_material_group,
+		/** All material groups are suballocated from one single index buffer and one buffer per vertex attribute */
+		merged_buffers
+	};
+
+	/** CPU-side index and vertex data of one material group (or of multiple merged material groups) */
+	struct geometry_data
+	{
+		std::vector<uint32_t>  mIndices;
+		std::vector<glm::vec3> mPositions;
+		std::vector<glm::vec2> mTexCoords;
+		std::vector<glm::vec3> mNormals;
+		std::vector<glm::vec3> mTangents;
+		std::vector<glm::vec3> mBitangents;
+		// Only used with vertex_format::compact, in which case all of the vertex attribute vectors above are empty:
+		std::vector<compact_vertex> mCompactVertices;
+
+		size_t vertex_count() const { return std::max(mPositions.size(), mCompactVertices.size()); }
+	};
+
+	/** Index and vertex buffers created from geometry_data */
+	struct geometry_buffers
+	{
+		avk::buffer mIndexBuffer;
+		avk::buffer mPositionsBuffer;
+		avk::buffer mTexCoordsBuffer;
+		avk::buffer mNormalsBuffer;
+		avk::buffer mTangentsBuffer;
+		avk::buffer mBitangentsBuffer;
+		avk::buffer mCompactVerticesBuffer;
 	};
 
+	// Compute the axis-aligned bounding box of the given positions
+	static std::tuple<glm::vec3, glm::vec3> compute_bounding_box(const std::vector<glm::vec3>& aPositions)
+	{
+		if (aPositions.empty()) {
+			return std::make_tuple(glm::vec3{ 0.0f }, glm::vec3{ 0.0f });
+		}
+		glm::vec3 bbMin{ std::numeric_limits<float>::max() }, bbMax{ std::numeric_limits<float>::lowest() };
+		for (const auto& p : aPositions) {
+			bbMin = glm::min(bbMin, p);
+			bbMax = glm::max(bbMax, p);
+		}
+		return std::make_tuple(bbMin, bbMax);
+	}
+
+	// Transform an axis-aligned bounding box, and return the axis-aligned bounding box which encloses the result
+	static std::tuple<glm::vec3, glm::vec3> transform_bounding_box(const glm::vec3& aMin, const glm::vec3& aMax, const glm::mat4& aTransform)
+	{
+		const auto center     = glm::vec3{ aTransform * glm::vec4{ (aMin + aMax) * 0.5f, 1.0f } };
+		const auto halfExtent = glm::mat3{ glm::abs(aTransform[0]), glm::abs(aTransform[1]), glm::abs(aTransform[2]) } * ((aMax - aMin) * 0.5f);
+		return std::make_tuple(center - halfExtent, center + halfExtent);
+	}
+
+	static int16_t quantize_snorm16(float aValue)
+	{
+		return static_cast<int16_t>(std::round(glm::clamp(aValue, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	static uint16_t quantize_unorm16(float aValue)
+	{
+		return static_cast<uint16_t>(std::round(glm::clamp(aValue, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	// Map a unit vector onto the octahedron, unfolded into [-1, 1]^2. Decoded by oct_decode in transform_and_pass_on_compact.vert
+	static glm::vec2 octahedral_encode(glm::vec3 aUnitVector)
+	{
+		const auto l1Norm = glm::abs(aUnitVector.x) + glm::abs(aUnitVector.y) + glm::abs(aUnitVector.z);
+		if (l1Norm < 1e-12f) {
+			return glm::vec2{ 0.0f, 0.0f }; // Degenerate input, decodes to +z
+		}
+		aUnitVector /= l1Norm;
+		if (aUnitVector.z >= 0.0f) {
+			return glm::vec2{ aUnitVector.x, aUnitVector.y };
+		}
+		const auto signNotZero = glm::vec2{ aUnitVector.x >= 0.0f ? 1.0f : -1.0f, aUnitVector.y >= 0.0f ? 1.0f : -1.0f };
+		return (glm::vec2{ 1.0f } - glm::abs(glm::vec2{ aUnitVector.y, aUnitVector.x })) * signNotZero;
+	}
+
+	// Pack the full precision vertex attributes of aGeometry into aGeometry.mCompactVertices, and clear the full precision vectors.
+	// Positions are quantized relative to the bounding box of the geometry, texture coordinates relative to their range.
+	// Returns the parameters which are required to reconstruct positions and texture coordinates.
+	static vertex_dequantization pack_compact_vertices(geometry_data& aGeometry)
+	{
+		vertex_dequantization result;
+		const auto n = aGeometry.mPositions.size();
+		if (0 == n) {
+			return result;
+		}
+		assert(aGeometry.mTexCoords.size() == n && aGeometry.mNormals.size() == n && aGeometry.mTangents.size() == n && aGeometry.mBitangents.size() == n);
+
+		const auto [posMin, posMax] = compute_bounding_box(aGeometry.mPositions);
+		glm::vec2 uvMin{ std::numeric_limits<float>::max() }, uvMax{ std::numeric_limits<float>::lowest() };
+		for (const auto& uv : aGeometry.mTexCoords) {
+			uvMin = glm::min(uvMin, uv);
+			uvMax = glm::max(uvMax, uv);
+		}
+		// Prevent divisions by zero for flat bounding boxes or constant texture coordinates:
+		const auto posCenter     = (posMin + posMax) * 0.5f;
+		const auto posHalfExtent = glm::max((posMax - posMin) * 0.5f, glm::vec3{ 1e-6f });
+		const auto uvRange       = glm::max(uvMax - uvMin, glm::vec2{ 1e-6f });
+		result.mPositionOffset       = glm::vec4{ posCenter, 0.0f };
+		result.mPositionScale        = glm::vec4{ posHalfExtent, 0.0f };
+		result.mTexCoordsOffsetScale = glm::vec4{ uvMin, uvRange };
+
+		aGeometry.mCompactVertices.resize(n);
+		for (size_t i = 0; i < n; ++i) {
+			auto& v = aGeometry.mCompactVertices[i];
+			const auto pos = (aGeometry.mPositions[i] - posCenter) / posHalfExtent;
+			const auto uv  = (aGeometry.mTexCoords[i] - uvMin) / uvRange;
+			const auto nrm = octahedral_encode(aGeometry.mNormals[i]);
+			const auto tan = octahedral_encode(aGeometry.mTangents[i]);
+			// The bitangent is reconstructed as cross(normal, tangent) * sign:
+			const auto bitangentSign = glm::dot(glm::cross(aGeometry.mNormals[i], aGeometry.mTangents[i]), aGeometry.mBitangents[i]) < 0.0f ? -1.0f : 1.0f;
+			v.mPosition[0]  = quantize_snorm16(pos.x);
+			v.mPosition[1]  = quantize_snorm16(pos.y);
+			v.mPosition[2]  = quantize_snorm16(pos.z);
+			v.mPosition[3]  = quantize_snorm16(bitangentSign);
+			v.mTexCoords[0] = quantize_unorm16(uv.x);
+			v.mTexCoords[1] = quantize_unorm16(uv.y);
+			v.mNormal[0]    = quantize_snorm16(nrm.x);
+			v.mNormal[1]    = quantize_snorm16(nrm.y);
+			v.mTangent[0]   = quantize_snorm16(tan.x);
+			v.mTangent[1]   = quantize_snorm16(tan.y);
+		}
+
+		aGeometry.mPositions  = {};
+		aGeometry.mTexCoords  = {};
+		aGeometry.mNormals    = {};
+		aGeometry.mTangents   = {};
+		aGeometry.mBitangents = {};
+		return result;
+	}
+
+	// Append all the indices and vertices of aSource to aTarget. The indices are NOT offset, use the returned vertex offset when drawing.
+	// Returns the first index and the vertex offset of aSource's data within aTarget.
+	static std::tuple<uint32_t, int32_t> append_geometry_data(geometry_data& aTarget, const geometry_data& aSource)
+	{
+		const auto firstIndex   = static_cast<uint32_t>(aTarget.mIndices.size());
+		const auto vertexOffset = static_cast<int32_t>(aTarget.vertex_count());
+		aTarget.mIndices   .insert(std::end(aTarget.mIndices),    std::begin(aSource.mIndices),    std::end(aSource.mIndices));
+		aTarget.mPositions .insert(std::end(aTarget.mPositions),  std::begin(aSource.mPositions),  std::end(aSource.mPositions));
+		aTarget.mTexCoords .insert(std::end(aTarget.mTexCoords),  std::begin(aSource.mTexCoords),  std::end(aSource.mTexCoords));
+		aTarget.mNormals   .insert(std::end(aTarget.mNormals),    std::begin(aSource.mNormals),    std::end(aSource.mNormals));
+		aTarget.mTangents  .insert(std::end(aTarget.mTangents),   std::begin(aSource.mTangents),   std::end(aSource.mTangents));
+		aTarget.mBitangents.insert(std::end(aTarget.mBitangents), std::begin(aSource.mBitangents), std::end(aSource.mBitangents));
+		aTarget.mCompactVertices.insert(std::end(aTarget.mCompactVertices), std::begin(aSource.mCompactVertices), std::end(aSource.mCompactVertices));
+		return std::make_tuple(firstIndex, vertexOffset);
+	}
+
+	// Create a device buffer and add the command which fills it straight from the (mapped) memory at aData to aCommands
+	template <typename Meta>
+	static avk::buffer create_and_fill_buffer(const void* aData, size_t aElementSize, size_t aNumElements, std::vector<avk::recorded_commands_t>& aCommands)
+	{
+		auto bfr = avk::context().create_buffer(avk::memory_usage::device, {}, Meta::create_from_element_size(aElementSize, aNumElements));
+		aCommands.push_back(bfr->fill(aData, 0));
+		return bfr;
+	}
+
+	// Create device buffers for the given range of indices and vertices of the geometry cache. The commands which fill the buffers
+	// are added to aCommands, they must be submitted to a queue (and completed) before the buffers may be used.
+	static geometry_buffers create_geometry_buffers(const geometry_cache& aCache, uint64_t aFirstIndex, uint64_t aIndexCount, uint64_t aFirstVertex, uint64_t aVertexCount, std::vector<avk::recorded_commands_t>& aCommands)
+	{
+		geometry_buffers result;
+		result.mIndexBuffer = create_and_fill_buffer<avk::index_buffer_meta>(aCache.indices(aFirstIndex), aCache.header().mIndexSize, aIndexCount, aCommands);
+		if (aCache.header().mVertexFormat == static_cast<uint32_t>(vertex_format::compact)) {
+			// The compact_vertex members are described in the pipeline config, see transform_and_pass_on_compact.vert
+			result.mCompactVerticesBuffer = create_and_fill_buffer<avk::vertex_buffer_meta>(aCache.vertices(0, aFirstVertex), sizeof(compact_vertex), aVertexCount, aCommands);
+			return result;
+		}
+		result.mPositionsBuffer  = create_and_fill_buffer<avk::vertex_buffer_meta>(aCache.vertices(0, aFirstVertex), sizeof(glm::vec3), aVertexCount, aCommands);
+		result.mTexCoordsBuffer  = create_and_fill_buffer<avk::vertex_buffer_meta>(aCache.vertices(1, aFirstVertex), sizeof(glm::vec2), aVertexCount, aCommands);
+		result.mNormalsBuffer    = create_and_fill_buffer<avk::vertex_buffer_meta>(aCache.vertices(2, aFirstVertex), sizeof(glm::vec3), aVertexCount, aCommands);
+		result.mTangentsBuffer   = create_and_fill_buffer<avk::vertex_buffer_meta>(aCache.vertices(3, aFirstVertex), sizeof(glm::vec3), aVertexCount, aCommands);
+		result.mBitangentsBuffer = create_and_fill_buffer<avk::vertex_buffer_meta>(aCache.vertices(4, aFirstVertex), sizeof(glm::vec3), aVertexCount, aCommands);
+		return result;
+	}
+
+	// Handles of all buffers which have been created for the geometry data
+	static std::vector<vk::Buffer> buffer_handles(const geometry_buffers& aBuffers)
+	{
+		std::vector<vk::Buffer> handles;
+		for (const auto* bfr : { &aBuffers.mIndexBuffer, &aBuffers.mPositionsBuffer, &aBuffers.mTexCoordsBuffer, &aBuffers.mNormalsBuffer, &aBuffers.mTangentsBuffer, &aBuffers.mBitangentsBuffer, &aBuffers.mCompactVerticesBuffer }) {
+			if (bfr->has_value()) {
+				handles.push_back((*bfr)->handle());
+			}
+		}
+		return handles;
+	}
+
+	// Let a draw call reference the given buffers
+	static void assign_geometry_buffers(data_for_draw_call& aDrawCall, const geometry_buffers& aBuffers)
+	{
+		aDrawCall.mIndexBuffer      = aBuffers.mIndexBuffer;
+		aDrawCall.mPositionsBuffer  = aBuffers.mPositionsBuffer;
+		aDrawCall.mTexCoordsBuffer  = aBuffers.mTexCoordsBuffer;
+		aDrawCall.mNormalsBuffer    = aBuffers.mNormalsBuffer;
+		aDrawCall.mTangentsBuffer   = aBuffers.mTangentsBuffer;
+		aDrawCall.mBitangentsBuffer = aBuffers.mBitangentsBuffer;
+		aDrawCall.mCompactVerticesBuffer = aBuffers.mCompactVerticesBuffer;
+	}
+
 	static bool contains_blue_curtains(std::vector<std::tuple<const avk::model_t&, std::vector<avk::mesh_index_t>>>& aSelectedModelsAndMeshes)
 	{
 		size_t a = 0;
@@ -49,6 +316,61 @@ namespace helpers
 		return false;
 	}
 
+	/** CPU-side data of one material group, as it is archived in the cache file */
+	struct material_group_data
+	{
+		geometry_data mGeometry;
+		vertex_dequantization mDequantization;
+		// Object-space bounds of the material group, instances' world-space bounds are derived from them:
+		glm::vec3 mBoundsMin{ 0.0f };
+		glm::vec3 mBoundsMax{ 0.0f };
+		// Index ranges of the levels of detail within mGeometry.mIndices:
+		std::vector<geometry_cache::lod_range> mLods;
+	};
+
+	// Gather the indices and vertex attributes of the given meshes of a model, and compute their bounds.
+	// Only reads from aModel, i.e., can be invoked for multiple material groups concurrently.
+	static material_group_data generate_material_group_data(const avk::model& aModel, const std::vector<avk::mesh_index_t>& aMeshIndices, vertex_format aVertexFormat)
+	{
+		material_group_data result;
+		auto& geometry = result.mGeometry;
+		auto modelAndMeshes = avk::make_model_references_and_mesh_indices_selection(aModel, aMeshIndices);
+		geometry.mIndices = aModel->indices_for_meshes<uint32_t>(aMeshIndices);
+		geometry.mPositions = aModel->positions_for_meshes(aMeshIndices);
+		if (contains_blue_curtains(modelAndMeshes)) {
+			geometry.mIndices.erase(std::begin(geometry.mIndices), std::begin(geometry.mIndices) + 3 * 4864);
+		}
+		// Get all texture coordinates, normals, tangents, and bitangents for all submeshes with this material:
+		geometry.mTexCoords  = avk::get_2d_texture_coordinates_flipped(modelAndMeshes, 0);
+		geometry.mNormals    = avk::get_normals(modelAndMeshes);
+		geometry.mTangents   = avk::get_tangents(modelAndMeshes);
+		geometry.mBitangents = avk::get_bitangents(modelAndMeshes);
+
+		// Generate the levels of detail from the full precision positions; all levels share the vertices and follow each other in mIndices.
+		// Every level's triangles are reordered for the vertex cache, and then front-to-back in clusters to reduce overdraw:
+		const auto lodLevels = mesh_lod::generate_lod_chain(geometry.mIndices, geometry.mPositions, geometry_cache::sMaxLodLevels);
+		geometry.mIndices.clear();
+		for (const auto& levelIndices : lodLevels) {
+			const auto optimized = mesh_optimization::optimize_overdraw(mesh_optimization::optimize_vertex_cache(levelIndices, geometry.mPositions.size()), geometry.mPositions);
+			result.mLods.push_back(geometry_cache::lod_range{ static_cast<uint32_t>(geometry.mIndices.size()), static_cast<uint32_t>(optimized.size()) });
+			geometry.mIndices.insert(std::end(geometry.mIndices), std::begin(optimized), std::end(optimized));
+		}
+		// Reorder the vertices in the order in which they are fetched, which also drops those that are not referenced anymore (e.g., the removed curtain's):
+		const auto [remap, vertexCount] = mesh_optimization::vertex_fetch_remap(geometry.mIndices, geometry.mPositions.size());
+		mesh_optimization::remap_vertices(geometry.mPositions,  remap, vertexCount);
+		mesh_optimization::remap_vertices(geometry.mTexCoords,  remap, vertexCount);
+		mesh_optimization::remap_vertices(geometry.mNormals,    remap, vertexCount);
+		mesh_optimization::remap_vertices(geometry.mTangents,   remap, vertexCount);
+		mesh_optimization::remap_vertices(geometry.mBitangents, remap, vertexCount);
+
+		std::tie(result.mBoundsMin, result.mBoundsMax) = compute_bounding_box(geometry.mPositions);
+		// Quantize the vertex data at cache-build time, such that loading from the cache is as fast as possible:
+		if (aVertexFormat == vertex_format::compact) {
+			result.mDequantization = pack_compact_vertices(geometry);
+		}
+		return result;
+	}
+
 	static void set_terrain_material_config(avk::orca_scene_t& aScene)
 	{
 		auto applyMaterialChanges = [](avk::material_config &m, bool isTerrain) {
@@ -300,201 +622,376 @@ namespace helpers
 
 
 
+	/**	Load the given models/ORCA scenes from file, generate the data of all their material groups, and write it into a geometry cache file.
+	 *
+	 *	@param	aPathsAndTransforms		Models/ORCA scenes to load (the transformations are not applied, they are not part of the cache)
+	 *	@param	aVertexFormat			Store the vertex attributes in separate full precision streams, or as interleaved compact_vertex data
+	 *	@param	aGenerateInParallel		Generate the material groups' vertex data on a thread pool
+	 *	@param	aGeometryCacheFilePath	The cache file to be written
+	 *	@return	The material configs, in the order of the material indices stored in the cache file
+	 */
+	static std::vector<avk::material_config> build_geometry_cache(const std::vector<std::tuple<std::string, glm::mat4>>& aPathsAndTransforms, vertex_format aVertexFormat, bool aGenerateInParallel, const std::string& aGeometryCacheFilePath)
+	{
+		// The following loop gathers all the vertex and index data PER MATERIAL and the materials.
+		// Later, we'll use ONE draw call PER MATERIAL (and instance) to draw the whole scene.
+		std::vector<avk::material_config> materialConfigs;
+		std::vector<geometry_cache::material_group_entry> groups;
+		std::vector<geometry_cache::instance_entry> instances;
+		// All material groups' data is gathered in here, the cache file stores it like with geometry_layout::merged_buffers:
+		geometry_data mergedGeometry;
+
+		std::optional<thread_pool> workers;
+		if (aGenerateInParallel) {
+			workers.emplace();
+		}
+
+		for (size_t l = 0; l < aPathsAndTransforms.size(); ++l) {
+			const auto& path = std::get<std::string>(aPathsAndTransforms[l]);
+			// Load an ORCA scene from file:
+			avk::orca_scene orca;
+			avk::model_data model;
+			std::unordered_map<avk::material_config, std::vector<avk::model_and_mesh_indices>> distinctMaterialsFromFile;
+			std::function<avk::model_data& (avk::model_index_t)> getModelData;
+
+			int triesLeft = 2;
+			bool tryToLoadAsModel = !path.ends_with(".fscene"); // if it ends with .fscene we can be pretty sure it is a scene - so try that first!
+			bool succeeded = false;
+			while (!succeeded && (triesLeft > 0)) {
+				try {
+					if (tryToLoadAsModel) {
+						model.mFileName = path;
+						model.mName = path;
+						model.mInstances = { avk::model_instance_data{ path, glm::vec3{0.f, 0.f, 0.f}, glm::vec3{1.f, 1.f, 1.f}, glm::vec3{0.f, 0.f, 0.f} } };
+						model.mFullPathName = path;
+						model.mLoadedModel = avk::model_t::load_from_file(path, aiProcess_PreTransformVertices | aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+						// Get all the different materials from the model:
+						auto fromModel = model.mLoadedModel->distinct_material_configs(true);
+						for (auto& [matConfig, meshIndices] : fromModel) {
+							distinctMaterialsFromFile[matConfig].emplace_back(0, std::move(meshIndices));
+						}
+						getModelData = [&](avk::model_index_t aIndex) -> avk::model_data& { return model; };
+					} else {
+						//! ATTN: orca_scene_t::load_from_file() crashes instead of failing gracefully if path is not an orca file!!
+						orca = avk::orca_scene_t::load_from_file(path, aiProcess_PreTransformVertices | aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+						// Get all the different materials from the whole scene:
+						distinctMaterialsFromFile = orca->distinct_material_configs_for_all_models();
+						getModelData = [&](avk::model_index_t aIndex) -> avk::model_data& { return orca->model_at_index(aIndex); };
+					}
+					succeeded = true;
+				}
+				catch (avk::runtime_error& err) {
+					LOG_INFO(std::format("{} is not {} file, failed with error: {}", path, tryToLoadAsModel ? "a model" : "an ORCA", err.what()));
+				}
+				if (!succeeded) {
+					triesLeft--;
+					tryToLoadAsModel = !tryToLoadAsModel;
+				}
+			}
+			if (!succeeded) {
+				throw avk::runtime_error(std::format("{} is neither a model nor an ORCA file, failed to load.", path));
+			}
+
+			// All material groups of this file, i.e., all model_and_mesh_indices of all its distinct materials:
+			std::vector<std::tuple<int32_t, const avk::model_and_mesh_indices*>> groupsOfFile;
+			for (const auto& [matConfig, meshIndicesOfMaterial] : distinctMaterialsFromFile) {
+				const auto materialIndex = static_cast<int32_t>(materialConfigs.size());
+				materialConfigs.push_back(matConfig);
+				for (const auto& mi : meshIndicesOfMaterial) {
+					groupsOfFile.emplace_back(materialIndex, &mi);
+				}
+			}
+
+			// Generate the material groups' data, on the workers (if any):
+			std::vector<material_group_data> generatedGroups(groupsOfFile.size());
+			const auto generate = [&](size_t i) {
+				const auto* mi = std::get<const avk::model_and_mesh_indices*>(groupsOfFile[i]);
+				generatedGroups[i] = generate_material_group_data(getModelData(mi->mModelIndex).mLoadedModel, mi->mMeshIndices, aVertexFormat);
+			};
+			if (workers.has_value()) {
+				workers->parallel_for(groupsOfFile.size(), generate);
+				LOG_INFO(std::format("Generated the vertex data of {} material groups on {} threads", groupsOfFile.size(), workers->size()));
+			}
+			else {
+				for (size_t i = 0; i < groupsOfFile.size(); ++i) {
+					generate(i);
+				}
+			}
+
+			for (size_t i = 0; i < groupsOfFile.size(); ++i) {
+				const auto& [materialIndex, mi] = groupsOfFile[i];
+				const auto& group = generatedGroups[i];
+				const auto [firstIndex, vertexOffset] = append_geometry_data(mergedGeometry, group.mGeometry);
+
+				auto& entry = groups.emplace_back();
+				entry.mFirstIndex           = firstIndex;
+				entry.mIndexCount           = static_cast<uint32_t>(group.mGeometry.mIndices.size());
+				entry.mVertexOffset         = vertexOffset;
+				entry.mVertexCount          = static_cast<uint32_t>(group.mGeometry.vertex_count());
+				entry.mMaterialIndex        = materialIndex;
+				entry.mLoadeeIndex          = static_cast<uint32_t>(l);
+				entry.mPositionOffset       = group.mDequantization.mPositionOffset;
+				entry.mPositionScale        = group.mDequantization.mPositionScale;
+				entry.mTexCoordsOffsetScale = group.mDequantization.mTexCoordsOffsetScale;
+				entry.mBoundsMin            = glm::vec4{ group.mBoundsMin, 0.0f };
+				entry.mBoundsMax            = glm::vec4{ group.mBoundsMax, 0.0f };
+				entry.mLodCount             = static_cast<uint32_t>(group.mLods.size());
+				std::copy(std::begin(group.mLods), std::end(group.mLods), std::begin(entry.mLods));
+
+				// One draw call per instance of the material group's model will be created:
+				const auto& modelInstances = getModelData(mi->mModelIndex).mInstances;
+				entry.mFirstInstance = static_cast<uint32_t>(instances.size());
+				entry.mInstanceCount = static_cast<uint32_t>(modelInstances.size());
+				for (const auto& inst : modelInstances) {
+					instances.push_back(geometry_cache::instance_entry{ avk::matrix_from_transforms(inst.mTranslation, glm::quat(inst.mRotation), inst.mScaling) });
+				}
+			}
+		}
+
+		geometry_cache::file_header header{};
+		header.mVertexFormat = static_cast<uint32_t>(aVertexFormat);
+		const auto asBlob = [](const auto& aVector) {
+			return std::make_tuple(std::as_bytes(std::span{ aVector }), static_cast<uint32_t>(sizeof(aVector[0])));
+		};
+		const auto vertexStreams = aVertexFormat == vertex_format::compact
+			? std::vector{ asBlob(mergedGeometry.mCompactVertices) }
+			: std::vector{ asBlob(mergedGeometry.mPositions), asBlob(mergedGeometry.mTexCoords), asBlob(mergedGeometry.mNormals), asBlob(mergedGeometry.mTangents), asBlob(mergedGeometry.mBitangents) };
+		if (!geometry_cache::write(aGeometryCacheFilePath, header, groups, instances, mergedGeometry.mIndices, vertexStreams)) {
+			throw avk::runtime_error(std::format("Failed to write the geometry cache file {}", aGeometryCacheFilePath));
+		}
+		return materialConfigs;
+	}
+
+	/**	Transcode all textures referenced by the given materials into block-compressed DDS files with precomputed mip chains,
+	 *	and make the materials refer to them instead. Color textures become BC7 (sRGB), normal maps BC5 (z is reconstructed
+	 *	in the shader), single-channel data BC4, and everything else linear BC7. The DDS files are written into aTextureCacheDirectory
+	 *	and reused as long as they exist. If a texture cannot be transcoded, its material keeps referring to the original file.
+	 *
+	 *	@param	aMaterialConfigs		The materials whose texture paths are replaced
+	 *	@param	aTextureCacheDirectory	Directory for the DDS files, created if it does not exist
+	 */
+	static void transcode_material_textures(std::vector<avk::material_config>& aMaterialConfigs, const std::string& aTextureCacheDirectory = "texture_cache")
+	{
+		using fmt = texture_compression::format;
+		std::error_code ec;
+		std::filesystem::create_directories(aTextureCacheDirectory, ec);
+
+		// Gather every distinct (path, format) combination and the texture slots referring to it:
+		std::map<std::tuple<std::string, fmt>, std::vector<std::string*>> texturesToTranscode;
+		for (auto& m : aMaterialConfigs) {
+			const auto add = [&](std::string& aPath, fmt aFormat) {
+				if (!aPath.empty()) {
+					texturesToTranscode[std::make_tuple(aPath, aFormat)].push_back(&aPath);
+				}
+			};
+			add(m.mDiffuseTex,      fmt::bc7_srgb);
+			add(m.mAmbientTex,      fmt::bc7_srgb);
+			add(m.mEmissiveTex,     fmt::bc7_srgb);
+			add(m.mNormalsTex,      fmt::bc5);
+			add(m.mSpecularTex,     fmt::bc4); // Only .r is sampled
+			add(m.mHeightTex,       fmt::bc4);
+			add(m.mDisplacementTex, fmt::bc4);
+			add(m.mShininessTex,    fmt::bc4);
+			add(m.mOpacityTex,      fmt::bc7);
+			add(m.mReflectionTex,   fmt::bc7);
+			add(m.mLightmapTex,     fmt::bc7);
+			add(m.mExtraTex,        fmt::bc7);
+		}
+
+		std::vector<std::tuple<std::string, fmt>> keys;
+		for (const auto& [key, slots] : texturesToTranscode) {
+			keys.push_back(key);
+		}
+		std::vector<std::string> results(keys.size());
+
+		thread_pool workers;
+		workers.parallel_for(keys.size(), [&](size_t i) {
+			const auto& [srcPath, format] = keys[i];
+			static constexpr const char* sFormatNames[] = { "bc4", "bc5", "bc7", "bc7srgb" };
+			// The name depends on the source file's state and the encoder version, s.t. an edited source or a changed encoder is transcoded anew:
+			std::error_code sizeError, timeError;
+			const uintmax_t srcSize = std::filesystem::file_size(srcPath, sizeError);
+			const int64_t srcWriteTime = std::filesystem::last_write_time(srcPath, timeError).time_since_epoch().count();
+			const auto srcKey = std::format("{}|{}|{}|{}", srcPath, sizeError ? 0 : srcSize, timeError ? 0 : srcWriteTime, texture_compression::sEncoderVersion);
+			const auto dstPath = std::format("{}/{}_{:016x}.{}.dds",
+				aTextureCacheDirectory, std::filesystem::path(srcPath).stem().string(), std::hash<std::string>{}(srcKey), sFormatNames[static_cast<int>(format)]
+			);
+			if (std::filesystem::exists(dstPath)) {
+				results[i] = dstPath;
+				return;
+			}
+
+			int width, height, comp;
+			stbi_uc* pixels = stbi_load(srcPath.c_str(), &width, &height, &comp, 4);
+			if (nullptr == pixels) {
+				return; // Keep the original file, e.g. it might not be an 8-bit image
+			}
+			texture_compression::rgba_image level0;
+			level0.mWidth = static_cast<uint32_t>(width);
+			level0.mHeight = static_cast<uint32_t>(height);
+			level0.mPixels.assign(pixels, pixels + 4 * static_cast<size_t>(width) * height);
+			stbi_image_free(pixels);
+
+			std::vector<std::vector<uint8_t>> compressedLevels;
+			for (const auto& level : texture_compression::generate_mip_chain(std::move(level0), fmt::bc7_srgb == format)) {
+				compressedLevels.push_back(texture_compression::compress(level, format));
+			}
+			// Write to a temporary file first, so that an interrupted run never leaves a truncated DDS file behind:
+			const auto tmpPath = dstPath + ".tmp";
+			std::error_code renameError;
+			if (texture_compression::write_dds(tmpPath, format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), compressedLevels)) {
+				std::filesystem::rename(tmpPath, dstPath, renameError);
+				if (!renameError) {
+					results[i] = dstPath;
+				}
+			}
+		});
+
+		size_t numTranscoded = 0;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (results[i].empty()) {
+				LOG_WARNING(std::format("Could not transcode {}, using it uncompressed", std::get<std::string>(keys[i])));
+				continue;
+			}
+			for (auto* slot : texturesToTranscode[keys[i]]) {
+				*slot = results[i];
+			}
+			++numTranscoded;
+		}
+		LOG_INFO(std::format("Using {} of {} textures block-compressed from {}", numTranscoded, keys.size(), aTextureCacheDirectory));
+	}
+
 	/**	Load an ORCA scene from file
 	 *
+	 *	The scene's geometry is stored in a memory-mapped geometry cache file (see geometry_cache), and its materials and images
+	 *	in an avk::serializer cache file. Both are created during the first load, and subsequent loads only read from them.
+	 *	During the first load, the textures are transcoded into block-compressed DDS files (see transcode_material_textures).
+	 *
+	 *	@param	aPathsAndTransforms		Models/ORCA scenes to load, and the transformation to apply to each one of them
+	 *	@param	aQueue					Queue to submit the buffer uploads to
+	 *	@param	aGeometryLayout			Create separate buffers for every material group, or suballocate all of them from merged buffers
+	 *	@param	aVertexFormat			Store the vertex attributes in separate full precision buffers, or as interleaved compact_vertex data
+	 *	@param	aAsyncUploader			If set, the material groups' vertex data is generated on a thread pool, and the geometry buffers are uploaded
+	 *									through it without waiting for them. Each draw call's mUploadValue tells when its buffers may be used.
+	 *									Otherwise, the data is generated on the calling thread, and all uploads are waited for.
 	 */
 	static std::tuple<
 		     avk::buffer, std::vector<avk::image_sampler>, std::vector<data_for_draw_call>
 	       >
-		   load_models_and_scenes_from_file(std::vector<std::tuple<std::string, glm::mat4>> aPathsAndTransforms, avk::queue* aQueue)
+		   load_models_and_scenes_from_file(std::vector<std::tuple<std::string, glm::mat4>> aPathsAndTransforms, avk::queue* aQueue, geometry_layout aGeometryLayout = geometry_layout::merged_buffers, vertex_format aVertexFormat = vertex_format::full_precision, async_uploader* aAsyncUploader = nullptr)
 	{
-		const auto cacheFilePath = std::accumulate(
+		const auto cacheFilePathBase = std::accumulate(
 			std::begin(aPathsAndTransforms), std::end(aPathsAndTransforms),
 			std::string{ "a1" },
 			[](const auto& a, const auto& b) { return a + "_" + avk::extract_file_name(std::get<std::string>(b)); }
-		) + ".cache";
-		// If a cache file exists, i.e. the scene was serialized during a previous load, initialize the serializer in deserialize mode,
-		// else initialize the serializer in serialize mode to create the cache file while processing the scene.
-		auto serializer = avk::serializer(cacheFilePath, avk::does_cache_file_exist(cacheFilePath) 
+		) + (aVertexFormat == vertex_format::compact ? ".compact" : "") + ".v8"; // <-- Increment the version whenever the layout of the archived data changes
+		const auto cacheFilePath = cacheFilePathBase + ".cache";
+		const auto geometryCacheFilePath = cacheFilePathBase + ".geometry";
+
+		// If both cache files exist, i.e. the scene was cached during a previous load, initialize the serializer in deserialize mode,
+		// else initialize the serializer in serialize mode to create the cache files while processing the scene.
+		geometry_cache geometryCache;
+		const bool cached = avk::does_cache_file_exist(cacheFilePath) && geometryCache.open(geometryCacheFilePath, static_cast<uint32_t>(aVertexFormat));
+		auto serializer = avk::serializer(cacheFilePath, cached
 			? avk::serializer::mode::deserialize
 			: avk::serializer::mode::serialize
 		);
 
-		if (serializer.mode() == avk::serializer::mode::serialize) {
+		// The material configs are only needed during serialization, otherwise the serializer retrieves the materials from the cache file:
+		std::vector<avk::material_config> materialConfigs;
+		if (!cached) {
 			for (auto &pt : aPathsAndTransforms) {
 				LOG_INFO(std::format("About to load 3D model/scene from {}", avk::extract_file_name(std::get<std::string>(pt))));
 			}
 			LOG_INFO("Please be patient, this might take a while...");
+			materialConfigs = build_geometry_cache(aPathsAndTransforms, aVertexFormat, nullptr != aAsyncUploader, geometryCacheFilePath);
+			if (!geometryCache.open(geometryCacheFilePath, static_cast<uint32_t>(aVertexFormat))) {
+				throw avk::runtime_error(std::format("Failed to open the geometry cache file {}", geometryCacheFilePath));
+			}
+			transcode_material_textures(materialConfigs);
 		}
 		else {
-			LOG_INFO(std::format("About to load cached 3D model/scene from {}", cacheFilePath));
+			LOG_INFO(std::format("About to load cached 3D model/scene from {} and {}", cacheFilePath, geometryCacheFilePath));
 		}
 
-		// The following loop gathers all the vertex and index data PER MATERIAL and constructs the buffers and materials.
-		// Later, we'll use ONE draw call PER MATERIAL to draw the whole scene.
-		std::vector<avk::material_config> materialConfigs;
-		size_t materialIndex = 0;
-		std::vector<data_for_draw_call> drawCalls;
-
-		size_t numLoadees = (serializer.mode() == avk::serializer::mode::serialize) ? aPathsAndTransforms.size() : 0;
-		serializer.archive(numLoadees);
-		assert(numLoadees == aPathsAndTransforms.size());
+		const auto& header = geometryCache.header();
+		const auto groups = geometryCache.groups();
+		const auto instances = geometryCache.instances();
 
-		for (size_t l = 0; l < numLoadees; ++l) {
-			const auto& [path, transform] = aPathsAndTransforms[l];
-			// Load an ORCA scene from file:
-			avk::orca_scene orca;
-			avk::model_data model;
-			std::unordered_map<avk::material_config, std::vector<avk::model_and_mesh_indices>> distinctMaterialsFromFile;
-			std::function<avk::model_data& (avk::model_index_t)> getModelData;
-			
-			// Load orca scene for usage and serialization, loading the scene is not required if a cache file exists, i.e. mode == deserialize
-			if (serializer.mode() == avk::serializer::mode::serialize) {
-				int triesLeft = 2;
-				bool tryToLoadAsModel = !path.ends_with(".fscene"); // if it ends with .fscene we can be pretty sure it is a scene - so try that first!
-				bool succeeded = false;
-				while (!succeeded && (triesLeft > 0)) {
-					try {
-						if (tryToLoadAsModel) {
-							model.mFileName = path;
-							model.mName = path;
-							model.mInstances = { avk::model_instance_data{ path, glm::vec3{0.f, 0.f, 0.f}, glm::vec3{1.f, 1.f, 1.f}, glm::vec3{0.f, 0.f, 0.f} } };
-							model.mFullPathName = path;
-							model.mLoadedModel = avk::model_t::load_from_file(path, aiProcess_PreTransformVertices | aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
-							// Get all the different materials from the model:
-							auto fromModel = model.mLoadedModel->distinct_material_configs(true);
-							for (auto& [matConfig, meshIndices] : fromModel) {
-								distinctMaterialsFromFile[matConfig].emplace_back(0, std::move(meshIndices));
-							}
-							getModelData = [&](avk::model_index_t aIndex) -> avk::model_data& { return model; };
-						} else {
-							//! ATTN: orca_scene_t::load_from_file() crashes instead of failing gracefully if path is not an orca file!!
-							orca = avk::orca_scene_t::load_from_file(path, aiProcess_PreTransformVertices | aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
-							// Get all the different materials from the whole scene:
-							distinctMaterialsFromFile = orca->distinct_material_configs_for_all_models();
-							getModelData = [&](avk::model_index_t aIndex) -> avk::model_data& { return orca->model_at_index(aIndex); };
-						}
-						succeeded = true;
-					}
-					catch (avk::runtime_error& err) {
-						LOG_INFO(std::format("{} is not {} file, failed with error: {}", path, tryToLoadAsModel ? "a model" : "an ORCA", err.what()));
-					}
-					if (!succeeded) {
-						triesLeft--;
-						tryToLoadAsModel = !tryToLoadAsModel;
-					}
-				}
-				if (!succeeded) {
-					throw avk::runtime_error(std::format("{} is neither a model nor an ORCA file, failed to load.", path));
+		// All the buffers are filled straight from the mapped cache file; the commands are submitted per loadee (or once for merged buffers):
+		std::vector<data_for_draw_call> drawCalls;
+		std::vector<avk::recorded_commands_t> commandsToBeExcecuted;
+		std::vector<vk::Buffer> buffersToBeFilled;
+		size_t firstDrawCallOfSubmission = 0;
+		const auto submit = [&]() {
+			if (commandsToBeExcecuted.empty()) {
+				return;
+			}
+			if (nullptr != aAsyncUploader) {
+				// Don't wait, the draw calls become ready when the upload has completed:
+				const auto uploadValue = aAsyncUploader->submit(std::move(commandsToBeExcecuted), std::move(buffersToBeFilled));
+				for (size_t i = firstDrawCallOfSubmission; i < drawCalls.size(); ++i) {
+					drawCalls[i].mUploadValue = uploadValue;
 				}
 			}
+			else {
+				avk::context().record_and_submit_with_fence(std::move(commandsToBeExcecuted), *aQueue)->wait_until_signalled();
+			}
+			commandsToBeExcecuted.clear();
+			buffersToBeFilled.clear();
+			firstDrawCallOfSubmission = drawCalls.size();
+		};
 
-			// Get number of distinc materials from orca scene and serialize it or retrieve the number from the serializer
-			size_t numDistinctMaterials = (serializer.mode() == avk::serializer::mode::serialize) ? distinctMaterialsFromFile.size() : 0;
-			serializer.archive(numDistinctMaterials);
-
-			std::vector<avk::recorded_commands_t> commandsToBeExcecuted;
-
-			//auto model = avk::model_t::load_from_file(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
-			//model->distinct_material_configs();
-			auto materialFromFile = distinctMaterialsFromFile.begin();
-			for (int materialIndexFile = 0; materialIndexFile < numDistinctMaterials; ++materialIndexFile, ++materialIndex) {
-				// meshIndices is only needed during serialization, otherwise the serializer handles everything
-				// in the respective *_cached functions and meshIndices may be empty when passed to the
-				// respective functions.
-				size_t numMeshIndices;
-				std::vector<avk::model_and_mesh_indices> meshIndices;
-				if (serializer.mode() == avk::serializer::mode::serialize) {
-					materialConfigs.push_back(materialFromFile->first);
-					meshIndices = materialFromFile->second;
-					numMeshIndices = materialFromFile->second.size();
-					materialFromFile = std::next(materialFromFile);
-				}
-				// Serialize or retrieve the number of model_and_mesh_indices for the material
-				serializer.archive(numMeshIndices);
-
-				// The data in distinctMaterialsOrca encompasses all of the ORCA scene's models.
-				for (int meshIndicesIndex = 0; meshIndicesIndex < numMeshIndices; ++meshIndicesIndex) {
-					// Convinience function to retrieve the model data via the mesh indices from the orca scene while in serialize mode
-
-					// modelAndMeshes is only needed during serialization, otherwise the following buffers are filled by the
-					// serializer from the cache file in the repsective *_cached functions and modelAndMeshes may be empty.
-					std::vector<std::tuple<const avk::model_t&, std::vector<avk::mesh_index_t>>> modelAndMeshes;
-
-					std::vector<uint32_t> indices;
-					std::vector<glm::vec3> positions;
-
-					if (serializer.mode() == avk::serializer::mode::serialize) {
-						modelAndMeshes = avk::make_model_references_and_mesh_indices_selection(getModelData(meshIndices[meshIndicesIndex].mModelIndex).mLoadedModel, meshIndices[meshIndicesIndex].mMeshIndices);
-						indices = getModelData(meshIndices[meshIndicesIndex].mModelIndex).mLoadedModel->indices_for_meshes<uint32_t>(meshIndices[meshIndicesIndex].mMeshIndices);
-						positions = getModelData(meshIndices[meshIndicesIndex].mModelIndex).mLoadedModel->positions_for_meshes(meshIndices[meshIndicesIndex].mMeshIndices);
-						if (contains_blue_curtains(modelAndMeshes)) {
-							indices.erase(std::begin(indices), std::begin(indices) + 3 * 4864);
-						}
-					}
+		geometry_buffers mergedBuffers;
+		if (aGeometryLayout == geometry_layout::merged_buffers && header.mIndexCount > 0) {
+			// The cache file's blobs are laid out exactly like the merged buffers:
+			mergedBuffers = create_geometry_buffers(geometryCache, 0, header.mIndexCount, 0, header.mVertexCount, commandsToBeExcecuted);
+			buffersToBeFilled = buffer_handles(mergedBuffers);
+		}
 
-					auto [indicesBuffer,   cmdsIndices  ] = avk::create_buffer_cached<decltype(indices  ), avk::index_buffer_meta >(serializer, indices, avk::content_description::index);
-					commandsToBeExcecuted.push_back(std::move(cmdsIndices));
-					auto [positionsBuffer, cmdsPositions] = avk::create_buffer_cached<decltype(positions), avk::vertex_buffer_meta>(serializer, positions, avk::content_description::position);
-					commandsToBeExcecuted.push_back(std::move(cmdsPositions));
-
-															 // Get a buffer containing all texture coordinates for all submeshes with this material
-					auto [texCoordsBuffer, cmdsTexCoordsBuffer] = avk::create_2d_texture_coordinates_flipped_buffer_cached<avk::vertex_buffer_meta>(
-						serializer, modelAndMeshes, {}
-					);
-					commandsToBeExcecuted.push_back(std::move(cmdsTexCoordsBuffer));
-
-															   // Get a buffer containing all normals for all submeshes with this material
-					auto [normalsBuffer, cmdsNormalsBuffer] = avk::create_normals_buffer_cached<avk::vertex_buffer_meta>(
-						serializer, modelAndMeshes, {}
-					);
-					commandsToBeExcecuted.push_back(std::move(cmdsNormalsBuffer));
-
-															   // Get a buffer containing all tangents for all submeshes with this material
-					auto [tangentsBuffer, cmdsTangentsBuffer] = avk::create_tangents_buffer_cached<avk::vertex_buffer_meta>(
-						serializer, modelAndMeshes, {}
-					);
-					commandsToBeExcecuted.push_back(std::move(cmdsTangentsBuffer));
-
-															   // Get a buffer containing all bitangents for all submeshes with this material
-					auto [bitangentsBuffer, cmdsBitangentsBuffer] = avk::create_bitangents_buffer_cached<avk::vertex_buffer_meta>(
-						serializer, modelAndMeshes, {}
-					);
-					commandsToBeExcecuted.push_back(std::move(cmdsBitangentsBuffer));
-
-					 // Get the number of instances from the model and serialize it or retrieve it from the serializer
-					size_t numInstances = (serializer.mode() == avk::serializer::mode::serialize) ? getModelData(meshIndices[meshIndicesIndex].mModelIndex).mInstances.size() : 0;
-					serializer.archive(numInstances);
-
-					// Create a draw calls for instances with the current material
-					for (int instanceIndex = 0; instanceIndex < numInstances; ++instanceIndex) {
-						auto& newElement = drawCalls.emplace_back();
-						
-						newElement.mIndexBuffer       = indicesBuffer;
-						newElement.mPositionsBuffer   = positionsBuffer;
-						newElement.mNormalsBuffer     = normalsBuffer;
-						newElement.mTangentsBuffer    = tangentsBuffer;
-						newElement.mBitangentsBuffer  = bitangentsBuffer;
-						newElement.mTexCoordsBuffer   = texCoordsBuffer;
-
-						newElement.mMaterialIndex     = static_cast<int>(materialIndex);
-
-						// Create model matrix of instance and serialize it or retrieve it from the serializer
-						if (serializer.mode() == avk::serializer::mode::serialize) {
-							auto instances = getModelData(meshIndices[meshIndicesIndex].mModelIndex).mInstances;
-							newElement.mModelMatrix = avk::matrix_from_transforms(
-								instances[instanceIndex].mTranslation, glm::quat(instances[instanceIndex].mRotation), instances[instanceIndex].mScaling
-							);
-						}
-						serializer.archive(newElement.mModelMatrix);
+		for (size_t g = 0; g < groups.size(); ++g) {
+			const auto& group = groups[g];
+			geometry_buffers buffers;
+			if (aGeometryLayout == geometry_layout::merged_buffers) {
+				buffers = mergedBuffers;
+			}
+			else {
+				buffers = create_geometry_buffers(geometryCache, group.mFirstIndex, group.mIndexCount, static_cast<uint64_t>(group.mVertexOffset), group.mVertexCount, commandsToBeExcecuted);
+				const auto handles = buffer_handles(buffers);
+				buffersToBeFilled.insert(std::end(buffersToBeFilled), std::begin(handles), std::end(handles));
+			}
 
-						newElement.mModelMatrix = transform * newElement.mModelMatrix;
-					}
+			// Create a draw call for every instance of the material group:
+			const auto& transform = std::get<glm::mat4>(aPathsAndTransforms[group.mLoadeeIndex]);
+			for (uint32_t instanceIndex = 0; instanceIndex < group.mInstanceCount; ++instanceIndex) {
+				auto& newElement = drawCalls.emplace_back();
+
+				assign_geometry_buffers(newElement, buffers);
+				newElement.mFirstIndex        = aGeometryLayout == geometry_layout::merged_buffers ? group.mFirstIndex : 0u;
+				newElement.mLodCount          = std::max(group.mLodCount, 1u);
+				for (uint32_t l = 0; l < newElement.mLodCount; ++l) {
+					newElement.mLods[l] = geometry_cache::lod_range{ newElement.mFirstIndex + group.mLods[l].mFirstIndex, group.mLods[l].mIndexCount };
 				}
+				newElement.mIndexCount        = newElement.mLods[0].mIndexCount;
+				newElement.mFirstIndex        = newElement.mLods[0].mFirstIndex;
+				newElement.mVertexOffset      = aGeometryLayout == geometry_layout::merged_buffers ? group.mVertexOffset : 0;
+				newElement.mIndexType         = 2u == header.mIndexSize ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+				newElement.mDequantization    = vertex_dequantization{ group.mPositionOffset, group.mPositionScale, group.mTexCoordsOffsetScale };
+				newElement.mMaterialIndex     = group.mMaterialIndex;
+				newElement.mModelMatrix       = transform * instances[group.mFirstInstance + instanceIndex].mModelMatrix;
+				std::tie(newElement.mBoundsMin, newElement.mBoundsMax) = transform_bounding_box(glm::vec3{ group.mBoundsMin }, glm::vec3{ group.mBoundsMax }, newElement.mModelMatrix);
 			}
 
-			avk::context().record_and_submit_with_fence(std::move(commandsToBeExcecuted), *aQueue)->wait_until_signalled();
+			// With separate buffers per material group, the uploads of each loadee are submitted together:
+			if (aGeometryLayout == geometry_layout::buffers_per_material_group && (g + 1 == groups.size() || groups[g + 1].mLoadeeIndex != group.mLoadeeIndex)) {
+				submit();
+			}
+		}
+		submit();
+		if (aGeometryLayout == geometry_layout::merged_buffers) {
+			LOG_INFO(std::format("Merged geometry of {} draw calls into shared buffers with {} indices and {} vertices", drawCalls.size(), header.mIndexCount, header.mVertexCount));
 		}
+		// The mapping is not needed anymore, all data has been copied into staging buffers:
+		geometryCache.close();
 
 		// Convert the materials that were gathered above into a GPU-compatible format, and upload into a GPU storage buffer:
 		auto [gpuMaterials, imageSamplers, materialCommands] = avk::convert_for_gpu_usage_cached<avk::material_gpu_data>(
@@ -515,6 +1012,19 @@ namespace helpers
 		}, *aQueue);
 		fen->wait_until_signalled();
 
+		// Whether a material has default texture tiling is determined once per material, and looked up for its draw calls:
+		const auto isDefaultTiling = [](const glm::vec4& aOffsetTiling) { return aOffsetTiling == glm::vec4{ 0.0f, 0.0f, 1.0f, 1.0f }; };
+		std::vector<bool> defaultTextureTiling(gpuMaterials.size());
+		for (size_t m = 0; m < gpuMaterials.size(); ++m) {
+			const auto& material = gpuMaterials[m];
+			defaultTextureTiling[m] = isDefaultTiling(material.mDiffuseTexOffsetTiling) && isDefaultTiling(material.mSpecularTexOffsetTiling)
+				&& isDefaultTiling(material.mHeightTexOffsetTiling) && isDefaultTiling(material.mNormalsTexOffsetTiling);
+		}
+		for (auto& drawCall : drawCalls) {
+			drawCall.mDefaultTextureTiling = drawCall.mMaterialIndex >= 0 && static_cast<size_t>(drawCall.mMaterialIndex) < defaultTextureTiling.size()
+				&& defaultTextureTiling[drawCall.mMaterialIndex];
+		}
+
 		return std::make_tuple(
 			std::move(materialsBuffer), std::move(imageSamplers), std::move(drawCalls)
 		);
@@ -604,6 +1114,15 @@ namespace helpers
 		return sLightsources;
 	}
 
+	// tell the lights editor (if there is one) that a light has changed, s.t. the light data on the GPU can be updated incrementally
+	static void mark_lightsource_changed(const avk::lightsource& aLightsource)
+	{
+		auto lightsEd = avk::current_composition()->element_by_type<lights_editor>();
+		if (lightsEd) {
+			lightsEd->mark_changed(&aLightsource);
+		}
+	}
+
 	static void animate_lights(std::vector<avk::lightsource>& aLightsources, float aElapsedTime)
 	{
 		{
@@ -612,6 +1131,7 @@ namespace helpers
 				const auto speedXZ = 0.5f;
 				const auto radiusXZ = 1.5f;
 				it->mPosition = glm::vec3{-0.64f, 0.45f, 3.35f} + glm::vec3(radiusXZ * glm::sin(speedXZ * aElapsedTime), 0.0f, radiusXZ * glm::cos(speedXZ * aElapsedTime));
+				mark_lightsource_changed(*it);
 			}
 		}
 		{
@@ -621,6 +1141,7 @@ namespace helpers
 				const auto kDistanceX = -0.23f;
 				const auto kDistanceY = 1.0f;
 				it->mPosition = glm::vec3{-0.05f, 2.12f, 0.53f} + glm::vec3(kDistanceX * glm::sin(kSpeed * aElapsedTime), kDistanceY * glm::sin(kSpeed * aElapsedTime), 0.0f);
+				mark_lightsource_changed(*it);
 			}
 		}
 		{
@@ -629,6 +1150,7 @@ namespace helpers
 				const auto speedXZ = 0.75f;
 				const auto radiusXZ = 4.0f;
 				it->mPosition = glm::vec3{-2.0f, 1.45f, 17.0f} + glm::vec3(radiusXZ * glm::sin(speedXZ * aElapsedTime), 0.0f, radiusXZ * glm::cos(speedXZ * aElapsedTime));
+				mark_lightsource_changed(*it);
 			}
 		}
 	}
@@ -661,6 +1183,38 @@ namespace helpers
 		return get_lightsource_type_end_index(get_lights(), aLightsourceType);
 	}
 
+	// Compute the distance at which a light's attenuated intensity drops below aThreshold, i.e., its radius of influence.
+	// Solves aThreshold = max(color) / (c + l*d + q*d^2) for d, where c, l, q are the attenuation factors in aAttenuation.
+	static float calc_attenuation_radius(const glm::vec4& aColor, const glm::vec4& aAttenuation, float aThreshold = 1.0f / 256.0f)
+	{
+		const float maxIntensity = std::max({ aColor.r, aColor.g, aColor.b });
+		const float c = aAttenuation[0] - maxIntensity / aThreshold;
+		const float l = aAttenuation[1];
+		const float q = aAttenuation[2];
+		if (c >= 0.0f) {
+			return 0.0f; // Never exceeds the threshold
+		}
+		if (q > 0.0f) {
+			return (-l + std::sqrt(l * l - 4.0f * q * c)) / (2.0f * q);
+		}
+		if (l > 0.0f) {
+			return -c / l;
+		}
+		return std::numeric_limits<float>::max(); // Not attenuated at all
+	}
+
+	// Store the radius of influence of every point and spot light in the (otherwise unused) mAttenuation[3] of its GPU data.
+	// The shaders use it for clustered light culling, and to fade out the lights' contributions towards their radius.
+	template <typename T>
+	static void store_attenuation_radii(T& aGpuLights, const glm::uvec4& aRangesPointSpot)
+	{
+		for (const auto& [begin, end] : { std::make_tuple(aRangesPointSpot[0], aRangesPointSpot[1]), std::make_tuple(aRangesPointSpot[2], aRangesPointSpot[3]) }) {
+			for (auto i = begin; i < end; ++i) {
+				aGpuLights[i].mAttenuation[3] = calc_attenuation_radius(aGpuLights[i].mColor, aGpuLights[i].mAttenuation);
+			}
+		}
+	}
+
 	// create and initialize a lightsource editor
 	static lights_editor create_lightsource_editor(avk::queue& aQueueToSubmitTo, bool aGuiEnabled)
 	{
@@ -755,52 +1309,5 @@ namespace helpers
 			camPresets->set_gui_enabled(aVisible);
 		}
 	}
-
-	static std::unordered_map<std::string, std::tuple<vk::UniqueQueryPool, std::array<uint32_t, 2>, float>> sIntervals;
-
-	static vk::QueryPool& add_timing_interval_and_get_query_pool(const std::string& aName)
-	{
-		auto iter = sIntervals.find(aName);
-		if (iter == sIntervals.end()) {
-			vk::QueryPoolCreateInfo queryPoolCreateInfo;
-			queryPoolCreateInfo.setQueryCount(2);
-			queryPoolCreateInfo.setQueryType(vk::QueryType::eTimestamp);
-
-			iter = sIntervals.try_emplace(aName, avk::context().device().createQueryPoolUnique(queryPoolCreateInfo), std::array<uint32_t, 2>(), 0.0f).first;
-		}
-		return *std::get<0>(iter->second);
-	}
-
-	static void record_timing_interval_start(const vk::CommandBuffer& aCommandBuffer, const std::string& aName)
-	{
-		auto& queryPool = add_timing_interval_and_get_query_pool(aName);
-		aCommandBuffer.resetQueryPool(queryPool, 0u, 2u);
-		aCommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eAllGraphics, queryPool, 0u);
-	}
-
-	static void record_timing_interval_end(const vk::CommandBuffer& aCommandBuffer, const std::string& aName)
-	{
-		auto& queryPool = add_timing_interval_and_get_query_pool(aName);
-		aCommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eAllGraphics, queryPool, 1u);
-	}
-
-	// request last timing interval from GPU and return averaged interval from previous measurements (in ms)
-	static float get_timing_interval_in_ms(const std::string& aName)
-	{
-		auto iter = sIntervals.find(aName);
-		if (iter == sIntervals.end()) {
-			return 0.0f;
-		}
-		auto& [queryPool, timestamps, avgRendertime] = iter->second;
-		avk::context().device().getQueryPoolResults(*queryPool, 0u, 2u, sizeof(timestamps), timestamps.data(), sizeof(uint32_t), vk::QueryResultFlagBits::eWait);
-		float delta = (timestamps[1] - timestamps[0]) * avk::context().physical_device().getProperties().limits.timestampPeriod / 1000000.0f;
-		avgRendertime = avgRendertime * 0.9f + delta * 0.1f;
-		return avgRendertime;
-	}
-
-	static void clean_up_timing_resources()
-	{
-		sIntervals.clear();
-	}
 }
 
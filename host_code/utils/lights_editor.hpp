@@ -10,6 +10,8 @@
 #include "math_utils.hpp"
 #include "quake_camera.hpp"
 #include "simple_geometry.hpp"
+#include "frame_recorder.hpp"
+#include "cpu_profiler.hpp"
 #include "vk_convenience_functions.hpp"
 
 // TODO: use render_gizmos() instead of render() - this is currently complicated by ImGui !
@@ -25,8 +27,7 @@ public:
 	lights_editor(avk::queue& aQueueToSubmitTo, std::string aName = "lights_editor", bool aIsEnabled = true)
 		: invokee(std::move(aName), aIsEnabled)
 		, mQueue{ &aQueueToSubmitTo }
-		, mCone{ &aQueueToSubmitTo }
-		, mSphere{ &aQueueToSubmitTo }
+		, mGizmoGeometry{ &aQueueToSubmitTo }
 	{}
 
 	int execution_order() const override { return 1000; }
@@ -50,6 +51,10 @@ public:
 			fragment_shader("shaders/utils/translucent_gizmo.frag.spv"),
 
 			from_buffer_binding(0)->stream_per_vertex<glm::vec3>()->to_location(0), // aVertexPosition
+			from_buffer_binding(1)->stream_per_instance(&GizmoInstance::mPosition)->to_location(1),
+			from_buffer_binding(1)->stream_per_instance(&GizmoInstance::mScale)->to_location(2),
+			from_buffer_binding(1)->stream_per_instance(&GizmoInstance::mRotation)->to_location(3),
+			from_buffer_binding(1)->stream_per_instance(&GizmoInstance::mColor)->to_location(4),
 
 			cfg::front_face::define_front_faces_to_be_counter_clockwise(),
 			cfg::viewport_depth_scissors_config::from_framebuffer(avk::context().main_window()->backbuffer_reference_at_index(0)),
@@ -74,7 +79,7 @@ public:
 				}
 			),
 
-			push_constant_binding_data{ shader_type::vertex | shader_type::fragment, 0, sizeof(PushConstantsGizmos) }
+			push_constant_binding_data{ shader_type::vertex, 0, sizeof(PushConstantsGizmos) }
 		);
 
 		// create an updater, and add the pipeline (needed for window resize)
@@ -84,9 +89,15 @@ public:
 		// create a command pool
 		mCommandPool = avk::context().create_command_pool(mQueue->family_index(), vk::CommandPoolCreateFlagBits::eTransient);
 
-		// create sphere and cone geometry
-		mSphere.create_sphere();
-		mCone.create_cone();
+		// create sphere and cone geometry, in one set of buffers
+		mGizmoGeometry.begin_batch();
+		mGizmoGeometry.create_sphere();
+		mGizmoGeometry.create_cone();
+		mGizmoGeometry.end_batch();
+
+		// one (host-visible) instance buffer per frame in flight, (re-)created with the required size in update_gizmo_instances()
+		mGizmoInstanceBuffers.resize(avk::context().main_window()->number_of_frames_in_flight());
+		mGizmoInstanceCapacities.resize(mGizmoInstanceBuffers.size(), 0);
 
 		mGizmosInited = true;
 	}
@@ -126,19 +137,20 @@ public:
 			if (mIdxPnt.size() > 1) {
 				// *all* pointlights
 				if (CollapsingHeader("ALL point lights")) {
-					if (Button("Enable all"))  { for (auto idx : mIdxPnt) mLightEnabled[idx] = true;  }; SameLine();
-					if (Button("Disable all")) { for (auto idx : mIdxPnt) mLightEnabled[idx] = false; }
+					if (Button("Enable all"))  { for (auto idx : mIdxPnt) mLightEnabled[idx] = true;  mark_active_set_changed(); }; SameLine();
+					if (Button("Disable all")) { for (auto idx : mIdxPnt) mLightEnabled[idx] = false; mark_active_set_changed(); }
 					if (Button("Reset to initial state")) {
 						for (auto idx : mIdxPnt) {
 							*mLightsPtr[idx] = mLightsOriginal[idx];
+							mark_changed(idx);
 						}
 					}
 
 					// TODO: do we need a uniform position offset for the point lights?
 					auto p0 = mLightsPtr[mIdxPnt[0]];
 					glm::vec3 atten = glm::vec3(p0->mAttenuationConstant, p0->mAttenuationLinear, p0->mAttenuationQuadratic);
-					if (ColorEdit3 ("color", &p0->mColor.x, ImGuiColorEditFlags_NoInputs)) { for (auto idx : mIdxPnt) mLightsPtr[idx]->mColor = p0->mColor; }
-					if (DragFloat3("atten", &atten.x, dragSpeedAtt)                      ) { for (auto idx : mIdxPnt) mLightsPtr[idx]->set_attenuation(glm::max(0.0f, atten.x), glm::max(0.0f, atten.y), glm::max(0.0f, atten.z)); }
+					if (ColorEdit3 ("color", &p0->mColor.x, ImGuiColorEditFlags_NoInputs)) { for (auto idx : mIdxPnt) { mLightsPtr[idx]->mColor = p0->mColor; mark_changed(idx); } }
+					if (DragFloat3("atten", &atten.x, dragSpeedAtt)                      ) { for (auto idx : mIdxPnt) { mLightsPtr[idx]->set_attenuation(glm::max(0.0f, atten.x), glm::max(0.0f, atten.y), glm::max(0.0f, atten.z)); mark_changed(idx); } }
 					HelpMarker("Attenuation:\nconstant, linear, quadratic");
 				}
 			}
@@ -158,20 +170,22 @@ public:
 
 							PushID(imgui_id++);
 							if (multiple) { Text("#%d:", cnt); SameLine(); }
-							if (Checkbox("enabled", &ena)) mLightEnabled[idx] = ena;
+							bool changed = false;
+							if (Checkbox("enabled", &ena)) { mLightEnabled[idx] = ena; mark_active_set_changed(); }
 							SameLine();
-							ColorEdit3 ("color", &light->mColor.x, ImGuiColorEditFlags_NoInputs);
+							changed |= ColorEdit3 ("color", &light->mColor.x, ImGuiColorEditFlags_NoInputs);
 							SameLine();
 							if (Button("reset")) {
 								*mLightsPtr[idx] = mLightsOriginal[idx];
+								changed = true;
 							}
 
 							PushItemWidth(160);
 							if (pass == 2 || pass == 3) { // spot, point
-								DragFloat3("pos",   &light->mPosition.x, dragSpeedPos);
+								changed |= DragFloat3("pos",   &light->mPosition.x, dragSpeedPos);
 							}
 							if (pass == 1 || pass == 2) { // dir, spot
-								DragFloat3("direction", &light->mDirection.x, dragSpeedDir);
+								changed |= DragFloat3("direction", &light->mDirection.x, dragSpeedDir);
 							}
 							if (pass == 2) { // spot
 								float angO = glm::degrees(light->mAngleOuterCone);
@@ -179,16 +193,18 @@ public:
 								bool draggedO = false, draggedI = false;
 								if (DragFloat("outer angle", &angO, dragSpeedAng, 0.0f, 359.9f, "%.1f")) { draggedO = true; light->mAngleOuterCone = glm::radians(angO); }
 								if (DragFloat("inner angle", &angI, dragSpeedAng, 0.0f, 359.9f, "%.1f")) { draggedI = true; light->mAngleInnerCone = glm::radians(angI); }
-								if (DragFloat("falloff", &light->mFalloff, dragSpeedFal) && light->mFalloff < 0.0f) light->mFalloff = 0.0f;
+								if (DragFloat("falloff", &light->mFalloff, dragSpeedFal)) { changed = true; if (light->mFalloff < 0.0f) light->mFalloff = 0.0f; }
+								changed |= draggedO || draggedI;
 								if (draggedO && light->mAngleOuterCone < light->mAngleInnerCone) light->mAngleInnerCone = light->mAngleOuterCone;
 								if (draggedI && light->mAngleOuterCone < light->mAngleInnerCone) light->mAngleOuterCone = light->mAngleInnerCone;
 							}
 							if (pass == 2 || pass == 3) { // spot, point
 								glm::vec3 atten = glm::vec3(light->mAttenuationConstant, light->mAttenuationLinear, light->mAttenuationQuadratic);
-								if (DragFloat3("atten", &atten.x, dragSpeedAtt)) light->set_attenuation(glm::max(0.0f, atten.x), glm::max(0.0f, atten.y), glm::max(0.0f, atten.z));
+								if (DragFloat3("atten", &atten.x, dragSpeedAtt)) { light->set_attenuation(glm::max(0.0f, atten.x), glm::max(0.0f, atten.y), glm::max(0.0f, atten.z)); changed = true; }
 								HelpMarker("Attenuation:\nconstant, linear, quadratic");
 							}
 							PopItemWidth();
+							if (changed) mark_changed(idx);
 
 							PopID();
 							cnt++;
@@ -239,6 +255,8 @@ public:
 		avk::lightsource copy = *ptrLightsource;
 		mLightsOriginal.push_back(copy);
 		mLightEnabled.push_back(true);
+		mLightChanged.push_back(false);
+		mark_active_set_changed();
 
 		switch(ptrLightsource->mType) {
 		case avk::lightsource_type::ambient:		mIdxAmb.push_back(index);	break;
@@ -274,22 +292,73 @@ public:
 		return result;
 	}
 
+	/** Incremented whenever a light is enabled, disabled, or added, i.e., whenever the results of get_active_lights are reordered */
+	uint64_t active_set_version() const { return mActiveSetVersion; }
+	/** Incremented whenever any light changes, be it through the GUI, mark_changed, or a change of the active set */
+	uint64_t version() const { return mVersion; }
+
+	// notify the editor that a light has been modified from the outside (e.g., animated), s.t. it is reported by for_each_changed_active_light
+	void mark_changed(const avk::lightsource* aLightsource)
+	{
+		const auto it = std::find(std::begin(mLightsPtr), std::end(mLightsPtr), aLightsource);
+		if (std::end(mLightsPtr) != it) {
+			mark_changed(static_cast<int>(std::distance(std::begin(mLightsPtr), it)));
+		}
+	}
+
+	/**	Invoke aCallback(const avk::lightsource&, uint32_t aActiveIndex) for every active light which has changed since the last
+	 *	call to clear_changes, where aActiveIndex is its index in the results of get_active_lights() (without a point light limit).
+	 *	Lights which are not active are skipped; enabling or disabling lights is reported through active_set_version instead.
+	 */
+	template <typename F>
+	void for_each_changed_active_light(F&& aCallback)
+	{
+		update_active_indices();
+		for (auto idx : mChangedLights) {
+			if (mActiveIndex[idx] >= 0) {
+				aCallback(*mLightsPtr[idx], static_cast<uint32_t>(mActiveIndex[idx]));
+			}
+		}
+	}
+
+	// forget about all changes reported so far
+	void clear_changes()
+	{
+		for (auto idx : mChangedLights) mLightChanged[idx] = false;
+		mChangedLights.clear();
+	}
+
 	bool is_gui_enabled() { return mGuiEnabled; }
 	void set_gui_enabled(bool aEnabled) { mGuiEnabled = aEnabled; }
 
 	// TODO: make this render_gizmos() once problems with ImGui are solved
 	void render() override {
+		const cpu_profiler::scope profileRender{ "Lights editor" };
 		// get the camera
 		auto cam = avk::current_composition()->element_by_type<avk::quake_camera>();
 		if (nullptr == cam) {
 			return;
 		}
 
+		if (!mGizmosInited) return;
+		auto fif = avk::context().main_window()->in_flight_index_for_frame();
+		update_gizmo_instances(fif);
+
+		// if there is a frame_recorder, let it record the gizmos on a worker thread, and submit them together with everything else:
+		auto recorder = avk::current_composition()->element_by_type<frame_recorder>();
+		if (recorder) {
+			const auto pass = recorder->add_pass(mPipelineGizmos->renderpass_reference(), avk::context().main_window()->current_backbuffer_reference());
+			recorder->add_job(pass, [this, fif, projectionViewMatrix = cam->projection_and_view_matrix()](avk::command_buffer_t& cb) {
+				draw_gizmos(cb, projectionViewMatrix, fif);
+			});
+			return;
+		}
+
 		// record command buffer
 		auto cmdBfr = mCommandPool->alloc_command_buffer(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 		cmdBfr->begin_recording();
 		cmdBfr->record(avk::command::begin_render_pass_for_framebuffer(mPipelineGizmos->renderpass_reference(), avk::context().main_window()->current_backbuffer_reference()));
-		draw_gizmos(cmdBfr, cam->projection_and_view_matrix());
+		draw_gizmos(*cmdBfr, cam->projection_and_view_matrix(), fif);
 		cmdBfr->record(avk::command::end_render_pass());
 		cmdBfr->end_recording();
 
@@ -309,13 +378,37 @@ public:
 	}
 
 private:
-	void draw_gizmos(avk::command_buffer & cmd, const glm::mat4 & projectionViewMatrix)
+	void mark_changed(int aIndex)
 	{
-		// must already have started a renderpass
+		if (!mLightChanged[aIndex]) {
+			mLightChanged[aIndex] = true;
+			mChangedLights.push_back(aIndex);
+		}
+		++mVersion;
+	}
 
-		if (!mGizmosInited) return;
+	void mark_active_set_changed()
+	{
+		++mActiveSetVersion;
+		++mVersion;
+	}
 
-		cmd->record(avk::command::bind_pipeline(mPipelineGizmos.as_reference()));
+	// recompute the indices of the lights in the results of get_active_lights() after the active set has changed
+	void update_active_indices()
+	{
+		if (mActiveIndicesVersion == mActiveSetVersion) return;
+		mActiveIndex.resize(mLightsPtr.size());
+		int next = 0;
+		for (size_t i = 0; i < mLightsPtr.size(); ++i) {
+			mActiveIndex[i] = mLightEnabled[i] ? next++ : -1;
+		}
+		mActiveIndicesVersion = mActiveSetVersion;
+	}
+
+	// gather the instances of all enabled point light spheres, followed by those of all enabled spot light cones, and write them into the frame in flight's instance buffer
+	void update_gizmo_instances(avk::window::frame_id_t aInFlightIndex)
+	{
+		mGizmoInstances.clear();
 		for (auto idx : mIdxPnt) {
 			if (mLightEnabled[idx]) {
 				avk::lightsource *p = mLightsPtr[idx];
@@ -323,13 +416,10 @@ private:
 				auto d = mGizmoParams.paramPL;
 				auto s = mGizmoParams.scalePL / (p->mAttenuationConstant + p->mAttenuationLinear * d + p->mAttenuationQuadratic * d * d);
 
-				PushConstantsGizmos pushConstants;
-				pushConstants.pvmtMatrix = projectionViewMatrix * glm::translate(p->mPosition) * glm::scale(glm::vec3(s));
-				pushConstants.uColor = glm::vec4(p->mColor, mGizmoParams.opacity);
-				cmd->handle().pushConstants(mPipelineGizmos->layout_handle(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(pushConstants), &pushConstants);
-				cmd->record(avk::command::draw_indexed(mSphere.mIndexBuffer.as_reference(), mSphere.mPositionsBuffer.as_reference()));
+				mGizmoInstances.push_back(GizmoInstance{ glm::vec4(p->mPosition, 1.0f), glm::vec4(glm::vec3(s), 0.0f), glm::vec4(0, 0, 0, 1), glm::vec4(p->mColor, mGizmoParams.opacity) });
 			}
 		}
+		mNumPointLightGizmos = static_cast<uint32_t>(mGizmoInstances.size());
 		for (auto idx : mIdxSpt) {
 			if (mLightEnabled[idx]) {
 				avk::lightsource *p = mLightsPtr[idx];
@@ -337,17 +427,48 @@ private:
 				auto d = mGizmoParams.paramSL;
 				auto s = mGizmoParams.scaleSL / (p->mAttenuationConstant + p->mAttenuationLinear * d + p->mAttenuationQuadratic * d * d);
 				auto angleScale = tan(p->mAngleOuterCone * 0.5f);
+				auto q = avk::rotation_between_vectors(glm::vec3(0,1,0), p->mDirection);
 
-				PushConstantsGizmos pushConstants;
-				pushConstants.pvmtMatrix = projectionViewMatrix
-					* glm::translate(p->mPosition)
-					* glm::toMat4(avk::rotation_between_vectors(glm::vec3(0,1,0), p->mDirection))
-					* glm::scale(glm::vec3(s * angleScale, s, s * angleScale));
-				pushConstants.uColor = glm::vec4(p->mColor, mGizmoParams.opacity);
-				cmd->handle().pushConstants(mPipelineGizmos->layout_handle(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(pushConstants), &pushConstants);
-				cmd->record(avk::command::draw_indexed(mCone.mIndexBuffer.as_reference(), mCone.mPositionsBuffer.as_reference()));
+				mGizmoInstances.push_back(GizmoInstance{ glm::vec4(p->mPosition, 1.0f), glm::vec4(s * angleScale, s, s * angleScale, 0.0f), glm::vec4(q.x, q.y, q.z, q.w), glm::vec4(p->mColor, mGizmoParams.opacity) });
 			}
 		}
+		mNumSpotLightGizmos = static_cast<uint32_t>(mGizmoInstances.size()) - mNumPointLightGizmos;
+		if (mGizmoInstances.empty()) return;
+
+		// grow the buffer if needed; the frame which used it before with this in-flight index has completed already
+		auto& bfr = mGizmoInstanceBuffers[aInFlightIndex];
+		if (mGizmoInstanceCapacities[aInFlightIndex] < mGizmoInstances.size()) {
+			mGizmoInstanceCapacities[aInFlightIndex] = std::max(mGizmoInstances.size(), mGizmoInstanceCapacities[aInFlightIndex] * 2);
+			bfr = avk::context().create_buffer(avk::memory_usage::host_visible, {}, avk::vertex_buffer_meta::create_from_element_size(sizeof(GizmoInstance), mGizmoInstanceCapacities[aInFlightIndex]));
+		}
+		bfr->fill(mGizmoInstances.data(), 0, 0, mGizmoInstances.size() * sizeof(GizmoInstance)); // host-visible => no need to submit anything
+	}
+
+	void draw_gizmos(avk::command_buffer_t & cmd, const glm::mat4 & projectionViewMatrix, avk::window::frame_id_t aInFlightIndex)
+	{
+		// must already have started a renderpass
+
+		if (!mGizmosInited || mNumPointLightGizmos + mNumSpotLightGizmos == 0) return;
+
+		cmd.record(avk::command::bind_pipeline(mPipelineGizmos.as_reference()));
+		PushConstantsGizmos pushConstants{ projectionViewMatrix };
+		cmd.handle().pushConstants(mPipelineGizmos->layout_handle(), vk::ShaderStageFlagBits::eVertex, 0, sizeof(pushConstants), &pushConstants);
+
+		// one instanced draw call for all spheres, and one for all cones (whose instances follow the spheres' ones in the instance buffer)
+		// (both shapes are parts of the same buffers, hence they are bound only once)
+		auto& instances = mGizmoInstanceBuffers[aInFlightIndex];
+		const std::array<vk::Buffer, 2> vertexBuffers = { mGizmoGeometry.mPositionsBuffer->handle(), instances->handle() };
+		const std::array<vk::DeviceSize, 2> vertexBufferOffsets = { 0, 0 };
+		cmd.handle().bindVertexBuffers(0u, vertexBuffers, vertexBufferOffsets);
+		cmd.handle().bindIndexBuffer(mGizmoGeometry.mIndexBuffer->handle(), 0, vk::IndexType::eUint32);
+		const auto& sphere = mGizmoGeometry.parts()[0];
+		const auto& cone   = mGizmoGeometry.parts()[1];
+		if (mNumPointLightGizmos > 0) {
+			cmd.handle().drawIndexed(sphere.mIndexCount, mNumPointLightGizmos, sphere.mFirstIndex, sphere.mVertexOffset, 0u);
+		}
+		if (mNumSpotLightGizmos > 0) {
+			cmd.handle().drawIndexed(cone.mIndexCount, mNumSpotLightGizmos, cone.mFirstIndex, cone.mVertexOffset, mNumPointLightGizmos);
+		}
 	}
 
 	avk::queue* mQueue;
@@ -358,13 +479,33 @@ private:
 	std::vector<int> mIdxAmb, mIdxDir, mIdxPnt, mIdxSpt, mIdxOth;
 	std::vector<bool> mLightEnabled;
 
+	// change tracking, see version(), active_set_version(), and for_each_changed_active_light()
+	uint64_t mVersion = 0;
+	uint64_t mActiveSetVersion = 0;
+	uint64_t mActiveIndicesVersion = ~uint64_t{ 0 };
+	std::vector<bool> mLightChanged;
+	std::vector<int> mChangedLights;
+	std::vector<int> mActiveIndex;
+
 	struct PushConstantsGizmos {
-		glm::mat4 pvmtMatrix;
-		glm::vec4 uColor;
+		glm::mat4 pvMatrix;
 	};
 
+	// per-instance data of one gizmo; the vertex shader composes translate * rotate * scale
+	struct GizmoInstance {
+		glm::vec4 mPosition;
+		glm::vec4 mScale;
+		glm::vec4 mRotation; // quaternion (x, y, z, w)
+		glm::vec4 mColor;
+	};
+
+	std::vector<GizmoInstance> mGizmoInstances;
+	uint32_t mNumPointLightGizmos = 0, mNumSpotLightGizmos = 0;
+	std::vector<avk::buffer> mGizmoInstanceBuffers;
+	std::vector<size_t> mGizmoInstanceCapacities;
+
 	avk::graphics_pipeline mPipelineGizmos;
-	simple_geometry mSphere, mCone;
+	simple_geometry mGizmoGeometry; // parts: [0] sphere, [1] cone
 
 	struct {
 		float opacity = 0.3f;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+#include <unordered_map>
+
+/** Generates levels of detail of indexed triangle meshes, and selects a level from the projected size of a mesh's bounds.
+ *	The levels only consist of indices, which refer to the original vertices, i.e., they can share the vertex buffers of the full detail level.
+ *	Simplification works like meshoptimizer's sloppy simplification: The vertices are clustered in a uniform grid, every cluster is
+ *	collapsed onto the vertex closest to the cluster's average position, and triangles which become degenerate are dropped. The grid
+ *	resolution is found with a binary search, s.t. the result comes as close to the target index count as possible (without exceeding it).
+ *	Vertices which only differ in their attributes (e.g., at texture seams) are clustered together, which is fine for distant levels.
+ */
+class mesh_lod
+{
+public:
+	/** Generate the indices of all levels of detail, where level 0 are the given indices, and every level has at
+	 *	most aReduction times the indices of the previous one. Stops early if a level cannot be reduced any further.
+	 *	@param	aMaxLevels			Maximum number of levels, including level 0
+	 *	@param	aMinIndexCount		Levels with fewer indices are not generated
+	 */
+	static std::vector<std::vector<uint32_t>> generate_lod_chain(const std::vector<uint32_t>& aIndices, const std::vector<glm::vec3>& aPositions, uint32_t aMaxLevels, float aReduction = 0.5f, size_t aMinIndexCount = 3 * 64)
+	{
+		std::vector<std::vector<uint32_t>> levels{ aIndices };
+		while (levels.size() < aMaxLevels) {
+			const auto target = static_cast<size_t>(static_cast<float>(levels.back().size()) * aReduction) / 3 * 3;
+			if (target < aMinIndexCount) {
+				break;
+			}
+			auto simplified = simplify_sloppy(levels.back(), aPositions, target);
+			if (simplified.empty() || simplified.size() > target) {
+				break;
+			}
+			levels.push_back(std::move(simplified));
+		}
+		return levels;
+	}
+
+	/** Simplify the given triangles to at most aTargetIndexCount indices (fewer, if the grid cannot be made any coarser) */
+	static std::vector<uint32_t> simplify_sloppy(const std::vector<uint32_t>& aIndices, const std::vector<glm::vec3>& aPositions, size_t aTargetIndexCount)
+	{
+		if (aIndices.size() <= aTargetIndexCount) {
+			return aIndices;
+		}
+		glm::vec3 bbMin{ std::numeric_limits<float>::max() }, bbMax{ std::numeric_limits<float>::lowest() };
+		for (auto i : aIndices) {
+			bbMin = glm::min(bbMin, aPositions[i]);
+			bbMax = glm::max(bbMax, aPositions[i]);
+		}
+		const auto extent = std::max(std::max(bbMax.x - bbMin.x, bbMax.y - bbMin.y), std::max(bbMax.z - bbMin.z, 1e-12f));
+
+		// Largest grid resolution whose result does not exceed the target; coarser grids yield fewer triangles:
+		std::vector<uint32_t> best;
+		int lo = 1, hi = 1024;
+		while (lo <= hi) {
+			const int gridSize = (lo + hi) / 2;
+			auto result = collapse_clusters(aIndices, aPositions, bbMin, static_cast<float>(gridSize) / extent, gridSize);
+			if (result.size() <= aTargetIndexCount) {
+				best = std::move(result);
+				lo = gridSize + 1;
+			}
+			else {
+				hi = gridSize - 1;
+			}
+		}
+		return best;
+	}
+
+	/** Select the level of detail from the projected radius of a bounding box's enclosing sphere: Level 0 while the radius is at least
+	 *	aLodParams.w times the distance, every halving of the projected radius selects the next coarser level.
+	 *	@param	aLodParams	xyz = camera position in world space, w = 0.5 * viewport height * projection[1][1] / reference radius
+	 *						in pixels (i.e., pixels per unit at distance 1, relative to a radius which is drawn at level 0). w <= 0 => level 0.
+	 *	Must select the same levels as select_lod() in frustum_cull.comp.
+	 */
+	static uint32_t select_level(const glm::vec3& aCenter, const glm::vec3& aHalfExtent, const glm::vec4& aLodParams, uint32_t aLevelCount)
+	{
+		if (aLodParams.w <= 0.0f || aLevelCount <= 1) {
+			return 0;
+		}
+		const auto distance = glm::length(aCenter - glm::vec3{ aLodParams });
+		const auto ratio = glm::length(aHalfExtent) * aLodParams.w / std::max(distance, 1e-6f);
+		if (ratio >= 1.0f) {
+			return 0;
+		}
+		return std::min(aLevelCount - 1, static_cast<uint32_t>(std::floor(-std::log2(ratio))));
+	}
+
+private:
+	static std::vector<uint32_t> collapse_clusters(const std::vector<uint32_t>& aIndices, const std::vector<glm::vec3>& aPositions, const glm::vec3& aMin, float aCellsPerUnit, int aGridSize)
+	{
+		const auto cellOf = [&](const glm::vec3& aPosition) {
+			const auto c = glm::clamp(glm::ivec3{ (aPosition - aMin) * aCellsPerUnit }, glm::ivec3{ 0 }, glm::ivec3{ aGridSize - 1 });
+			return (static_cast<uint32_t>(c.x) * static_cast<uint32_t>(aGridSize) + static_cast<uint32_t>(c.y)) * static_cast<uint32_t>(aGridSize) + static_cast<uint32_t>(c.z);
+		};
+
+		// Average position of every cluster, then the vertex which is closest to it becomes the cluster's representative:
+		std::unordered_map<uint32_t, glm::vec4> sums;
+		for (auto i : aIndices) {
+			sums[cellOf(aPositions[i])] += glm::vec4{ aPositions[i], 1.0f };
+		}
+		std::unordered_map<uint32_t, std::tuple<uint32_t, float>> representatives;
+		for (auto i : aIndices) {
+			const auto cell = cellOf(aPositions[i]);
+			const auto& sum = sums[cell];
+			const auto d = glm::length(aPositions[i] - glm::vec3{ sum } / sum.w);
+			auto [it, inserted] = representatives.try_emplace(cell, i, d);
+			if (!inserted && d < std::get<float>(it->second)) {
+				it->second = std::make_tuple(i, d);
+			}
+		}
+
+		std::vector<uint32_t> result;
+		for (size_t t = 0; t + 2 < aIndices.size(); t += 3) {
+			const auto a = std::get<uint32_t>(representatives[cellOf(aPositions[aIndices[t + 0]])]);
+			const auto b = std::get<uint32_t>(representatives[cellOf(aPositions[aIndices[t + 1]])]);
+			const auto c = std::get<uint32_t>(representatives[cellOf(aPositions[aIndices[t + 2]])]);
+			if (a != b && b != c && c != a) {
+				result.insert(std::end(result), { a, b, c });
+			}
+		}
+		return result;
+	}
+};
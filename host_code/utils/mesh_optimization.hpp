@@ -0,0 +1,231 @@
+#pragma once
+
+#include <auto_vk_toolkit.hpp>
+
+/** Reorders indexed triangle meshes at cache-build time, s.t. they are cheaper to draw every frame:
+ *	 - optimize_vertex_cache reorders triangles for the GPU's post-transform vertex cache (Tom Forsyth's linear-speed algorithm)
+ *	 - optimize_overdraw reorders clusters of triangles front-to-back w.r.t. likely view directions (like Sander et al., and meshoptimizer)
+ *	 - vertex_fetch_remap + remap_vertices reorder the vertices in the order of first use, and drop unreferenced ones
+ *	Apply them in this order, the overdraw optimization keeps the vertex cache order within its clusters.
+ */
+class mesh_optimization
+{
+public:
+	/** Size of the simulated vertex cache, a bit larger than the caches of most GPUs, which is what the algorithm is tuned for */
+	static constexpr int sVertexCacheSize = 32;
+
+	/** Reorder the triangles of aIndices, s.t. they reuse recently transformed vertices as often as possible */
+	static std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& aIndices, size_t aVertexCount)
+	{
+		const size_t triangleCount = aIndices.size() / 3;
+		if (triangleCount < 2) {
+			return aIndices;
+		}
+
+		// Triangles adjacent to every vertex; the first liveTriangles[v] entries of a vertex's range are those not emitted yet:
+		std::vector<uint32_t> liveTriangles(aVertexCount, 0), offsets(aVertexCount + 1, 0), adjacency(triangleCount * 3);
+		for (size_t i = 0; i < triangleCount * 3; ++i) {
+			++liveTriangles[aIndices[i]];
+		}
+		for (size_t v = 0; v < aVertexCount; ++v) {
+			offsets[v + 1] = offsets[v] + liveTriangles[v];
+		}
+		{
+			std::vector<uint32_t> fill(std::begin(offsets), std::end(offsets) - 1);
+			for (size_t i = 0; i < triangleCount * 3; ++i) {
+				adjacency[fill[aIndices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<int> cachePosition(aVertexCount, -1);
+		std::vector<float> vertexScores(aVertexCount);
+		for (size_t v = 0; v < aVertexCount; ++v) {
+			vertexScores[v] = vertex_score(-1, liveTriangles[v]);
+		}
+		std::vector<float> triangleScores(triangleCount);
+		const auto updateTriangleScore = [&](uint32_t t) {
+			triangleScores[t] = vertexScores[aIndices[t * 3]] + vertexScores[aIndices[t * 3 + 1]] + vertexScores[aIndices[t * 3 + 2]];
+		};
+		for (uint32_t t = 0; t < triangleCount; ++t) {
+			updateTriangleScore(t);
+		}
+		std::vector<bool> emitted(triangleCount, false);
+
+		std::vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+		std::vector<uint32_t> cache, newCache;
+		int64_t best = std::distance(std::begin(triangleScores), std::max_element(std::begin(triangleScores), std::end(triangleScores)));
+		size_t nextUnemitted = 0;
+		while (best >= 0) {
+			const auto t = static_cast<uint32_t>(best);
+			emitted[t] = true;
+
+			// The emitted triangle's vertices move to the front of the cache:
+			newCache.clear();
+			for (uint32_t k = 0; k < 3; ++k) {
+				const auto v = aIndices[t * 3 + k];
+				result.push_back(v);
+				if (std::find(std::begin(newCache), std::end(newCache), v) == std::end(newCache)) {
+					newCache.push_back(v);
+				}
+				// Remove t from the vertex's live triangles:
+				auto* begin = &adjacency[offsets[v]];
+				auto* pos = std::find(begin, begin + liveTriangles[v], t);
+				std::swap(*pos, begin[--liveTriangles[v]]);
+			}
+			for (auto v : cache) {
+				if (std::find(std::begin(newCache), std::end(newCache), v) == std::end(newCache)) {
+					newCache.push_back(v);
+				}
+			}
+
+			// Update the scores of all vertices which have been in the cache (including the evicted ones) and of their live triangles:
+			for (size_t p = 0; p < newCache.size(); ++p) {
+				const auto v = newCache[p];
+				cachePosition[v] = p < static_cast<size_t>(sVertexCacheSize) ? static_cast<int>(p) : -1;
+				vertexScores[v] = vertex_score(cachePosition[v], liveTriangles[v]);
+			}
+			best = -1;
+			float bestScore = -1.0f;
+			for (auto v : newCache) {
+				for (uint32_t a = 0; a < liveTriangles[v]; ++a) {
+					const auto adjacent = adjacency[offsets[v] + a];
+					updateTriangleScore(adjacent);
+					if (triangleScores[adjacent] > bestScore) {
+						bestScore = triangleScores[adjacent];
+						best = adjacent;
+					}
+				}
+			}
+			if (newCache.size() > static_cast<size_t>(sVertexCacheSize)) {
+				newCache.resize(sVertexCacheSize);
+			}
+			std::swap(cache, newCache);
+
+			// Nothing adjacent to the cache is left => continue with any triangle which has not been emitted yet:
+			if (best < 0) {
+				while (nextUnemitted < triangleCount && emitted[nextUnemitted]) {
+					++nextUnemitted;
+				}
+				best = nextUnemitted < triangleCount ? static_cast<int64_t>(nextUnemitted) : -1;
+			}
+		}
+		return result;
+	}
+
+	/** Reorder clusters of triangles, s.t. those which face outwards (and likely occlude the others) are drawn first. The clusters are split where
+	 *	the vertex cache order starts over (all three vertices of a triangle miss the cache), s.t. the vertex cache efficiency is mostly preserved.
+	 */
+	static std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& aIndices, const std::vector<glm::vec3>& aPositions, size_t aMinClusterTriangles = 64)
+	{
+		const size_t triangleCount = aIndices.size() / 3;
+		if (triangleCount < 2 * aMinClusterTriangles) {
+			return aIndices;
+		}
+
+		// Simulate a FIFO cache to find the cluster boundaries:
+		std::vector<size_t> clusterStarts{ 0 };
+		std::vector<uint32_t> timestamps(aPositions.size(), 0);
+		uint32_t time = sVertexCacheSize + 1;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			int misses = 0;
+			for (size_t k = 0; k < 3; ++k) {
+				const auto v = aIndices[t * 3 + k];
+				if (time - timestamps[v] > static_cast<uint32_t>(sVertexCacheSize)) {
+					timestamps[v] = time++;
+					++misses;
+				}
+			}
+			if (3 == misses && t - clusterStarts.back() >= aMinClusterTriangles) {
+				clusterStarts.push_back(t);
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+
+		glm::vec3 meshCentroid{ 0.0f };
+		for (auto i : aIndices) {
+			meshCentroid += aPositions[i];
+		}
+		meshCentroid /= static_cast<float>(aIndices.size());
+
+		// Sort key of every cluster: How far its (area-weighted) centroid lies in the direction of its average normal
+		const size_t clusterCount = clusterStarts.size() - 1;
+		std::vector<float> clusterKeys(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c) {
+			glm::vec3 centroid{ 0.0f }, normal{ 0.0f };
+			float area = 0.0f;
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+				const auto& p0 = aPositions[aIndices[t * 3]];
+				const auto& p1 = aPositions[aIndices[t * 3 + 1]];
+				const auto& p2 = aPositions[aIndices[t * 3 + 2]];
+				const auto n = glm::cross(p1 - p0, p2 - p0);
+				const auto a = glm::length(n);
+				centroid += (p0 + p1 + p2) * (a / 3.0f);
+				normal += n;
+				area += a;
+			}
+			centroid = area > 0.0f ? centroid / area : meshCentroid;
+			const auto normalLength = glm::length(normal);
+			clusterKeys[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+		}
+		std::vector<size_t> clusterOrder(clusterCount);
+		std::iota(std::begin(clusterOrder), std::end(clusterOrder), size_t{ 0 });
+		std::stable_sort(std::begin(clusterOrder), std::end(clusterOrder), [&](size_t a, size_t b) { return clusterKeys[a] > clusterKeys[b]; });
+
+		std::vector<uint32_t> result;
+		result.reserve(aIndices.size());
+		for (auto c : clusterOrder) {
+			result.insert(std::end(result), std::begin(aIndices) + clusterStarts[c] * 3, std::begin(aIndices) + clusterStarts[c + 1] * 3);
+		}
+		return result;
+	}
+
+	/** Assign new vertex indices in the order of first use in aIndices, and rewrite aIndices accordingly.
+	 *	@return	The new index of every old vertex (~0u for unreferenced vertices), and the number of referenced vertices
+	 */
+	static std::tuple<std::vector<uint32_t>, size_t> vertex_fetch_remap(std::vector<uint32_t>& aIndices, size_t aVertexCount)
+	{
+		std::vector<uint32_t> remap(aVertexCount, ~0u);
+		uint32_t next = 0;
+		for (auto& i : aIndices) {
+			if (~0u == remap[i]) {
+				remap[i] = next++;
+			}
+			i = remap[i];
+		}
+		return std::make_tuple(std::move(remap), static_cast<size_t>(next));
+	}
+
+	/** Reorder a vertex attribute according to the result of vertex_fetch_remap */
+	template <typename T>
+	static void remap_vertices(std::vector<T>& aAttribute, const std::vector<uint32_t>& aRemap, size_t aNewVertexCount)
+	{
+		if (aAttribute.empty()) {
+			return;
+		}
+		std::vector<T> result(aNewVertexCount);
+		for (size_t v = 0; v < aAttribute.size(); ++v) {
+			if (~0u != aRemap[v]) {
+				result[aRemap[v]] = aAttribute[v];
+			}
+		}
+		aAttribute = std::move(result);
+	}
+
+private:
+	static float vertex_score(int aCachePosition, uint32_t aLiveTriangles)
+	{
+		if (0 == aLiveTriangles) {
+			return -1.0f; // No triangles left to emit
+		}
+		float score = 0.0f;
+		if (aCachePosition >= 0) {
+			// The most recent triangle's vertices get a fixed score, s.t. the next triangle does not simply reuse the same edge:
+			score = aCachePosition < 3
+				? 0.75f
+				: std::pow(1.0f - static_cast<float>(aCachePosition - 3) / static_cast<float>(sVertexCacheSize - 3), 1.5f);
+		}
+		// Prefer vertices with few remaining triangles, s.t. they can be dropped from the cache soon:
+		return score + 2.0f / std::sqrt(static_cast<float>(aLiveTriangles));
+	}
+};
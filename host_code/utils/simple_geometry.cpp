@@ -1,61 +1,76 @@
 #include <context_vulkan.hpp>
 
 #include "simple_geometry.hpp"
+#include "thread_pool.hpp"
 
 void simple_geometry::create_cone(int subdivision, bool closedBase, glm::mat4 applyTransform)
 {
-	if (mFlags != flags::none) throw avk::runtime_error("Unsupported geometry flags");
-
-	std::vector<glm::vec3> vert;
-	std::vector<uint32_t>  indx;
+	shape_data s;
 
 	if (subdivision < 3) subdivision = 3;
 	const float y = 1.0f;
 
 	float deltaTheta = glm::radians(360.f) / static_cast<float>(subdivision);
 
-	int numVert = subdivision + closedBase ? 2 : 1;
-	vert.reserve(numVert);
+	int numVert = 2 * subdivision + 1 + (closedBase ? subdivision + 1 : 0);
+	s.vert.reserve(numVert);
+	s.norm.reserve(numVert);
+	s.texc.reserve(numVert);
+
+	// the side's normal at angle theta, pointing away from the axis (and down, towards the apex)
+	auto sideNormal = [](float theta) { return glm::normalize(glm::vec3(cos(theta), -1.0f, -sin(theta))); };
 
-	vert.push_back(glm::vec3(0, 0, 0)); // apex
-	for (int stepTheta = 0; stepTheta < subdivision; ++stepTheta) {
+	// rim of the side, with one extra vertex for the tex coords seam
+	for (int stepTheta = 0; stepTheta <= subdivision; ++stepTheta) {
 		float theta = stepTheta * deltaTheta;
-		float x =  cos(theta);
-		float z = -sin(theta);
-		vert.push_back(glm::vec3(x, y, z));
+		s.vert.push_back(glm::vec3(cos(theta), y, -sin(theta)));
+		s.norm.push_back(sideNormal(theta));
+		s.texc.push_back(glm::vec2(static_cast<float>(stepTheta) / subdivision, 1.0f));
+	}
+	// one apex per segment, s.t. every segment gets the normal at its center
+	const int idxApex = subdivision + 1;
+	for (int i = 0; i < subdivision; ++i) {
+		float theta = (i + 0.5f) * deltaTheta;
+		s.vert.push_back(glm::vec3(0, 0, 0));
+		s.norm.push_back(sideNormal(theta));
+		s.texc.push_back(glm::vec2((i + 0.5f) / subdivision, 0.0f));
 	}
-	if (closedBase) vert.push_back(glm::vec3(0, y, 0)); // base center
 
 	for (int i = 0; i < subdivision; ++i) {
-		int j = (i + 1) % subdivision;
-		indx.push_back(0);
-		indx.push_back(1 + j);
-		indx.push_back(1 + i);
+		s.indx.push_back(idxApex + i);
+		s.indx.push_back(i + 1);
+		s.indx.push_back(i);
 	}
 	if (closedBase) {
-		int idxCenter = numVert - 1;
+		// the base has its own vertices, facing +y, with planar tex coords
+		const int idxCenter = static_cast<int>(s.vert.size());
+		s.vert.push_back(glm::vec3(0, y, 0));
+		s.norm.push_back(glm::vec3(0, 1, 0));
+		s.texc.push_back(glm::vec2(0.5f, 0.5f));
+		for (int stepTheta = 0; stepTheta < subdivision; ++stepTheta) {
+			float theta = stepTheta * deltaTheta;
+			float x =  cos(theta);
+			float z = -sin(theta);
+			s.vert.push_back(glm::vec3(x, y, z));
+			s.norm.push_back(glm::vec3(0, 1, 0));
+			s.texc.push_back(glm::vec2(x * 0.5f + 0.5f, z * 0.5f + 0.5f));
+		}
 
 		for (int i = 0; i < subdivision; ++i) {
 			int j = (i + 1) % subdivision;
-			indx.push_back(idxCenter);
-			indx.push_back(1 + i);
-			indx.push_back(1 + j);
+			s.indx.push_back(idxCenter);
+			s.indx.push_back(idxCenter + 1 + i);
+			s.indx.push_back(idxCenter + 1 + j);
 		}
 	}
 
-	apply_transform_and_create_buffers(applyTransform, vert, indx);
+	add_shape(s, applyTransform);
 }
 
 void simple_geometry::create_sphere(int subdivisionVertical, int subdivisionCircumference, glm::mat4 applyTransform)
 {
-	const bool explicitTangent = true; // explicitly calc tangents - avoids discontinuity at tex coords seam
-
-	std::vector<glm::vec3> vert;
-	std::vector<glm::vec3> norm;
-	std::vector<glm::vec3> tang;
-	std::vector<glm::vec3> bita;
-	std::vector<glm::vec2> texc;
-	std::vector<uint32_t>  indx;
+	shape_data s;
+	s.mExplicitTangents = true; // explicitly calc tangents - avoids discontinuity at tex coords seam
 
 	if (subdivisionVertical      < 1) subdivisionVertical      = 1;
 	if (subdivisionCircumference < 3) subdivisionCircumference = 3;
@@ -64,11 +79,11 @@ void simple_geometry::create_sphere(int subdivisionVertical, int subdivisionCirc
 	float deltaTheta = glm::radians(360.f) / static_cast<float>(subdivisionCircumference);
 
 	int numVert = (subdivisionVertical + 1) * (subdivisionCircumference + 1);
-	vert.reserve(numVert);
-	texc.reserve(numVert);
-	norm.reserve(numVert);
-	tang.reserve(numVert);
-	bita.reserve(numVert);
+	s.vert.reserve(numVert);
+	s.texc.reserve(numVert);
+	s.norm.reserve(numVert);
+	s.tang.reserve(numVert);
+	s.bita.reserve(numVert);
 
 	for (int stepPhi = 0; stepPhi <= subdivisionVertical; ++stepPhi) {
 		float phi = stepPhi * deltaPhi;
@@ -80,22 +95,17 @@ void simple_geometry::create_sphere(int subdivisionVertical, int subdivisionCirc
 			float x =  cos(theta) * r;
 			float z = -sin(theta) * r;
 			float u = static_cast<float>(stepTheta) / subdivisionCircumference;
-			vert.push_back(glm::vec3(x, y, z));
-			texc.push_back(glm::vec2(u, v));
-			norm.push_back(glm::normalize(glm::vec3(x, y, z)));
-			if (explicitTangent) {
-				glm::mat4 rPhi   = glm::rotate(phi,   glm::vec3(0, 0, -1));
-				glm::mat4 rTheta = glm::rotate(theta, glm::vec3(0, 1, 0));
-				glm::vec3 t = glm::vec3(rTheta * glm::vec4(0, 0, -1, 0));
-				glm::vec3 b = glm::vec3(rTheta * rPhi * glm::vec4(1, 0, 0, 0));
-				tang.push_back(t);
-				bita.push_back(b);
-			}
+			s.vert.push_back(glm::vec3(x, y, z));
+			s.texc.push_back(glm::vec2(u, v));
+			s.norm.push_back(glm::normalize(glm::vec3(x, y, z)));
+			glm::mat4 rPhi   = glm::rotate(phi,   glm::vec3(0, 0, -1));
+			glm::mat4 rTheta = glm::rotate(theta, glm::vec3(0, 1, 0));
+			s.tang.push_back(glm::vec3(rTheta * glm::vec4(0, 0, -1, 0)));
+			s.bita.push_back(glm::vec3(rTheta * rPhi * glm::vec4(1, 0, 0, 0)));
 		}
 	}
 
-	// TODO: reserve indx
-
+	s.indx.reserve(subdivisionVertical * subdivisionCircumference * 6);
 	for (int lat = 0; lat < subdivisionVertical; ++lat) {
 		int v_start = lat * (subdivisionCircumference + 1);
 		for (int lon = 0; lon < subdivisionCircumference; ++lon) {
@@ -103,232 +113,288 @@ void simple_geometry::create_sphere(int subdivisionVertical, int subdivisionCirc
 			int b = v_start + lon + (subdivisionCircumference + 1);
 			int c = v_start + lon + (subdivisionCircumference + 1) + 1;
 			int d = v_start + lon                                  + 1;
-			indx.push_back(a);
-			indx.push_back(b);
-			indx.push_back(c);
-			indx.push_back(c);
-			indx.push_back(d);
-			indx.push_back(a);
+			s.indx.push_back(a);
+			s.indx.push_back(b);
+			s.indx.push_back(c);
+			s.indx.push_back(c);
+			s.indx.push_back(d);
+			s.indx.push_back(a);
 		}
 	}
 
-	apply_transform_and_create_buffers(applyTransform, vert, indx, norm, texc, tang, bita);
+	add_shape(s, applyTransform);
 }
 
 void simple_geometry::create_cube(glm::mat4 applyTransform)
 {
-	if (mFlags != flags::none) throw avk::runtime_error("Unsupported geometry flags");
-
-	const float d = 1.0f;
-	std::vector<glm::vec3> vert = {
-		{-d, -d,  d}, { d, -d,  d}, { d, -d, -d}, {-d, -d, -d},	// bottom
-		{-d,  d,  d}, { d,  d,  d}, { d,  d, -d}, {-d,  d, -d},	// top
-	};
-	std::vector<uint32_t> indx = {
-		0, 1, 5,  0, 5, 4, // +z face
-		2, 3, 7,  2, 7, 6, // -z face
-		1, 2, 6,  1, 6, 5, // +x face
-		3, 0, 4,  3, 4, 7, // -x face
-		4, 5, 6,  4, 6, 7, // +y face
-		3, 2, 1,  3, 1, 0  // -y face
+	shape_data s;
+
+	// every face has its own four vertices (for its normal and tex coords): center n, spanned by u and v (u x v = n => ccw from outside)
+	struct face { glm::vec3 n, u, v; };
+	const face faces[] = {
+		{ { 0, 0, 1}, { 1, 0, 0}, {0, 1,  0} }, // +z face
+		{ { 0, 0,-1}, {-1, 0, 0}, {0, 1,  0} }, // -z face
+		{ { 1, 0, 0}, { 0, 0,-1}, {0, 1,  0} }, // +x face
+		{ {-1, 0, 0}, { 0, 0, 1}, {0, 1,  0} }, // -x face
+		{ { 0, 1, 0}, { 1, 0, 0}, {0, 0, -1} }, // +y face
+		{ { 0,-1, 0}, { 1, 0, 0}, {0, 0,  1} }  // -y face
 	};
+	const glm::vec2 corners[] = { {0, 0}, {1, 0}, {1, 1}, {0, 1} };
+	for (const auto &f : faces) {
+		const uint32_t first = static_cast<uint32_t>(s.vert.size());
+		for (const auto &c : corners) {
+			s.vert.push_back(f.n + f.u * (c.x * 2.0f - 1.0f) + f.v * (c.y * 2.0f - 1.0f));
+			s.norm.push_back(f.n);
+			s.texc.push_back(c);
+		}
+		for (uint32_t i : { 0u, 1u, 2u, 0u, 2u, 3u }) {
+			s.indx.push_back(first + i);
+		}
+	}
 
-	apply_transform_and_create_buffers(applyTransform, vert, indx);
+	add_shape(s, applyTransform);
 }
 
 void simple_geometry::create_line_cube(glm::mat4 applyTransform)
 {
-	if (mFlags != flags::none) throw avk::runtime_error("Unsupported geometry flags");
+	shape_data s;
+	s.mTriangles = false;
 
 	const float d = 1.0f;
-	std::vector<glm::vec3> vert = {
+	s.vert = {
 		{-d, -d,  d}, { d, -d,  d}, { d, -d, -d}, {-d, -d, -d},	// bottom
 		{-d,  d,  d}, { d,  d,  d}, { d,  d, -d}, {-d,  d, -d},	// top
 	};
-	std::vector<uint32_t> indx = {
+	s.indx = {
 		0, 1,  1, 2,  2, 3,  3, 0,
 		4, 5,  5, 6,  6, 7,  7, 4,
 		0, 4,  1, 5,  2, 6,  3, 7
 	};
+	// lines have no surface: normals point away from the center, tex coords are unused
+	for (auto &v : s.vert) s.norm.push_back(glm::normalize(v));
+	s.texc.resize(s.vert.size(), glm::vec2(0));
 
-	apply_transform_and_create_buffers(applyTransform, vert, indx);
+	add_shape(s, applyTransform);
 }
 
 void simple_geometry::create_grid(bool twoSided, int subdivisionsX, int subdivisionsZ, glm::mat4 applyTransform)
 {
-	if (mFlags != flags::none) throw avk::runtime_error("Unsupported geometry flags");
-
-	std::vector<glm::vec3> vert;
-	std::vector<uint32_t>  indx;
+	shape_data s;
 
 	int m = subdivisionsX + 2;
 	int n = subdivisionsZ + 2;
-	vert.reserve(n * m);
-	indx.reserve((n - 1) * (m - 1) * 6 * (twoSided ? 2 : 1));
+	// the back side has its own vertices, with opposite normals
+	const int numSides = twoSided ? 2 : 1;
+	s.vert.reserve(n * m * numSides);
+	s.norm.reserve(n * m * numSides);
+	s.texc.reserve(n * m * numSides);
+	s.indx.reserve((n - 1) * (m - 1) * 6 * numSides);
 
 	float dx = 1.0f / static_cast<float>(m - 1);
 	float dz = 1.0f / static_cast<float>(n - 1);
-	for (int zz = 0; zz < n; ++zz) {
-		for (int xx = 0; xx < m; ++xx) {
-			vert.push_back(glm::vec3(-0.5f + xx * dx, 0, -0.5f + zz * dz));
+	for (int side = 0; side < numSides; ++side) {
+		for (int zz = 0; zz < n; ++zz) {
+			for (int xx = 0; xx < m; ++xx) {
+				s.vert.push_back(glm::vec3(-0.5f + xx * dx, 0, -0.5f + zz * dz));
+				s.norm.push_back(glm::vec3(0, 0 == side ? 1 : -1, 0));
+				s.texc.push_back(glm::vec2(xx * dx, zz * dz));
+			}
 		}
 	}
 
+	const uint32_t back = static_cast<uint32_t>(n * m);
 	for (int zz = 0; zz < n-1; ++zz) {
 		for (int xx = 0; xx < m-1; ++xx) {
 			uint32_t p0 =  zz      * m + xx;
 			uint32_t p1 = (zz + 1) * m + xx;
 			uint32_t p2 = (zz + 1) * m + xx + 1;
 			uint32_t p3 =  zz      * m + xx + 1;
-			indx.push_back(p0);
-			indx.push_back(p1);
-			indx.push_back(p2);
-			indx.push_back(p2);
-			indx.push_back(p3);
-			indx.push_back(p0);
+			s.indx.push_back(p0);
+			s.indx.push_back(p1);
+			s.indx.push_back(p2);
+			s.indx.push_back(p2);
+			s.indx.push_back(p3);
+			s.indx.push_back(p0);
 			if (twoSided) {
-				indx.push_back(p3);
-				indx.push_back(p2);
-				indx.push_back(p1);
-				indx.push_back(p1);
-				indx.push_back(p0);
-				indx.push_back(p3);
+				s.indx.push_back(back + p3);
+				s.indx.push_back(back + p2);
+				s.indx.push_back(back + p1);
+				s.indx.push_back(back + p1);
+				s.indx.push_back(back + p0);
+				s.indx.push_back(back + p3);
 			}
 		}
 	}
 
-	apply_transform_and_create_buffers(applyTransform, vert, indx);
+	add_shape(s, applyTransform);
 }
 
-void simple_geometry::apply_transform_and_create_buffers(glm::mat4 & applyTransform, std::vector<glm::vec3>& vert, std::vector<uint32_t>& indx) {
-	if (mFlags != flags::none) throw avk::runtime_error("Unsupported geometry flags");
-	std::vector<glm::vec3> dummyV3;
-	std::vector<glm::vec2> dummyV2;
-	apply_transform_and_create_buffers(applyTransform, vert, indx, dummyV3, dummyV2, dummyV3, dummyV3);
+simple_geometry& simple_geometry::begin_batch()
+{
+	mInBatch = true;
+	mBatch = {};
+	mParts.clear();
+	mTangentTriangles.clear();
+	return *this;
 }
 
-void simple_geometry::apply_transform_and_create_buffers(glm::mat4 &applyTransform, std::vector<glm::vec3> &vert, std::vector<uint32_t> &indx, std::vector<glm::vec3> &norm, std::vector<glm::vec2> &texc) {
-	std::vector<glm::vec3> dummyV3;
-	apply_transform_and_create_buffers(applyTransform, vert, indx, norm, texc, dummyV3, dummyV3);
+void simple_geometry::end_batch()
+{
+	mInBatch = false;
+	create_buffers();
+	mBatch = {};
+	mTangentTriangles.clear();
 }
 
-void simple_geometry::apply_transform_and_create_buffers(glm::mat4 &applyTransform, std::vector<glm::vec3> &vert, std::vector<uint32_t> &indx, std::vector<glm::vec3> &norm, std::vector<glm::vec2> &texc, std::vector<glm::vec3> &aTangents, std::vector<glm::vec3> &aBitangents)
+void simple_geometry::add_shape(shape_data &shape, const glm::mat4 &applyTransform)
 {
-	bool bNormals   = (mFlags & flags::normals)   != flags::none;
-	bool bTexCoords = (mFlags & flags::texCoords) != flags::none;
-	bool bTangents  = (mFlags & flags::tangents)  != flags::none;
+	if (!mInBatch) {
+		begin_batch();
+		add_shape(shape, applyTransform);
+		end_batch();
+		return;
+	}
 
 	// apply transform
-	for (auto &v : vert) v = glm::vec3(applyTransform * glm::vec4(v, 1));
-	if (bNormals) {
-		glm::mat3 invTransp = glm::inverse(glm::transpose(glm::mat3(applyTransform)));
-		for (auto &n : norm) n = invTransp * n;
+	const glm::mat3 invTransp = glm::inverse(glm::transpose(glm::mat3(applyTransform)));
+	for (auto &v : shape.vert) v = glm::vec3(applyTransform * glm::vec4(v, 1));
+	for (auto &n : shape.norm) n = glm::normalize(invTransp * n);
+	if (shape.mExplicitTangents) {
+		for (auto &t : shape.tang) t = glm::mat3(applyTransform) * t;
+		for (auto &b : shape.bita) b = glm::mat3(applyTransform) * b;
+	} else {
+		// generated in end_batch (after transform), from all triangles of the batch at once
+		shape.tang.assign(shape.vert.size(), glm::vec3(0));
+		shape.bita.assign(shape.vert.size(), glm::vec3(0));
 	}
 
-	// create tangents (after transform)
-	std::vector<glm::vec3> tang, bita;
-	if (bTangents) {
-		if (aTangents.size() == vert.size() && aBitangents.size() == vert.size()) {
-			tang = std::move(aTangents);
-			bita = std::move(aBitangents);
-		} else {
-			auto [t, b] = create_tangents_and_bitangents(vert, indx, norm, texc);
-			tang = std::move(t);
-			bita = std::move(b);
-		}
+	const auto vertexOffset = static_cast<uint32_t>(mBatch.vert.size());
+	mParts.push_back(part{ static_cast<uint32_t>(mBatch.indx.size()), static_cast<uint32_t>(shape.indx.size()), static_cast<int32_t>(vertexOffset) });
+	if (shape.mTriangles && !shape.mExplicitTangents) {
+		for (auto i : shape.indx) mTangentTriangles.push_back(vertexOffset + i);
 	}
 
+	mBatch.vert.insert(mBatch.vert.end(), shape.vert.begin(), shape.vert.end());
+	mBatch.norm.insert(mBatch.norm.end(), shape.norm.begin(), shape.norm.end());
+	mBatch.texc.insert(mBatch.texc.end(), shape.texc.begin(), shape.texc.end());
+	mBatch.tang.insert(mBatch.tang.end(), shape.tang.begin(), shape.tang.end());
+	mBatch.bita.insert(mBatch.bita.end(), shape.bita.begin(), shape.bita.end());
+	mBatch.indx.insert(mBatch.indx.end(), shape.indx.begin(), shape.indx.end()); // relative to the part's vertex offset
+}
+
+void simple_geometry::create_buffers()
+{
+	auto &b = mBatch;
+	if (b.vert.empty() || b.indx.empty()) throw avk::runtime_error("simple_geometry: no shapes to create buffers for");
+
+	bool bNormals   = (mFlags & flags::normals)   != flags::none;
+	bool bTexCoords = (mFlags & flags::texCoords) != flags::none;
+	bool bTangents  = (mFlags & flags::tangents)  != flags::none;
+
+	if (bTangents && !mTangentTriangles.empty()) {
+		create_tangents_and_bitangents(b.vert, mTangentTriangles, b.texc, b.tang, b.bita);
+	}
 
 	avk::memory_usage memUsg = avk::memory_usage::device;
-	mPositionsBuffer      = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(vert).describe_only_member(vert[0], avk::content_description::position));
-	mIndexBuffer          = avk::context().create_buffer(memUsg, {}, avk::index_buffer_meta ::create_from_data(indx).describe_only_member(indx[0], avk::content_description::index));
+	mPositionsBuffer      = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(b.vert).describe_only_member(b.vert[0], avk::content_description::position));
+	mIndexBuffer          = avk::context().create_buffer(memUsg, {}, avk::index_buffer_meta ::create_from_data(b.indx).describe_only_member(b.indx[0], avk::content_description::index));
 	if (bNormals) {
-		mNormalsBuffer    = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(norm).describe_only_member(norm[0], avk::content_description::normal));
+		mNormalsBuffer    = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(b.norm).describe_only_member(b.norm[0], avk::content_description::normal));
 	}
 	if (bTexCoords) {
-		mTexCoordsBuffer  = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(texc).describe_only_member(texc[0], avk::content_description::texture_coordinate));
+		mTexCoordsBuffer  = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(b.texc).describe_only_member(b.texc[0], avk::content_description::texture_coordinate));
 	}
 	if (bTangents) {
-		mTangentsBuffer   = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(tang).describe_only_member(tang[0], avk::content_description::tangent));
-		mBitangentsBuffer = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(bita).describe_only_member(bita[0], avk::content_description::bitangent));
+		mTangentsBuffer   = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(b.tang).describe_only_member(b.tang[0], avk::content_description::tangent));
+		mBitangentsBuffer = avk::context().create_buffer(memUsg, {}, avk::vertex_buffer_meta::create_from_data(b.bita).describe_only_member(b.bita[0], avk::content_description::bitangent));
 	}
 
-
-	// TODO: Do we not have an mQueue here? Add one?!
-
-	//auto fence = avk::context().record_and_submit_with_fence_old_sync_replacement({
-	//		mPositionsBuffer->fill(vert.data(), 0),
-	//		mIndexBuffer->fill(indx.data(), 0)
-	//	});
-	//fence->wait_until_signalled();
-
-	// TODO: how can we do something like: "if (bNormals) mNormalsBuffer->fill()" in recording? -> is the solution below ok? - ask JU!
-
+	// all buffers of all shapes of the batch are uploaded with one single submission
 	std::vector<avk::recorded_commands_t> recordedCmds;
 	recordedCmds = {
-		mPositionsBuffer->fill(vert.data(), 0),
-		mIndexBuffer->fill(indx.data(), 0)
+		mPositionsBuffer->fill(b.vert.data(), 0),
+		mIndexBuffer->fill(b.indx.data(), 0)
 	};
-	if (bNormals)   recordedCmds.push_back(mNormalsBuffer   ->fill(norm.data(), 0));
-	if (bTexCoords) recordedCmds.push_back(mTexCoordsBuffer ->fill(texc.data(), 0));
-	if (bTangents)  recordedCmds.push_back(mTangentsBuffer  ->fill(tang.data(), 0));
-	if (bTangents)  recordedCmds.push_back(mBitangentsBuffer->fill(bita.data(), 0));
+	if (bNormals)   recordedCmds.push_back(mNormalsBuffer   ->fill(b.norm.data(), 0));
+	if (bTexCoords) recordedCmds.push_back(mTexCoordsBuffer ->fill(b.texc.data(), 0));
+	if (bTangents)  recordedCmds.push_back(mTangentsBuffer  ->fill(b.tang.data(), 0));
+	if (bTangents)  recordedCmds.push_back(mBitangentsBuffer->fill(b.bita.data(), 0));
 	auto fence = avk::context().record_and_submit_with_fence(recordedCmds, *mQueue);
 	fence->wait_until_signalled();
 }
 
-std::tuple<std::vector<glm::vec3>, std::vector<glm::vec3>> simple_geometry::create_tangents_and_bitangents(const std::vector<glm::vec3>& vert, const std::vector<uint32_t>& indx, const std::vector<glm::vec3>& norm, const std::vector<glm::vec2>& texc)
+void simple_geometry::create_tangents_and_bitangents(const std::vector<glm::vec3>& vert, const std::vector<uint32_t>& triangles, const std::vector<glm::vec2>& texc, std::vector<glm::vec3>& tang, std::vector<glm::vec3>& bita)
 {
 	// loosely based on: http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-13-normal-mapping/#computing-the-tangents-and-bitangents
 	// and on own code from CGUE :)
 
-	if (indx.size() % 3 != 0) throw avk::runtime_error("simple_geometry::create_tangents_and_bitangents: not a triangle mesh?");
+	if (triangles.size() % 3 != 0) throw avk::runtime_error("simple_geometry::create_tangents_and_bitangents: not a triangle mesh?");
+
+	// parallel reduction: every thread sums up the tangents/bitangents of its range of faces per vertex, then the sums of all threads are added up per vertex
+	const size_t numv = vert.size();
+	const size_t numFaces = triangles.size() / 3;
+	const size_t numThreads = std::clamp<size_t>(numFaces / sMinFacesPerTangentThread, 1, std::max(1u, std::thread::hardware_concurrency()));
 
-	size_t numv = vert.size();
-	std::vector<glm::vec3> t(numv, glm::vec3(0));
-	std::vector<glm::vec3> b(numv, glm::vec3(0));
-	std::vector<int> hitCount(numv, 0);
+	struct sums {
+		std::vector<glm::vec3> t, b;
+		std::vector<int> hitCount;
+	};
+	std::vector<sums> partialSums(numThreads);
 
 	// process each face
-	size_t numFaces = indx.size() / 3;
-	for (size_t face = 0; face < numFaces; ++face) {
-		auto &i0 = indx[3 * face + 0];
-		auto &i1 = indx[3 * face + 1];
-		auto &i2 = indx[3 * face + 2];
-
-		auto &v0 = vert[i0];
-		auto &v1 = vert[i1];
-		auto &v2 = vert[i2];
-
-		auto &uv0 = texc[i0];
-		auto &uv1 = texc[i1];
-		auto &uv2 = texc[i2];
-
-		glm::vec3 dPos1 = v1 - v0;
-		glm::vec3 dPos2 = v2 - v0;
-		glm::vec2 dUV1  = uv1 - uv0;
-		glm::vec2 dUV2  = uv2 - uv0;
-
-		float r = 1.0f / (dUV1.x * dUV2.y - dUV1.y * dUV2.x);
-		glm::vec3 tangent   = (dPos1 * dUV2.y - dPos2 * dUV1.y) * r;
-		glm::vec3 bitangent = (dPos2 * dUV1.x - dPos1 * dUV2.x) * r;
-
-		// add upp all tangents/bitangents per vertex
-		t[i0] += tangent; b[i0] += bitangent; hitCount[i0]++;
-		t[i1] += tangent; b[i1] += bitangent; hitCount[i1]++;
-		t[i2] += tangent; b[i2] += bitangent; hitCount[i2]++;
-	}
+	auto accumulate = [&](size_t thread) {
+		auto &s = partialSums[thread];
+		s.t.assign(numv, glm::vec3(0));
+		s.b.assign(numv, glm::vec3(0));
+		s.hitCount.assign(numv, 0);
+		const size_t faceBegin = numFaces * thread / numThreads;
+		const size_t faceEnd   = numFaces * (thread + 1) / numThreads;
+		for (size_t face = faceBegin; face < faceEnd; ++face) {
+			auto &i0 = triangles[3 * face + 0];
+			auto &i1 = triangles[3 * face + 1];
+			auto &i2 = triangles[3 * face + 2];
+
+			glm::vec3 dPos1 = vert[i1] - vert[i0];
+			glm::vec3 dPos2 = vert[i2] - vert[i0];
+			glm::vec2 dUV1  = texc[i1] - texc[i0];
+			glm::vec2 dUV2  = texc[i2] - texc[i0];
+
+			float r = 1.0f / (dUV1.x * dUV2.y - dUV1.y * dUV2.x);
+			glm::vec3 tangent   = (dPos1 * dUV2.y - dPos2 * dUV1.y) * r;
+			glm::vec3 bitangent = (dPos2 * dUV1.x - dPos1 * dUV2.x) * r;
+
+			// add upp all tangents/bitangents per vertex
+			s.t[i0] += tangent; s.b[i0] += bitangent; s.hitCount[i0]++;
+			s.t[i1] += tangent; s.b[i1] += bitangent; s.hitCount[i1]++;
+			s.t[i2] += tangent; s.b[i2] += bitangent; s.hitCount[i2]++;
+		}
+	};
 
-	// average tangents/bitangents per vertex
-	for (size_t i = 0; i < numv; ++i) {
-		int hits = hitCount[i];
-		if (hits) {
-			t[i] /= static_cast<float>(hits);
-			b[i] /= static_cast<float>(hits);
+	// average tangents/bitangents per vertex (only of the vertices of the given triangles, the others keep theirs)
+	auto average = [&](size_t thread) {
+		const size_t vertBegin = numv * thread / numThreads;
+		const size_t vertEnd   = numv * (thread + 1) / numThreads;
+		for (size_t i = vertBegin; i < vertEnd; ++i) {
+			glm::vec3 t(0), b(0);
+			int hits = 0;
+			for (const auto &s : partialSums) {
+				t += s.t[i]; b += s.b[i]; hits += s.hitCount[i];
+			}
+			if (hits) {
+				tang[i] = t / static_cast<float>(hits);
+				bita[i] = b / static_cast<float>(hits);
+			}
 		}
-	}
+	};
 
-	return std::make_tuple(std::move(t), std::move(b));
+	if (1 == numThreads) {
+		accumulate(0);
+		average(0);
+		return;
+	}
+	thread_pool workers(static_cast<uint32_t>(numThreads));
+	workers.parallel_for(numThreads, accumulate);
+	workers.parallel_for(numThreads, average);
 }
 
 
@@ -15,10 +15,17 @@ public:
 		all = normals | texCoords | tangents
 	};
 
-	// TODO: support normals, uv ?
+	// a part of the buffers, i.e., one created shape: draw it with drawIndexed(mIndexCount, ..., mFirstIndex, mVertexOffset, ...)
+	struct part {
+		uint32_t mFirstIndex;
+		uint32_t mIndexCount;
+		int32_t  mVertexOffset;
+	};
 
+	// all shapes are created with normals, texture coordinates and tangents; the flags select which of them get buffers
 	// spheres, cubes are created with radius (halfsize) == 1.0
 	// cones are created with height and radius == 1.0, apex at the origin, base at y = +1.0
+	// outside of a batch, every create_* call replaces the buffers with the buffers of its shape only
 
 	void create_cone(int subdivision = 20, bool closedBase = true, glm::mat4 applyTransform = glm::mat4(1));
 	void create_sphere(int subdivisionVertical = 10, int subdivisionCircumference = 20, glm::mat4 applyTransform = glm::mat4(1));
@@ -31,6 +38,14 @@ public:
 		return *this;
 	}
 
+	// batches: the shapes of all create_* calls between begin_batch() and end_batch() are put into one shared set of buffers,
+	// which end_batch() creates and uploads with one single submission (tangents are generated on worker threads for large batches)
+	simple_geometry& begin_batch();
+	void end_batch();
+
+	// the shapes in the buffers, in the order of their create_* calls
+	const std::vector<part>& parts() const { return mParts; }
+
 	avk::buffer mPositionsBuffer;
 	avk::buffer mIndexBuffer;
 	avk::buffer mTexCoordsBuffer;
@@ -39,12 +54,29 @@ public:
 	avk::buffer mBitangentsBuffer;
 
 private:
+	// the vertex data of one or more shapes; tangents and bitangents are generated in end_batch() unless mExplicitTangents
+	struct shape_data {
+		std::vector<glm::vec3> vert, norm, tang, bita;
+		std::vector<glm::vec2> texc;
+		std::vector<uint32_t>  indx;
+		bool mTriangles = true;          // false for line lists
+		bool mExplicitTangents = false;
+	};
+
+	// faces from which tangents are generated on multiple threads, at least per thread
+	static constexpr size_t sMinFacesPerTangentThread = 16384;
+
 	avk::queue* mQueue;
 	flags mFlags = flags::none;
-	void apply_transform_and_create_buffers(glm::mat4 &applyTransform, std::vector<glm::vec3> &vert, std::vector<uint32_t> &indx);
-	void apply_transform_and_create_buffers(glm::mat4 &applyTransform, std::vector<glm::vec3> &vert, std::vector<uint32_t> &indx, std::vector<glm::vec3> &norm, std::vector<glm::vec2> &texc);
-	void apply_transform_and_create_buffers(glm::mat4 &applyTransform, std::vector<glm::vec3> &vert, std::vector<uint32_t> &indx, std::vector<glm::vec3> &norm, std::vector<glm::vec2> &texc, std::vector<glm::vec3> &aTangents, std::vector<glm::vec3> &aBitangents);
-	std::tuple<std::vector<glm::vec3>,std::vector<glm::vec3>> create_tangents_and_bitangents(const std::vector<glm::vec3> &vert, const std::vector<uint32_t> &indx, const std::vector<glm::vec3> &norm, const std::vector<glm::vec2> &texc);
+	bool mInBatch = false;
+	shape_data mBatch;
+	std::vector<part> mParts;
+	// the triangles (with indices into mBatch's vertices) whose vertices get generated tangents
+	std::vector<uint32_t> mTangentTriangles;
+
+	void add_shape(shape_data &shape, const glm::mat4 &applyTransform);
+	void create_buffers();
+	static void create_tangents_and_bitangents(const std::vector<glm::vec3> &vert, const std::vector<uint32_t> &triangles, const std::vector<glm::vec2> &texc, std::vector<glm::vec3> &tang, std::vector<glm::vec3> &bita);
 };
 
 
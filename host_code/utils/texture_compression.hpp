@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+/** CPU block compression of RGBA8 images into BC4 (one channel), BC5 (two channels), and BC7 (RGBA, mode 6 only),
+ *	mip chain generation, and writing the results as DDS files (with DX10 header), which can be loaded with all their mips.
+ *	The encoders aim for fast first-run transcoding with reasonable quality, not for the best possible quality.
+ */
+class texture_compression
+{
+public:
+	/** Increment whenever the encoders' output changes, s.t. previously written DDS files are not reused */
+	static constexpr uint32_t sEncoderVersion = 1u;
+
+	enum struct format
+	{
+		bc4,       // R of the input
+		bc5,       // RG of the input
+		bc7,       // RGBA of the input, linear
+		bc7_srgb   // RGBA of the input, sRGB-encoded RGB
+	};
+
+	/** One mip level of an RGBA8 image, tightly packed rows */
+	struct rgba_image
+	{
+		uint32_t mWidth = 0;
+		uint32_t mHeight = 0;
+		std::vector<uint8_t> mPixels;
+
+		const uint8_t* pixel(uint32_t x, uint32_t y) const
+		{
+			return &mPixels[4 * (static_cast<size_t>(std::min(y, mHeight - 1)) * mWidth + std::min(x, mWidth - 1))];
+		}
+	};
+
+	/** Create all mip levels down to 1x1 from the given level 0 with a 2x2 box filter (in linear space for sRGB-encoded RGB) */
+	static std::vector<rgba_image> generate_mip_chain(rgba_image aLevel0, bool aSrgb)
+	{
+		std::vector<rgba_image> levels;
+		levels.push_back(std::move(aLevel0));
+		while (levels.back().mWidth > 1 || levels.back().mHeight > 1) {
+			const auto& src = levels.back();
+			rgba_image dst;
+			dst.mWidth = std::max(1u, src.mWidth / 2);
+			dst.mHeight = std::max(1u, src.mHeight / 2);
+			dst.mPixels.resize(4 * static_cast<size_t>(dst.mWidth) * dst.mHeight);
+			for (uint32_t y = 0; y < dst.mHeight; ++y) {
+				for (uint32_t x = 0; x < dst.mWidth; ++x) {
+					const uint8_t* p[4] = { src.pixel(2 * x, 2 * y), src.pixel(2 * x + 1, 2 * y), src.pixel(2 * x, 2 * y + 1), src.pixel(2 * x + 1, 2 * y + 1) };
+					auto* out = &dst.mPixels[4 * (static_cast<size_t>(y) * dst.mWidth + x)];
+					for (int c = 0; c < 4; ++c) {
+						const bool linearize = aSrgb && c < 3;
+						float sum = 0.0f;
+						for (const auto* px : p) {
+							sum += linearize ? srgb_to_linear(px[c]) : static_cast<float>(px[c]) / 255.0f;
+						}
+						const float avg = sum * 0.25f;
+						out[c] = static_cast<uint8_t>(std::lround(std::clamp(linearize ? linear_to_srgb(avg) : avg, 0.0f, 1.0f) * 255.0f));
+					}
+				}
+			}
+			levels.push_back(std::move(dst));
+		}
+		return levels;
+	}
+
+	/** Compress one mip level into 4x4 blocks (8 bytes per block for BC4, 16 bytes otherwise). Partial blocks at the borders replicate the last row/column. */
+	static std::vector<uint8_t> compress(const rgba_image& aImage, format aFormat)
+	{
+		const uint32_t blocksX = (aImage.mWidth + 3) / 4;
+		const uint32_t blocksY = (aImage.mHeight + 3) / 4;
+		const size_t blockSize = format::bc4 == aFormat ? 8 : 16;
+		std::vector<uint8_t> result(blockSize * blocksX * blocksY);
+		std::array<uint8_t, 64> block;
+		for (uint32_t by = 0; by < blocksY; ++by) {
+			for (uint32_t bx = 0; bx < blocksX; ++bx) {
+				for (uint32_t i = 0; i < 16; ++i) {
+					const auto* px = aImage.pixel(4 * bx + i % 4, 4 * by + i / 4);
+					std::copy_n(px, 4, &block[4 * i]);
+				}
+				auto* out = &result[blockSize * (static_cast<size_t>(by) * blocksX + bx)];
+				switch (aFormat) {
+				case format::bc4:
+					encode_bc4_block(block.data(), 0, out);
+					break;
+				case format::bc5:
+					encode_bc4_block(block.data(), 0, out);
+					encode_bc4_block(block.data(), 1, out + 8);
+					break;
+				default:
+					encode_bc7_mode6_block(block.data(), out);
+					break;
+				}
+			}
+		}
+		return result;
+	}
+
+	/** Write the compressed mip levels (as returned by compress) into a DDS file */
+	static bool write_dds(const std::string& aFilePath, format aFormat, uint32_t aWidth, uint32_t aHeight, const std::vector<std::vector<uint8_t>>& aCompressedLevels)
+	{
+		std::ofstream file(aFilePath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+		std::array<uint32_t, 31> header{}; // DDS_HEADER (124 bytes) without the magic number
+		header[0] = 124;                                         // dwSize
+		header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+		header[2] = aHeight;
+		header[3] = aWidth;
+		header[4] = static_cast<uint32_t>(aCompressedLevels.front().size());
+		header[6] = static_cast<uint32_t>(aCompressedLevels.size());
+		header[18] = 32;                                         // ddspf.dwSize
+		header[19] = 0x4;                                        // ddspf.dwFlags = DDPF_FOURCC
+		header[20] = 0x30315844;                                 // ddspf.dwFourCC = "DX10"
+		header[26] = 0x1000 | 0x8 | 0x400000;                    // dwCaps = TEXTURE | COMPLEX | MIPMAP
+		const std::array<uint32_t, 5> dx10Header = {
+			dxgi_format(aFormat),
+			3,                                                   // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+			0, 1, 0                                              // miscFlag, arraySize, miscFlags2
+		};
+		file.write("DDS ", 4);
+		file.write(reinterpret_cast<const char*>(header.data()), sizeof(header));
+		file.write(reinterpret_cast<const char*>(dx10Header.data()), sizeof(dx10Header));
+		for (const auto& level : aCompressedLevels) {
+			file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+		}
+		return static_cast<bool>(file);
+	}
+
+private:
+	static uint32_t dxgi_format(format aFormat)
+	{
+		switch (aFormat) {
+		case format::bc4:  return 80; // DXGI_FORMAT_BC4_UNORM
+		case format::bc5:  return 83; // DXGI_FORMAT_BC5_UNORM
+		case format::bc7:  return 98; // DXGI_FORMAT_BC7_UNORM
+		default:           return 99; // DXGI_FORMAT_BC7_UNORM_SRGB
+		}
+	}
+
+	static float srgb_to_linear(uint8_t aValue)
+	{
+		const float c = static_cast<float>(aValue) / 255.0f;
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float linear_to_srgb(float aValue)
+	{
+		return aValue <= 0.0031308f ? aValue * 12.92f : 1.055f * std::pow(aValue, 1.0f / 2.4f) - 0.055f;
+	}
+
+	/** Writes the bits of a block, least significant bit first */
+	struct bit_writer
+	{
+		uint8_t* mOut;
+		uint32_t mPosition = 0;
+
+		void put(uint32_t aValue, uint32_t aNumBits)
+		{
+			for (uint32_t i = 0; i < aNumBits; ++i, ++mPosition) {
+				if (0 != ((aValue >> i) & 1u)) {
+					mOut[mPosition / 8] |= static_cast<uint8_t>(1u << (mPosition % 8));
+				}
+			}
+		}
+	};
+
+	/** Encode channel aChannel of 16 RGBA8 pixels into an 8-byte BC4 block, using the 8-value mode with min/max endpoints */
+	static void encode_bc4_block(const uint8_t* aRgba, int aChannel, uint8_t* aOut)
+	{
+		uint8_t lo = 255, hi = 0;
+		for (int i = 0; i < 16; ++i) {
+			lo = std::min(lo, aRgba[4 * i + aChannel]);
+			hi = std::max(hi, aRgba[4 * i + aChannel]);
+		}
+		std::fill_n(aOut, 8, uint8_t{ 0 });
+		aOut[0] = hi;
+		aOut[1] = lo;
+		if (hi == lo) {
+			return; // All indices 0 => all values hi
+		}
+		// Palette of the 8-value mode (hi > lo): index 0 = hi, 1 = lo, 2..7 = interpolated from hi to lo
+		std::array<int, 8> palette = { hi, lo };
+		for (int i = 2; i < 8; ++i) {
+			palette[i] = ((8 - i) * hi + (i - 1) * lo) / 7;
+		}
+		bit_writer bits{ aOut + 2 };
+		for (int i = 0; i < 16; ++i) {
+			const int v = aRgba[4 * i + aChannel];
+			uint32_t best = 0;
+			for (uint32_t j = 1; j < 8; ++j) {
+				if (std::abs(palette[j] - v) < std::abs(palette[best] - v)) {
+					best = j;
+				}
+			}
+			bits.put(best, 3);
+		}
+	}
+
+	/** Encode 16 RGBA8 pixels into a 16-byte BC7 mode 6 block: one subset, RGBA endpoints with 7 bits + one p-bit each, 4-bit indices */
+	static void encode_bc7_mode6_block(const uint8_t* aRgba, uint8_t* aOut)
+	{
+		static constexpr std::array<int, 16> sWeights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// Endpoints from the bounding box of the block's colors:
+		std::array<int, 4> lo = { 255, 255, 255, 255 }, hi = { 0, 0, 0, 0 };
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 4; ++c) {
+				lo[c] = std::min<int>(lo[c], aRgba[4 * i + c]);
+				hi[c] = std::max<int>(hi[c], aRgba[4 * i + c]);
+			}
+		}
+
+		// Quantize each endpoint to 7 bits per channel plus a shared p-bit, choosing the p-bit with the smaller error:
+		const auto quantize = [](const std::array<int, 4>& aEndpoint, std::array<int, 4>& aQuantized, int& aPBit) {
+			int bestError = std::numeric_limits<int>::max();
+			for (int p = 0; p < 2; ++p) {
+				std::array<int, 4> q;
+				int error = 0;
+				for (int c = 0; c < 4; ++c) {
+					q[c] = std::clamp((aEndpoint[c] - p + 1) / 2, 0, 127);
+					const int d = ((q[c] << 1) | p) - aEndpoint[c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError = error;
+					aQuantized = q;
+					aPBit = p;
+				}
+			}
+		};
+		std::array<int, 4> q0, q1;
+		int p0 = 0, p1 = 0;
+		quantize(lo, q0, p0);
+		quantize(hi, q1, p1);
+
+		std::array<std::array<int, 4>, 16> palette;
+		for (int w = 0; w < 16; ++w) {
+			for (int c = 0; c < 4; ++c) {
+				const int e0 = (q0[c] << 1) | p0;
+				const int e1 = (q1[c] << 1) | p1;
+				palette[w][c] = ((64 - sWeights[w]) * e0 + sWeights[w] * e1 + 32) >> 6;
+			}
+		}
+		std::array<uint32_t, 16> indices;
+		for (int i = 0; i < 16; ++i) {
+			int bestError = std::numeric_limits<int>::max();
+			for (uint32_t w = 0; w < 16; ++w) {
+				int error = 0;
+				for (int c = 0; c < 4; ++c) {
+					const int d = palette[w][c] - aRgba[4 * i + c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError = error;
+					indices[i] = w;
+				}
+			}
+		}
+
+		// The most significant bit of the first pixel's index is implicitly 0 => swap the endpoints if required:
+		if (indices[0] >= 8) {
+			std::swap(q0, q1);
+			std::swap(p0, p1);
+			for (auto& idx : indices) {
+				idx = 15 - idx;
+			}
+		}
+
+		std::fill_n(aOut, 16, uint8_t{ 0 });
+		bit_writer bits{ aOut };
+		bits.put(1u << 6, 7); // Mode 6
+		for (int c = 0; c < 4; ++c) {
+			bits.put(static_cast<uint32_t>(q0[c]), 7);
+			bits.put(static_cast<uint32_t>(q1[c]), 7);
+		}
+		bits.put(static_cast<uint32_t>(p0), 1);
+		bits.put(static_cast<uint32_t>(p1), 1);
+		bits.put(indices[0], 3);
+		for (int i = 1; i < 16; ++i) {
+			bits.put(indices[i], 4);
+		}
+	}
+};
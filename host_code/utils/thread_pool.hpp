@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+/** A fixed number of worker threads which execute the tasks submitted to them in submission order.
+ *	The workers are joined on destruction, after all tasks which have been submitted until then have been completed.
+ */
+class thread_pool
+{
+public:
+	/** @param	aNumThreads		Number of worker threads, 0 means one less than the hardware concurrency (but at least one) */
+	explicit thread_pool(uint32_t aNumThreads = 0)
+	{
+		if (0 == aNumThreads) {
+			aNumThreads = std::max(2u, std::thread::hardware_concurrency()) - 1u; // hardware_concurrency() may be 0, i.e., unknown
+		}
+		for (uint32_t i = 0; i < aNumThreads; ++i) {
+			mWorkers.emplace_back([this] { work(); });
+		}
+	}
+
+	~thread_pool()
+	{
+		{
+			std::scoped_lock lock(mMutex);
+			mStopping = true;
+		}
+		mCondition.notify_all();
+		for (auto& worker : mWorkers) {
+			worker.join();
+		}
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	uint32_t size() const
+	{
+		return static_cast<uint32_t>(mWorkers.size());
+	}
+
+	/** Submit a task, its result (or exception) can be retrieved from the returned future */
+	template <typename F>
+	auto submit(F&& aTask) -> std::future<std::invoke_result_t<F>>
+	{
+		// std::function requires copyable callables, hence the shared_ptr:
+		auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(aTask));
+		auto future = task->get_future();
+		{
+			std::scoped_lock lock(mMutex);
+			mTasks.emplace([task] { (*task)(); });
+		}
+		mCondition.notify_one();
+		return future;
+	}
+
+	/** Invoke aBody(i) for all i in [0, aCount) on the workers, and wait until all invocations have completed.
+	 *	The first exception thrown by any invocation is rethrown.
+	 */
+	template <typename F>
+	void parallel_for(size_t aCount, F&& aBody)
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(aCount);
+		for (size_t i = 0; i < aCount; ++i) {
+			futures.push_back(submit([&aBody, i] { aBody(i); }));
+		}
+		for (auto& f : futures) {
+			f.wait();
+		}
+		for (auto& f : futures) {
+			f.get();
+		}
+	}
+
+private:
+	void work()
+	{
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock(mMutex);
+				mCondition.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+				if (mTasks.empty()) {
+					return; // Stopping, and nothing left to do
+				}
+				task = std::move(mTasks.front());
+				mTasks.pop();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> mWorkers;
+	std::queue<std::function<void()>> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStopping = false;
+};
@@ -23,23 +23,22 @@ layout(set = 0, binding = 1) uniform sampler2D textures[];
 // -------------------------------------------------------
 
 // ###### PIPELINE INPUT DATA ############################
-// Unique push constants per draw call (You can think of
-// these like single uniforms in OpenGL):
-layout(push_constant) uniform PushConstantsBlock { PushConstants pushConstants; };
-
 // Uniform buffer "uboMatricesAndUserInput", containing camera matrices and user input
 layout (set = 1, binding = 0) uniform UniformBlock { matrices_and_user_input uboMatricesAndUserInput; };
 
-// "mLightsources" uniform buffer containing all the light source data:
-layout(set = 1, binding = 1) uniform LightsourceData
+// Storage buffer containing all the light source data (positions and directions in world space):
+layout(set = 1, binding = 1) readonly buffer LightsourceData
 {
 	// x,y ... ambient light sources start and end indices; z,w ... directional light sources start and end indices
 	uvec4 mRangesAmbientDirectional;
 	// x,y ... point light sources start and end indices; z,w ... spot light sources start and end indices
 	uvec4 mRangesPointSpot;
 	// Contains all the data of all the active light sources
-	LightsourceGpuData mLightData[MAX_NUMBER_OF_LIGHTSOURCES];
-} uboLights;
+	LightsourceGpuData mLightData[];
+} lightsBuffer;
+
+// For every light cluster: the number of lights, followed by MAX_LIGHTS_PER_CLUSTER light indices (see light_clustering.comp)
+layout(set = 1, binding = 2) readonly buffer ClusterLightLists { uint clusterLightLists[]; };
 // -------------------------------------------------------
 
 // ###### FRAG INPUT #####################################
@@ -48,10 +47,17 @@ layout (location = 0) in VertexData
 	vec3 positionVS;  // interpolated vertex position in view-space
 	vec2 texCoords;   // texture coordinates
 	vec3 normalVS;    // interpolated vertex normal in view-space
+	flat int materialIndex; // material index, passed on from the vertex shader (push constants or draw data buffer)
 	// TODO Task 2: Receive whatever data you have passed from previous shader stages!
 } fs_in;
 // -------------------------------------------------------
 
+// ###### SPECIALIZATION CONSTANTS #######################
+// Set per pipeline variant, according to the materials which are drawn with it (see assignment1::create_scene_pipelines):
+// All of the material's textures are sampled with offset 0 and tiling 1, i.e., the offsets and tilings need not be read
+layout (constant_id = 0) const bool DEFAULT_TEXTURE_TILING = false;
+// -------------------------------------------------------
+
 // ###### FRAG OUTPUT ####################################
 layout (location = 0) out vec4 oFragColor;
 // -------------------------------------------------------
@@ -59,38 +65,53 @@ layout (location = 0) out vec4 oFragColor;
 // ###### HELPER FUNCTIONS ###############################
 vec4 sample_from_diffuse_texture()
 {
-	int matIndex = pushConstants.mMaterialIndex;
+	int matIndex = fs_in.materialIndex;
 	int texIndex = materialsBuffer.materials[matIndex].mDiffuseTexIndex;
-	vec4 offsetTiling = materialsBuffer.materials[matIndex].mDiffuseTexOffsetTiling;
-	vec2 texCoords = fs_in.texCoords * offsetTiling.zw + offsetTiling.xy;
-	return texture(textures[texIndex], texCoords);
+	vec2 texCoords = fs_in.texCoords;
+	if (!DEFAULT_TEXTURE_TILING) {
+		vec4 offsetTiling = materialsBuffer.materials[matIndex].mDiffuseTexOffsetTiling;
+		texCoords = texCoords * offsetTiling.zw + offsetTiling.xy;
+	}
+	return texture(textures[nonuniformEXT(texIndex)], texCoords);
 }
 
 vec4 sample_from_specular_texture()
 {
-	int matIndex = pushConstants.mMaterialIndex;
+	int matIndex = fs_in.materialIndex;
 	int texIndex = materialsBuffer.materials[matIndex].mSpecularTexIndex;
-	vec4 offsetTiling = materialsBuffer.materials[matIndex].mSpecularTexOffsetTiling;
-	vec2 texCoords = fs_in.texCoords * offsetTiling.zw + offsetTiling.xy;
-	return texture(textures[texIndex], texCoords);
+	vec2 texCoords = fs_in.texCoords;
+	if (!DEFAULT_TEXTURE_TILING) {
+		vec4 offsetTiling = materialsBuffer.materials[matIndex].mSpecularTexOffsetTiling;
+		texCoords = texCoords * offsetTiling.zw + offsetTiling.xy;
+	}
+	return texture(textures[nonuniformEXT(texIndex)], texCoords);
 }
 
 vec4 sample_from_height_texture()
 {
-	int matIndex = pushConstants.mMaterialIndex;
+	int matIndex = fs_in.materialIndex;
 	int texIndex = materialsBuffer.materials[matIndex].mHeightTexIndex;
-	vec4 offsetTiling = materialsBuffer.materials[matIndex].mHeightTexOffsetTiling;
-	vec2 texCoords = fs_in.texCoords * offsetTiling.zw + offsetTiling.xy;
-	return texture(textures[texIndex], texCoords);
+	vec2 texCoords = fs_in.texCoords;
+	if (!DEFAULT_TEXTURE_TILING) {
+		vec4 offsetTiling = materialsBuffer.materials[matIndex].mHeightTexOffsetTiling;
+		texCoords = texCoords * offsetTiling.zw + offsetTiling.xy;
+	}
+	return texture(textures[nonuniformEXT(texIndex)], texCoords);
 }
 
 vec4 sample_from_normals_texture()
 {
-	int matIndex = pushConstants.mMaterialIndex;
+	int matIndex = fs_in.materialIndex;
 	int texIndex = materialsBuffer.materials[matIndex].mNormalsTexIndex;
-	vec4 offsetTiling = materialsBuffer.materials[matIndex].mNormalsTexOffsetTiling;
-	vec2 texCoords = fs_in.texCoords * offsetTiling.zw + offsetTiling.xy;
-	return texture(textures[texIndex], texCoords);
+	vec2 texCoords = fs_in.texCoords;
+	if (!DEFAULT_TEXTURE_TILING) {
+		vec4 offsetTiling = materialsBuffer.materials[matIndex].mNormalsTexOffsetTiling;
+		texCoords = texCoords * offsetTiling.zw + offsetTiling.xy;
+	}
+	// Normal maps are stored as BC5 (only x and y), reconstruct z and return the normal encoded in [0,1] like an uncompressed map:
+	vec2 xy = texture(textures[nonuniformEXT(texIndex)], texCoords).xy * 2.0 - 1.0;
+	float z = sqrt(clamp(1.0 - dot(xy, xy), 0.0, 1.0));
+	return vec4(vec3(xy, z) * 0.5 + 0.5, 1.0);
 }
 
 // Re-orthogonalizes the first vector w.r.t. the second vector (Gram-Schmidt process)
@@ -124,25 +145,83 @@ vec3 calc_blinn_phong_contribution(vec3 toLight, vec3 toEye, vec3 normal, vec3 d
 	return diffuse + specular;
 }
 
+// Calculates the diffuse and specular illumination contribution of the point or spot light at index i of mLightData.
+// The attenuation is smoothly faded out towards the light's radius (mAttenuation[3]), beyond which it does not contribute.
+vec3 calc_point_or_spot_light_contribution(uint i, vec3 posVS, vec3 toEyeNrmVS, vec3 normalVS, vec3 diff, vec3 spec, float shini)
+{
+	vec3 lightPosVS = (uboMatricesAndUserInput.mViewMatrix * vec4(lightsBuffer.mLightData[i].mPosition.xyz, 1.0)).xyz;
+	vec3 toLightVS = lightPosVS - posVS;
+	float dist2 = dot(toLightVS, toLightVS);
+	float dist = sqrt(dist2);
+	vec3 toLightNrmVS = toLightVS / max(dist, 1e-6);
+
+	vec4 atten = lightsBuffer.mLightData[i].mAttenuation;
+	if (atten[3] <= 0.0) {
+		return vec3(0.0); // Zero radius, e.g., a black light, never contributes
+	}
+	float distOverRadius = dist / atten[3];
+	float window = clamp(1.0 - distOverRadius * distOverRadius * distOverRadius * distOverRadius, 0.0, 1.0);
+	float attenuation = window * window / calc_attenuation(atten, dist, dist2);
+
+	// Spot lights are additionally attenuated by the angle between their direction and the direction towards the fragment:
+	if (i >= lightsBuffer.mRangesPointSpot[2] && i < lightsBuffer.mRangesPointSpot[3]) {
+		vec4 anglesFalloff = lightsBuffer.mLightData[i].mAnglesFalloff;
+		vec3 spotDirVS = mat3(uboMatricesAndUserInput.mViewMatrix) * lightsBuffer.mLightData[i].mDirection.xyz;
+		float cosAngle = dot(-toLightNrmVS, normalize(spotDirVS));
+		float spotFactor = clamp((cosAngle - anglesFalloff[0]) / max(anglesFalloff[1] - anglesFalloff[0], 1e-6), 0.0, 1.0);
+		attenuation *= pow(spotFactor, anglesFalloff[2]);
+	}
+
+	vec3 lightIntensity = lightsBuffer.mLightData[i].mColor.rgb * attenuation;
+	return lightIntensity * calc_blinn_phong_contribution(toLightNrmVS, toEyeNrmVS, normalVS, diff, spec, shini);
+}
+
+// Returns the index of the light cluster which contains the current fragment
+uint calc_cluster_index(vec3 posVS)
+{
+	float near = uboMatricesAndUserInput.mClusteringParams.x;
+	float far  = uboMatricesAndUserInput.mClusteringParams.y;
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / uboMatricesAndUserInput.mClusterTileSize.xy), uvec2(LIGHT_CLUSTERS_X - 1, LIGHT_CLUSTERS_Y - 1));
+	float slice = log(abs(posVS.z) / near) / log(far / near) * float(LIGHT_CLUSTERS_Z);
+	uint z = uint(clamp(slice, 0.0, float(LIGHT_CLUSTERS_Z - 1)));
+	return tile.x + LIGHT_CLUSTERS_X * (tile.y + LIGHT_CLUSTERS_Y * z);
+}
+
 // Calculates the diffuse and specular illumination contribution for all the light sources.
 // All calculations are performed in view space
 vec3 calc_illumination_in_vs(vec3 posVS, vec3 normalVS, vec3 diff, vec3 spec, float shini)
 {
 	vec3 diffAndSpec = vec3(0.0, 0.0, 0.0);
 
-	// Calculate shading in view space since all light parameters are passed to the shader in view space
+	// Calculate shading in view space, the lights' world-space positions and directions are transformed into view space with the view matrix
 	vec3 eyePosVS = vec3(0.0, 0.0, 0.0);
 	vec3 toEyeNrmVS = normalize(eyePosVS - posVS);
 
 	// Directional lights:
-	for (uint i = uboLights.mRangesAmbientDirectional[2]; i < uboLights.mRangesAmbientDirectional[3]; ++i) {
-		vec3 toLightDirVS = normalize(-uboLights.mLightData[i].mDirection.xyz);
-		vec3 dirLightIntensity = uboLights.mLightData[i].mColor.rgb;
+	for (uint i = lightsBuffer.mRangesAmbientDirectional[2]; i < lightsBuffer.mRangesAmbientDirectional[3]; ++i) {
+		vec3 toLightDirVS = normalize(mat3(uboMatricesAndUserInput.mViewMatrix) * -lightsBuffer.mLightData[i].mDirection.xyz);
+		vec3 dirLightIntensity = lightsBuffer.mLightData[i].mColor.rgb;
 		diffAndSpec += dirLightIntensity * calc_blinn_phong_contribution(toLightDirVS, toEyeNrmVS, normalVS, diff, spec, shini);
 	}
 
-	// Point lights:
-	// TODO Task 2: Implement Blinn-Phong illumination for all the point lights contained within uboLights!
+	// Point and spot lights:
+	if (uboMatricesAndUserInput.mClusteringParams.z != 0.0) {
+		// Only those lights which have been assigned to this fragment's cluster:
+		uint listBase = calc_cluster_index(posVS) * LIGHT_CLUSTER_LIST_SIZE;
+		uint count = clusterLightLists[listBase];
+		for (uint j = 0; j < count; ++j) {
+			diffAndSpec += calc_point_or_spot_light_contribution(clusterLightLists[listBase + 1 + j], posVS, toEyeNrmVS, normalVS, diff, spec, shini);
+		}
+	}
+	else {
+		// All of them:
+		for (uint i = lightsBuffer.mRangesPointSpot[0]; i < lightsBuffer.mRangesPointSpot[1]; ++i) {
+			diffAndSpec += calc_point_or_spot_light_contribution(i, posVS, toEyeNrmVS, normalVS, diff, spec, shini);
+		}
+		for (uint i = lightsBuffer.mRangesPointSpot[2]; i < lightsBuffer.mRangesPointSpot[3]; ++i) {
+			diffAndSpec += calc_point_or_spot_light_contribution(i, posVS, toEyeNrmVS, normalVS, diff, spec, shini);
+		}
+	}
 
 	return diffAndSpec;
 }
@@ -159,7 +238,7 @@ void main()
 	// Sample the diffuse color:
 	vec3 diffTexColor = sample_from_diffuse_texture().rgb;
 
-	int matIndex = pushConstants.mMaterialIndex;
+	int matIndex = fs_in.materialIndex;
 
 	// Initialize all the colors:
 	vec3 ambient = materialsBuffer.materials[matIndex].mAmbientReflectivity.rgb * diffTexColor;
@@ -170,8 +249,8 @@ void main()
 
 	// Calculate ambient illumination:
 	vec3 ambientIllumination = vec3(0.0, 0.0, 0.0);
-	for (uint i = uboLights.mRangesAmbientDirectional[0]; i < uboLights.mRangesAmbientDirectional[1]; ++i) {
-		ambientIllumination += uboLights.mLightData[i].mColor.rgb * ambient;
+	for (uint i = lightsBuffer.mRangesAmbientDirectional[0]; i < lightsBuffer.mRangesAmbientDirectional[1]; ++i) {
+		ambientIllumination += lightsBuffer.mLightData[i].mColor.rgb * ambient;
 	}
 
 	// Calculate diffuse and specular illumination from all light sources:
@@ -0,0 +1,39 @@
+#version 460
+#extension GL_GOOGLE_include_directive : enable
+#include "shader_structures.glsl"
+// -------------------------------------------------------
+
+// ###### VERTEX SHADER/PIPELINE INPUT DATA ##############
+// Only the positions are streamed for the depth pre-pass:
+layout (location = 0) in vec3 aPosition;
+
+// Uniform buffer "uboMatricesAndUserInput", containing camera matrices and user input
+layout (set = 1, binding = 0) uniform UniformBlock { matrices_and_user_input uboMatricesAndUserInput; };
+
+// Per-draw data of all the scene's draw calls:
+layout (set = 2, binding = 0) readonly buffer DrawDataBuffer { DrawData drawData[]; } drawDataBuffer;
+
+// Index into drawData of every instance, indexed by gl_InstanceIndex (i.e., offset by the draw's firstInstance):
+layout (set = 2, binding = 1) readonly buffer InstanceDrawIndicesBuffer { uint instanceDrawIndices[]; };
+// -------------------------------------------------------
+
+// Must be computed exactly like in transform_and_pass_on.vert, s.t. the
+// shading pass can test against the depth values of this pass:
+invariant gl_Position;
+
+// ###### VERTEX SHADER MAIN #############################
+void main()
+{
+	uint drawIndex = instanceDrawIndices[gl_InstanceIndex];
+	mat4 mMatrix = drawDataBuffer.drawData[drawIndex].mModelMatrix;
+	mat4 vMatrix = uboMatricesAndUserInput.mViewMatrix;
+	mat4 pMatrix = uboMatricesAndUserInput.mProjMatrix;
+	mat4 vmMatrix = vMatrix * mMatrix;
+
+	vec4 positionOS  = vec4(aPosition, 1.0);
+	vec4 positionVS  = vmMatrix * positionOS;
+	vec4 positionCS  = pMatrix * positionVS;
+
+	gl_Position = positionCS;
+}
+// -------------------------------------------------------
@@ -0,0 +1,43 @@
+#version 460
+#extension GL_GOOGLE_include_directive : enable
+#include "shader_structures.glsl"
+// -------------------------------------------------------
+
+// ###### VERTEX SHADER/PIPELINE INPUT DATA ##############
+// Only the quantized positions of the interleaved vertices
+// (helpers::compact_vertex) are streamed for the depth pre-pass:
+layout (location = 0) in vec4 aPositionAndBitangentSign; // snorm16, relative to the material group's bounding box
+
+// Uniform buffer "uboMatricesAndUserInput", containing camera matrices and user input
+layout (set = 1, binding = 0) uniform UniformBlock { matrices_and_user_input uboMatricesAndUserInput; };
+
+// Per-draw data of all the scene's draw calls, which also contains the dequantization parameters:
+layout (set = 2, binding = 0) readonly buffer DrawDataBuffer { DrawData drawData[]; } drawDataBuffer;
+
+// Index into drawData of every instance, indexed by gl_InstanceIndex (i.e., offset by the draw's firstInstance):
+layout (set = 2, binding = 1) readonly buffer InstanceDrawIndicesBuffer { uint instanceDrawIndices[]; };
+// -------------------------------------------------------
+
+// Must be computed exactly like in transform_and_pass_on_compact.vert, s.t.
+// the shading pass can test against the depth values of this pass:
+invariant gl_Position;
+
+// ###### VERTEX SHADER MAIN #############################
+void main()
+{
+	uint drawIndex = instanceDrawIndices[gl_InstanceIndex];
+	mat4 mMatrix = drawDataBuffer.drawData[drawIndex].mModelMatrix;
+	vec4 posOffset = drawDataBuffer.drawData[drawIndex].mPositionOffset;
+	vec4 posScale  = drawDataBuffer.drawData[drawIndex].mPositionScale;
+
+	mat4 vMatrix = uboMatricesAndUserInput.mViewMatrix;
+	mat4 pMatrix = uboMatricesAndUserInput.mProjMatrix;
+	mat4 vmMatrix = vMatrix * mMatrix;
+
+	vec4 positionOS  = vec4(posOffset.xyz + posScale.xyz * aPositionAndBitangentSign.xyz, 1.0);
+	vec4 positionVS  = vmMatrix * positionOS;
+	vec4 positionCS  = pMatrix * positionVS;
+
+	gl_Position = positionCS;
+}
+// -------------------------------------------------------
@@ -4,7 +4,20 @@
 // If you have an ultra-fast GPU and can not see any artefacts when preparing to tackle Task 3, you can add some extra point lights.
 // For example, if you change the 0 in the line below to 100, you will get 100 extra point lights, making a total of 200 lights.
 
+// (It can also be defined by the build, e.g., for the benchmark executables, see cmake/Assignment1.cmake.)
+
+#ifndef EXTRA_POINTLIGHTS
 #define EXTRA_POINTLIGHTS	0
+#endif
+
+// The light data is stored in a storage buffer, hence, thousands of lights are fine. With clustered light culling,
+// only those lights which affect a fragment's cluster (a cell of a view-frustum-aligned grid) are evaluated for it.
+// Lights in excess of MAX_LIGHTS_PER_CLUSTER are ignored for a cluster => increase it if artefacts become visible.
+
+#define LIGHT_CLUSTERS_X		16
+#define LIGHT_CLUSTERS_Y		9
+#define LIGHT_CLUSTERS_Z		24
+#define MAX_LIGHTS_PER_CLUSTER	128
 
 
 // --- don't touch anything below ---
@@ -15,6 +28,10 @@
 #define MAX_NUMBER_OF_LIGHTSOURCES (100 + EXTRA_POINTLIGHTS)
 #endif
 
+#define NUMBER_OF_LIGHT_CLUSTERS (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z)
+// Every cluster's light list consists of the number of lights, followed by MAX_LIGHTS_PER_CLUSTER light indices
+#define LIGHT_CLUSTER_LIST_SIZE (1 + MAX_LIGHTS_PER_CLUSTER)
+
 #define LIGHTSOURCE_LIMITS_H 1
 #endif
 
@@ -12,11 +12,34 @@ struct matrices_and_user_input {
 	mat4 mCamPos;
 	// x = normal mapping strength, y = displacement strength, z = enable PN-triangles, w unused
 	vec4 mUserInput;
+	// x = near plane distance, y = far plane distance, z = clustered light culling enabled (1.0) or not (0.0), w unused
+	vec4 mClusteringParams;
+	// xy = size of a light cluster's screen tile in pixels, zw unused
+	vec4 mClusterTileSize;
 };
 
-struct PushConstants {
+// Per-draw data, stored in one storage buffer for all the draw calls of the scene.
+// Draws are instanced, it is indexed by instanceDrawIndices[gl_InstanceIndex].
+struct DrawData {
 	mat4 mModelMatrix;
-	int mMaterialIndex;
+	int  mMaterialIndex;
+	// Draw calls which only differ in mModelMatrix form one instance group, i.e., one instanced draw
+	uint mInstanceGroup;
+	// Number of levels of detail of the draw call's geometry
+	uint mLodCount;
+	uint mUnused0;
+	// Dequantization parameters for compact vertices:
+	// position  = mPositionOffset.xyz + mPositionScale.xyz * quantized position
+	// texCoords = mTexCoordsOffsetScale.xy + mTexCoordsOffsetScale.zw * quantized texture coordinates
+	vec4 mPositionOffset;
+	vec4 mPositionScale;
+	vec4 mTexCoordsOffsetScale;
+};
+
+// World-space axis-aligned bounding box of a draw call, used for frustum culling
+struct DrawBounds {
+	vec4 mCenter;     // xyz used
+	vec4 mHalfExtent; // xyz used
 };
 
 // ###### MATERIAL DATA ##################################
@@ -3,7 +3,8 @@
 #include "shader_structures.glsl"
 // -------------------------------------------------------
 
-layout (location = 0) in vec3 aVertexPosition;
+// The sky is one fullscreen triangle at the far plane, there are no vertex attributes:
+// gl_VertexIndex 0, 1, 2 => (-1,-1), (3,-1), (-1,3) in normalized device coordinates, which covers the whole screen.
 
 layout (location = 0) out vec3 vSphereCoords;
 
@@ -12,8 +13,10 @@ layout (set = 0, binding = 0) uniform UniformBlock { matrices_and_user_input ubo
 
 void main()
 {
-	vSphereCoords = aVertexPosition.xyz;
-	vec4 position_cs = uboMatricesAndUserInput.mProjMatrix * uboMatricesAndUserInput.mViewMatrix * uboMatricesAndUserInput.mCamPos * vec4(aVertexPosition, 1.0);
-	gl_Position = position_cs;
+	const vec2 ndc = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2.0 - 1.0;
+	// The direction towards the sky sphere is the view ray through the vertex, rotated into world space (the sky sphere is centered at the camera).
+	// All of the vertices are at the far plane, hence, the unprojected positions can be interpolated linearly:
+	vec4 position_vs = inverse(uboMatricesAndUserInput.mProjMatrix) * vec4(ndc, 1.0, 1.0);
+	vSphereCoords = transpose(mat3(uboMatricesAndUserInput.mViewMatrix)) * (position_vs.xyz / position_vs.w);
+	gl_Position = vec4(ndc, 1.0, 1.0);
 }
-
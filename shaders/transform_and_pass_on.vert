@@ -11,12 +11,14 @@ layout (location = 1) in vec2 aTexCoords;
 layout (location = 2) in vec3 aNormal;
 // TODO Task 1: Declare from which input locations to receive tangent and bitangent data!
 
-// Unique push constants per draw call (You can think of
-// these like single uniforms in OpenGL):
-layout(push_constant) uniform PushConstantsBlock { PushConstants pushConstants; };
-
 // Uniform buffer "uboMatricesAndUserInput", containing camera matrices and user input
 layout (set = 1, binding = 0) uniform UniformBlock { matrices_and_user_input uboMatricesAndUserInput; };
+
+// Per-draw data of all the scene's draw calls:
+layout (set = 2, binding = 0) readonly buffer DrawDataBuffer { DrawData drawData[]; } drawDataBuffer;
+
+// Index into drawData of every instance, indexed by gl_InstanceIndex (i.e., offset by the draw's firstInstance):
+layout (set = 2, binding = 1) readonly buffer InstanceDrawIndicesBuffer { uint instanceDrawIndices[]; };
 // -------------------------------------------------------
 
 // ###### DATA PASSED ON ALONG THE PIPELINE ##############
@@ -25,14 +27,21 @@ layout (location = 0) out VertexData {
 	vec3 positionVS;
 	vec2 texCoords;
 	vec3 normalVS;
+	flat int materialIndex;
 	// TODO Task 2: Pass whatever data makes sense for normal mapping to subsequent shader stages!
 } v_out;
+
+// The depth pre-pass computes the same positions, which must result in bit-identical depth values:
+invariant gl_Position;
 // -------------------------------------------------------
 
 // ###### VERTEX SHADER MAIN #############################
 void main()
 {
-	mat4 mMatrix = pushConstants.mModelMatrix;
+	// Every draw is instanced, the instance's per-draw data is found through the instance draw indices:
+	uint drawIndex = instanceDrawIndices[gl_InstanceIndex];
+	mat4 mMatrix = drawDataBuffer.drawData[drawIndex].mModelMatrix;
+	int matIndex = drawDataBuffer.drawData[drawIndex].mMaterialIndex;
 	mat4 vMatrix = uboMatricesAndUserInput.mViewMatrix;
 	mat4 pMatrix = uboMatricesAndUserInput.mProjMatrix;
 	mat4 vmMatrix = vMatrix * mMatrix;
@@ -47,6 +56,7 @@ void main()
 	v_out.positionVS  = positionVS.xyz;
 	v_out.texCoords   = aTexCoords;
 	v_out.normalVS    = normalVS;
+	v_out.materialIndex = matIndex;
 
 	gl_Position = positionCS;
 }
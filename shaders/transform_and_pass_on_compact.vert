@@ -0,0 +1,83 @@
+#version 460
+#extension GL_GOOGLE_include_directive : enable
+#include "shader_structures.glsl"
+// -------------------------------------------------------
+
+// ###### VERTEX SHADER/PIPELINE INPUT DATA ##############
+// Interleaved, quantized vertex attributes (helpers::compact_vertex),
+// all of them streamed from ONE buffer at binding 0:
+layout (location = 0) in vec4 aPositionAndBitangentSign; // snorm16, relative to the material group's bounding box
+layout (location = 1) in vec2 aTexCoords;                // unorm16, relative to the material group's texture coordinates range
+layout (location = 2) in vec2 aNormalOct;                // snorm16, octahedral-encoded
+layout (location = 3) in vec2 aTangentOct;               // snorm16, octahedral-encoded
+
+// Uniform buffer "uboMatricesAndUserInput", containing camera matrices and user input
+layout (set = 1, binding = 0) uniform UniformBlock { matrices_and_user_input uboMatricesAndUserInput; };
+
+// Per-draw data of all the scene's draw calls, which also contains the dequantization parameters:
+layout (set = 2, binding = 0) readonly buffer DrawDataBuffer { DrawData drawData[]; } drawDataBuffer;
+
+// Index into drawData of every instance, indexed by gl_InstanceIndex (i.e., offset by the draw's firstInstance):
+layout (set = 2, binding = 1) readonly buffer InstanceDrawIndicesBuffer { uint instanceDrawIndices[]; };
+// -------------------------------------------------------
+
+// ###### DATA PASSED ON ALONG THE PIPELINE ##############
+// Data from vert -> tesc or frag:
+layout (location = 0) out VertexData {
+	vec3 positionVS;
+	vec2 texCoords;
+	vec3 normalVS;
+	flat int materialIndex;
+	// TODO Task 2: Pass whatever data makes sense for normal mapping to subsequent shader stages!
+} v_out;
+
+// The depth pre-pass computes the same positions, which must result in bit-identical depth values:
+invariant gl_Position;
+// -------------------------------------------------------
+
+// Inverse of helpers::octahedral_encode
+vec3 oct_decode(vec2 e)
+{
+	vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0) {
+		vec2 signNotZero = vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+		v.xy = (1.0 - abs(v.yx)) * signNotZero;
+	}
+	return normalize(v);
+}
+
+// ###### VERTEX SHADER MAIN #############################
+void main()
+{
+	// Every draw is instanced, the instance's per-draw data (including the dequantization parameters)
+	// is found through the instance draw indices:
+	uint drawIndex = instanceDrawIndices[gl_InstanceIndex];
+	mat4 mMatrix = drawDataBuffer.drawData[drawIndex].mModelMatrix;
+	int matIndex = drawDataBuffer.drawData[drawIndex].mMaterialIndex;
+	vec4 posOffset        = drawDataBuffer.drawData[drawIndex].mPositionOffset;
+	vec4 posScale         = drawDataBuffer.drawData[drawIndex].mPositionScale;
+	vec4 texCoordsOffScal = drawDataBuffer.drawData[drawIndex].mTexCoordsOffsetScale;
+
+	mat4 vMatrix = uboMatricesAndUserInput.mViewMatrix;
+	mat4 pMatrix = uboMatricesAndUserInput.mProjMatrix;
+	mat4 vmMatrix = vMatrix * mMatrix;
+
+	vec4 positionOS  = vec4(posOffset.xyz + posScale.xyz * aPositionAndBitangentSign.xyz, 1.0);
+	vec2 texCoords   = texCoordsOffScal.xy + texCoordsOffScal.zw * aTexCoords;
+	vec3 normalOS    = oct_decode(aNormalOct);
+	vec3 tangentOS   = oct_decode(aTangentOct);
+	vec3 bitangentOS = cross(normalOS, tangentOS) * aPositionAndBitangentSign.w;
+	// TODO Task 2: Use tangentOS and bitangentOS for normal mapping!
+
+	vec4 positionVS  = vmMatrix * positionOS;
+	vec4 positionCS  = pMatrix * positionVS;
+	vec3 normalVS    = normalize(mat3(inverse(transpose(vmMatrix))) * normalOS);
+
+	v_out.positionVS  = positionVS.xyz;
+	v_out.texCoords   = texCoords;
+	v_out.normalVS    = normalVS;
+	v_out.materialIndex = matIndex;
+
+	gl_Position = positionCS;
+}
+// -------------------------------------------------------
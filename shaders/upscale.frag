@@ -0,0 +1,46 @@
+#version 460
+// -------------------------------------------------------
+
+// The scene has been rendered into the top left part of the scene images. Its color is sampled bilinearly and sharpened with
+// an unsharp mask of the four neighbouring texels, which is limited to the neighbours' range, s.t. it cannot cause ringing.
+// Its depth is taken from the nearest texel, s.t. subsequent passes can depth-test against the scene in the backbuffer.
+
+layout (set = 0, binding = 0) uniform sampler2D uSceneColor;
+layout (set = 0, binding = 1) uniform sampler2D uSceneDepth;
+
+layout (push_constant) uniform PushConstants {
+	// xy = extent of the rendered part in texels, zw = size of a texel in texture coordinates
+	vec4 mRenderExtentAndTexelSize;
+	// x = sharpness in [0, 1], yzw unused
+	vec4 mSharpness;
+} pushConstants;
+
+layout (location = 0) in vec2 vTexCoords;
+
+layout (location = 0) out vec4 oFragColor;
+
+vec3 sample_scene_color(vec2 aTexel, vec2 aMin, vec2 aMax)
+{
+	return textureLod(uSceneColor, clamp(aTexel, aMin, aMax) * pushConstants.mRenderExtentAndTexelSize.zw, 0.0).rgb;
+}
+
+void main()
+{
+	const vec2 extent = pushConstants.mRenderExtentAndTexelSize.xy;
+	const vec2 texel = vTexCoords * extent;
+	// Keep the bilinear footprints within the rendered part:
+	const vec2 lo = vec2(0.5);
+	const vec2 hi = extent - 0.5;
+
+	const vec3 c = sample_scene_color(texel, lo, hi);
+	const vec3 n = sample_scene_color(texel + vec2( 0.0, -1.0), lo, hi);
+	const vec3 s = sample_scene_color(texel + vec2( 0.0,  1.0), lo, hi);
+	const vec3 w = sample_scene_color(texel + vec2(-1.0,  0.0), lo, hi);
+	const vec3 e = sample_scene_color(texel + vec2( 1.0,  0.0), lo, hi);
+	const vec3 lowest  = min(c, min(min(n, s), min(w, e)));
+	const vec3 highest = max(c, max(max(n, s), max(w, e)));
+	const vec3 sharpened = c + pushConstants.mSharpness.x * (4.0 * c - n - s - w - e);
+	oFragColor = vec4(clamp(sharpened, lowest, highest), 1.0);
+
+	gl_FragDepth = texelFetch(uSceneDepth, min(ivec2(texel), ivec2(extent) - 1), 0).r;
+}
@@ -0,0 +1,15 @@
+#version 460
+// -------------------------------------------------------
+
+// One fullscreen triangle, there are no vertex attributes:
+// gl_VertexIndex 0, 1, 2 => (-1,-1), (3,-1), (-1,3) in normalized device coordinates, which covers the whole screen.
+
+// Texture coordinates within the backbuffer, (0,0) at the top left corner:
+layout (location = 0) out vec2 vTexCoords;
+
+void main()
+{
+	const vec2 ndc = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2.0 - 1.0;
+	vTexCoords = ndc * 0.5 + 0.5;
+	gl_Position = vec4(ndc, 0.0, 1.0);
+}
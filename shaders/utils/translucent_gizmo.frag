@@ -1,15 +1,12 @@
 #version 430 core
 
-layout(push_constant) uniform PushConstants {
-	mat4 pvmtMatrix;
-	vec4 uColor;
-};
+layout (location = 0) in vec4 vColor;
 
 // ------------- output-color of fragment ------------
 layout (location = 0) out vec4 oFragColor;
 
 void main()
 {
-	oFragColor = uColor;
+	oFragColor = vColor;
 }
 
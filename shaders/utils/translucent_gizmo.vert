@@ -1,14 +1,29 @@
 #version 430 core
 
 layout(push_constant) uniform PushConstants {
-	mat4 pvmtMatrix;
-	vec4 uColor;
+	mat4 pvMatrix;
 };
 
 layout (location = 0) in vec4 aVertexPosition; 
 
+// per-instance data of the gizmo (one instance per light):
+layout (location = 1) in vec4 aInstancePosition;
+layout (location = 2) in vec4 aInstanceScale;
+layout (location = 3) in vec4 aInstanceRotation; // quaternion (x, y, z, w)
+layout (location = 4) in vec4 aInstanceColor;
+
+layout (location = 0) out vec4 vColor;
+
+vec3 rotate_by_quaternion(vec3 v, vec4 q)
+{
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main()
 {	
-	gl_Position = pvmtMatrix * aVertexPosition;
+	// translate * rotate * scale, composed per vertex instead of per light on the CPU
+	vec3 positionWS = aInstancePosition.xyz + rotate_by_quaternion(aVertexPosition.xyz * aInstanceScale.xyz, aInstanceRotation);
+	gl_Position = pvMatrix * vec4(positionWS, 1.0);
+	vColor = aInstanceColor;
 }
 